@@ -0,0 +1,238 @@
+#include "ProgramGenerator.h"
+
+#include <Generator/Generator.h>
+#include <Optimiser/DeadCodeElimination.h>
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+#include <Parser/Parser.h>
+#include <Semantic/TypeChecker.h>
+#include <Tokeniser/Tokenizer.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Cepheid;
+using Cepheid::Parser::Nodes::NodeType;
+
+namespace {
+// Each measurement repeats until it has run for at least this long, so small programs still give stable numbers
+constexpr std::chrono::milliseconds minimumTime{200};
+
+// Throughput at the larger size below this fraction of the smaller's is reported as super-linear
+constexpr double scalingThreshold = 0.5;
+
+struct Shape {
+  std::string_view name;
+  /// Shape of the program at a given size multiplier
+  std::function<Bench::ProgramShape(size_t)> at;
+};
+
+const std::vector<Shape>& shapes() {
+  static const std::vector<Shape> shapes = {
+      {"many functions", [](size_t n) { return Bench::ProgramShape{1, 100 * n, 4, 8, 1, 3}; }},
+      {"deep nesting", [](size_t n) { return Bench::ProgramShape{2, 1, 2, 200 * n, 100 * n, 3}; }},
+      {"long expressions", [](size_t n) { return Bench::ProgramShape{3, 4, 4, 8, 0, 100 * n}; }},
+      {"many locals", [](size_t n) { return Bench::ProgramShape{4, 1, 500 * n, 500 * n, 0, 3}; }},
+  };
+  return shapes;
+}
+
+size_t countNodes(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return 0;
+  }
+
+  size_t count = 1;
+  switch (node->type()) {
+    case NodeType::Function: {
+      const auto* function = dynamic_cast<const Parser::Nodes::Function*>(node);
+      for (const auto& parameter : function->parameters()) {
+        count += countNodes(parameter.get());
+      }
+      count += countNodes(function->returnType()) + countNodes(function->scope());
+      break;
+    }
+    case NodeType::Scope:
+      for (const auto& statement : dynamic_cast<const Parser::Nodes::Scope*>(node)->statements()) {
+        count += countNodes(statement.get());
+      }
+      break;
+    case NodeType::VariableDeclaration: {
+      const auto* declaration = dynamic_cast<const Parser::Nodes::VariableDeclaration*>(node);
+      count += countNodes(declaration->typeName()) + countNodes(declaration->expression());
+      break;
+    }
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      count += countNodes(conditional->expression()) + countNodes(conditional->scope());
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      count += countNodes(loop->initExpression()) + countNodes(loop->conditionExpression()) +
+               countNodes(loop->updateExpression()) + countNodes(loop->scope());
+      break;
+    }
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      count += countNodes(binaryNode->lhs()) + countNodes(binaryNode->rhs());
+      break;
+    }
+    case NodeType::UnaryOperation:
+      count += countNodes(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand());
+      break;
+    default:
+      for (const auto& child : node->children()) {
+        count += countNodes(child.get());
+      }
+      break;
+  }
+  return count;
+}
+
+/// Seconds per run of a stage, whose setup isn't timed
+template <typename SetupT, typename RunT>
+double measure(SetupT&& setup, RunT&& run) {
+  std::chrono::steady_clock::duration elapsed{};
+  size_t runs = 0;
+  while (elapsed < minimumTime || runs < 3) {
+    auto input = setup();
+    const auto start = std::chrono::steady_clock::now();
+    run(input);
+    elapsed += std::chrono::steady_clock::now() - start;
+    runs++;
+  }
+  return std::chrono::duration<double>(elapsed).count() / static_cast<double>(runs);
+}
+
+struct Result {
+  size_t tokens = 0;
+  size_t nodes = 0;
+  size_t instructions = 0;
+  double tokeniseSeconds = 0;
+  double parseSeconds = 0;
+  double generateSeconds = 0;
+
+  [[nodiscard]] double tokensPerSecond() const {
+    return static_cast<double>(tokens) / tokeniseSeconds;
+  }
+  [[nodiscard]] double nodesPerSecond() const {
+    return static_cast<double>(nodes) / parseSeconds;
+  }
+  [[nodiscard]] double instructionsPerSecond() const {
+    return static_cast<double>(instructions) / generateSeconds;
+  }
+};
+
+Result benchProgram(const std::string& src) {
+  Result result;
+  const auto parseTree = [&src] { return Parser::Parser(Tokens::Tokeniser(src).tokenise()).parse(); };
+
+  result.tokens = Tokens::Tokeniser(src).tokenise().size();
+  result.nodes = countNodes(parseTree().get());
+
+  result.tokeniseSeconds = measure(
+      [] { return 0; }, [&src](int) { static_cast<void>(Tokens::Tokeniser(src).tokenise()); });
+
+  result.parseSeconds = measure(
+      [&src] { return Tokens::Tokeniser(src).tokenise(); },
+      [](const std::vector<Tokens::Token>& tokens) { static_cast<void>(Parser::Parser(tokens).parse()); });
+
+  // Generation is timed on its own, after the passes the compiler runs before it
+  std::string assembly;
+  result.generateSeconds = measure(
+      [&parseTree] {
+        Parser::Nodes::NodePtr root = parseTree();
+        Sema::ExpressionTypes types = Sema::TypeChecker().run(root.get());
+        static_cast<void>(Opt::DeadCodeElimination().run(root.get()));
+        return Gen::Generator(std::move(root), std::move(types));
+      },
+      [&assembly](Gen::Generator& generator) { assembly = generator.generate(); });
+  result.instructions = Gen::instructionCount(assembly);
+  return result;
+}
+
+void printRate(double rate) {
+  std::cout << std::setw(12) << std::fixed << std::setprecision(0) << rate;
+}
+}  // namespace
+
+/**
+ * Measures tokenising, parsing and generating code separately, on generated programs of each shape at a base size and
+ * at four times that size. Throughput that drops at the larger size points at something super-linear in the size of
+ * that shape, and is reported on stderr. With --csv, prints one row per shape, size and stage to compare against
+ * earlier runs. With --check, exits with a failure if anything was reported.
+ */
+int main(int argc, char* argv[]) {
+  size_t scale = 1;
+  bool csv = false;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (arg == "--csv") {
+      csv = true;
+    } else if (arg == "--check") {
+      check = true;
+    } else if (arg == "--scale" && i + 1 < argc) {
+      scale = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "Usage: cepheid_bench [--scale <n>] [--csv] [--check]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (csv) {
+    std::cout << "shape,size,stage,items,seconds,items_per_second\n";
+  } else {
+    std::cout << std::left << std::setw(18) << "shape" << std::right << std::setw(6) << "size" << std::setw(12)
+              << "tokens/s" << std::setw(12) << "nodes/s" << std::setw(12) << "instrs/s" << "\n";
+  }
+
+  bool superLinear = false;
+  for (const Shape& shape : shapes()) {
+    std::vector<Result> results;
+    for (const size_t size : {scale, scale * 4}) {
+      const Result result = benchProgram(Bench::generateProgram(shape.at(size)));
+      results.push_back(result);
+
+      if (csv) {
+        const auto row = [&](std::string_view stage, size_t items, double seconds) {
+          std::cout << shape.name << "," << size << "," << stage << "," << items << "," << seconds << ","
+                    << static_cast<double>(items) / seconds << "\n";
+        };
+        row("tokenise", result.tokens, result.tokeniseSeconds);
+        row("parse", result.nodes, result.parseSeconds);
+        row("generate", result.instructions, result.generateSeconds);
+        continue;
+      }
+      std::cout << std::left << std::setw(18) << shape.name << std::right << std::setw(6) << size;
+      printRate(result.tokensPerSecond());
+      printRate(result.nodesPerSecond());
+      printRate(result.instructionsPerSecond());
+      std::cout << "\n";
+    }
+
+    const auto compare = [&](std::string_view stage, double small, double large) {
+      if (large < small * scalingThreshold) {
+        superLinear = true;
+        std::cerr << shape.name << ": " << stage << " throughput drops " << std::setprecision(1) << small / large
+                  << "x at 4x the size" << std::endl;
+      }
+    };
+    compare("tokenise", results[0].tokensPerSecond(), results[1].tokensPerSecond());
+    compare("parse", results[0].nodesPerSecond(), results[1].nodesPerSecond());
+    compare("generate", results[0].instructionsPerSecond(), results[1].instructionsPerSecond());
+  }
+  return check && superLinear ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include "ProgramGenerator.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using namespace Cepheid::Bench;
+
+namespace {
+/// splitmix64, as the standard distributions aren't the same on every platform
+class Random {
+ public:
+  explicit Random(uint64_t seed) : m_state(seed) {
+  }
+
+  uint64_t next() {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  /// Uniform in [0, bound)
+  size_t below(size_t bound) {
+    return bound == 0 ? 0 : next() % bound;
+  }
+
+ private:
+  uint64_t m_state;
+};
+
+class FunctionWriter {
+ public:
+  FunctionWriter(const ProgramShape& shape, size_t index, Random& random, std::ostream& out)
+      : m_shape(shape), m_index(index), m_random(random), m_out(out) {
+  }
+
+  void write() {
+    m_out << "func f" << m_index << "(i64 p0, i64 p1) -> i64 {\n";
+    m_names = {"p0", "p1"};
+    for (size_t i = 0; i < m_shape.localsPerFunction; i++) {
+      declare(1);
+    }
+
+    // Statements are spread over each level of nesting, so the deepest level still has some
+    const size_t levels = m_shape.nestingDepth + 1;
+    writeLevel(0, levels);
+
+    m_out << "  return " << expression() << ";\n}\n\n";
+  }
+
+ private:
+  void writeLevel(size_t level, size_t levels) {
+    const size_t indent = level + 1;
+    const size_t statements = m_shape.statementsPerFunction / levels + (level < m_shape.statementsPerFunction % levels);
+    const size_t before = statements / 2;
+    for (size_t i = 0; i < before; i++) {
+      statement(indent);
+    }
+
+    if (level + 1 < levels) {
+      const size_t scopeStart = m_names.size();
+      const std::string counter = name();
+      if (level % 2 == 0) {
+        m_out << pad(indent) << "if (" << counter << " < " << m_random.below(1000) << ") {\n";
+      } else {
+        m_out << pad(indent) << "while (" << counter << " < " << m_random.below(1000) << ") {\n";
+        m_out << pad(indent + 1) << "++" << counter << ";\n";
+      }
+      declare(indent + 1);
+      writeLevel(level + 1, levels);
+      m_out << pad(indent) << "}\n";
+      m_names.resize(scopeStart);
+    }
+
+    for (size_t i = before; i < statements; i++) {
+      statement(indent);
+    }
+  }
+
+  void declare(size_t indent) {
+    const std::string name = "v" + std::to_string(m_nextLocal++);
+    m_out << pad(indent) << "i64 " << name << " = " << expression() << ";\n";
+    m_names.push_back(name);
+  }
+
+  void statement(size_t indent) {
+    m_out << pad(indent) << name() << " = " << expression() << ";\n";
+  }
+
+  [[nodiscard]] std::string expression() {
+    static constexpr const char* operators[] = {" + ", " - ", " * ", " + "};
+    std::string expression = operand();
+    for (size_t i = 1; i < m_shape.expressionLength; i++) {
+      expression += operators[m_random.below(std::size(operators))];
+      expression += operand();
+    }
+    return expression;
+  }
+
+  [[nodiscard]] std::string operand() {
+    const size_t choice = m_random.below(8);
+    if (choice == 0 && m_index > 0) {
+      return "f" + std::to_string(m_random.below(m_index)) + "(" + name() + ", " + name() + ")";
+    }
+    if (choice < 3) {
+      return std::to_string(m_random.below(100));
+    }
+    return name();
+  }
+
+  [[nodiscard]] const std::string& name() {
+    return m_names[m_random.below(m_names.size())];
+  }
+
+  /// Indentation stops growing past a few levels, or deeply nested programs would mostly be whitespace
+  [[nodiscard]] static std::string pad(size_t indent) {
+    return std::string(std::min<size_t>(indent, 8) * 2, ' ');
+  }
+
+  const ProgramShape& m_shape;
+  size_t m_index;
+  Random& m_random;
+  std::ostream& m_out;
+  std::vector<std::string> m_names;
+  size_t m_nextLocal = 0;
+};
+}  // namespace
+
+std::string Cepheid::Bench::generateProgram(const ProgramShape& shape) {
+  Random random(shape.seed);
+  std::stringstream out;
+  for (size_t i = 0; i < shape.functions; i++) {
+    FunctionWriter(shape, i, random, out).write();
+  }
+  out << "func main() -> i64 {\n";
+  if (shape.functions > 0) {
+    out << "  return f" << shape.functions - 1 << "(1, 2);\n";
+  } else {
+    out << "  return 0;\n";
+  }
+  out << "}\n";
+  return out.str();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Cepheid::Bench {
+/// Size and shape of a generated program, each of which can be scaled independently to find super-linear behaviour
+struct ProgramShape {
+  uint64_t seed = 1;
+  /// Functions besides main, each calling some of the ones before it
+  size_t functions = 1;
+  size_t localsPerFunction = 4;
+  size_t statementsPerFunction = 8;
+  /// Conditionals and loops nested inside each function, each declaring a local of its own
+  size_t nestingDepth = 0;
+  /// Operands in each expression
+  size_t expressionLength = 3;
+};
+
+/**
+ * Source of a valid program of the given shape.
+ *
+ * The same shape always gives the same program, on every platform, so timings can be compared from one build to the
+ * next.
+ */
+[[nodiscard]] std::string generateProgram(const ProgramShape& shape);
+
+}  // namespace Cepheid::Bench
@@ -0,0 +1,97 @@
+#include <Compiler.h>
+#include <Generator/SymbolTable.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+/// One function declaring count locals, each reading a couple of earlier ones
+std::string manyLocals(size_t count) {
+  std::stringstream src;
+  src << "func main() -> i64 {\n  i64 v0 = 1;\n";
+  for (size_t i = 1; i < count; i++) {
+    src << "  i64 v" << i << " = v" << i - 1 << " + v" << i / 2 << ";\n";
+  }
+  src << "  return v" << count - 1 << ";\n}\n";
+  return src.str();
+}
+
+/// Conditionals nested depth deep, each declaring locals that shadow the enclosing ones
+std::string deepNesting(size_t depth, size_t localsPerScope) {
+  std::stringstream src;
+  src << "func main() -> i64 {\n  i64 total = 0;\n";
+  for (size_t i = 0; i < localsPerScope; i++) {
+    src << "  i64 x" << i << " = " << i << ";\n";
+  }
+  for (size_t d = 0; d < depth; d++) {
+    src << "if (total < " << d + 1000000 << ") {\n";
+    for (size_t i = 0; i < localsPerScope; i++) {
+      src << "i64 x" << i << " = x" << (i + 1) % localsPerScope << " + 1;\n";
+    }
+    src << "total = total + x0;\n";
+  }
+  for (size_t d = 0; d < depth; d++) {
+    src << "}\n";
+  }
+  src << "  return total;\n}\n";
+  return src.str();
+}
+
+template <typename FuncT>
+double timeMs(size_t iterations, FuncT&& func) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    func();
+  }
+  const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(iterations);
+}
+
+void benchCompile(std::string_view name, const std::string& src, size_t iterations) {
+  size_t outputSize = 0;
+  const double ms = timeMs(iterations, [&] { outputSize += Cepheid::Compiler().compile(src).size(); });
+  std::cout << name << ": " << ms << " ms per compile (" << outputSize / iterations << " bytes of asm)\n";
+}
+
+void benchLookups(size_t names, size_t depth) {
+  Cepheid::Gen::NameTable nameTable;
+  Cepheid::Gen::SymbolTable<size_t> symbols;
+  std::vector<std::string> spellings;
+  for (size_t i = 0; i < names; i++) {
+    spellings.push_back("name" + std::to_string(i));
+  }
+
+  size_t found = 0;
+  const double ms = timeMs(10, [&] {
+    for (size_t d = 0; d < depth; d++) {
+      symbols.pushScope();
+      for (size_t i = d % 7; i < names; i += 7) {
+        symbols.insert(nameTable.intern(spellings[i]), d);
+      }
+      for (const std::string& spelling : spellings) {
+        if (const auto id = nameTable.find(spelling); id && symbols.find(*id)) {
+          found++;
+        }
+      }
+    }
+    for (size_t d = 0; d < depth; d++) {
+      symbols.popScope();
+    }
+  });
+  std::cout << "lookups (" << names << " names, " << depth << " scopes): " << ms << " ms per round, " << found / 10
+            << " hits\n";
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t scale = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1;
+
+  benchCompile("1000 locals", manyLocals(1000 * scale), 5);
+  benchCompile("5000 locals", manyLocals(5000 * scale), 2);
+  benchCompile("200 nested scopes x 20 locals", deepNesting(200 * scale, 20), 5);
+  benchLookups(5000 * scale, 200);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include <Server/Socket.h>
+
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::string_view usage() {
+  return "Usage: cepheid_client [--socket <socket>] <cepheid arguments...>\n"
+         "       cepheid_client [--socket <socket>] --shutdown";
+}
+}  // namespace
+
+/// Runs a command line on a compile server started with `cepheid --server`, as if cepheid had been run directly
+int main(int argc, char* argv[]) {
+  std::filesystem::path socketPath = Cepheid::Server::defaultSocketPath();
+  Cepheid::Server::Socket::Message request{"compile", std::filesystem::current_path().string()};
+
+  const std::vector<std::string_view> argList{argv + 1, argv + argc};
+  for (auto arg = argList.begin(); arg != argList.end(); ++arg) {
+    if (*arg == "--socket") {
+      if (++arg == argList.end()) {
+        std::cerr << "--socket needs a path.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      socketPath = *arg;
+    } else if (*arg == "--shutdown") {
+      request = {"shutdown"};
+    } else {
+      request.emplace_back(*arg);
+    }
+  }
+
+  const std::optional<Cepheid::Server::Socket> connection = Cepheid::Server::Socket::connect(socketPath);
+  if (!connection) {
+    std::cerr << "No compile server is listening on " << socketPath.string() << ", start one with cepheid --server"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::optional<Cepheid::Server::Socket::Message> response;
+  if (connection->send(request)) {
+    response = connection->receive();
+  }
+  if (!response || response->size() != 3) {
+    std::cerr << "Lost the connection to the compile server" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << (*response)[1] << std::flush;
+  std::cerr << (*response)[2] << std::flush;
+  return std::stoi((*response)[0]);
+}
@@ -0,0 +1,183 @@
+#include <Compiler.h>
+#include <Generator/CodeStats.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Cepheid;
+
+namespace {
+constexpr std::array<std::string_view, 10> metrics = {
+    "instructions", "bytes", "loads", "stores", "branches", "frame", "registers", "tables", "bittests", "trees"};
+
+using Row = std::array<size_t, metrics.size()>;
+/// Rows keyed by program file and function name
+using Table = std::map<std::pair<std::string, std::string>, Row>;
+
+Row row(const Gen::FunctionStats& stats) {
+  return {stats.instructions,
+          stats.bytes,
+          stats.loads,
+          stats.stores,
+          stats.branches,
+          stats.frameSize,
+          stats.registerHighWater,
+          stats.jumpTables,
+          stats.bitTests,
+          stats.decisionTrees};
+}
+
+Table measureCorpus(const std::filesystem::path& programs) {
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry : std::filesystem::directory_iterator(programs)) {
+    if (entry.path().extension() == ".cep") {
+      files.push_back(entry.path());
+    }
+  }
+  std::ranges::sort(files);
+
+  Table table;
+  for (const std::filesystem::path& file : files) {
+    std::ifstream in(file);
+    std::stringstream src;
+    src << in.rdbuf();
+
+    Compiler::Options options;
+    options.stats = true;
+    Compiler compiler(std::move(options));
+    (void)compiler.compile(src.str());
+    for (const Gen::FunctionStats& stats : compiler.functionStats()) {
+      table[{file.filename().string(), stats.name}] = row(stats);
+    }
+  }
+  return table;
+}
+
+Table readBaseline(const std::filesystem::path& path) {
+  Table table;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.starts_with('#')) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::pair<std::string, std::string> key;
+    Row values{};
+    fields >> key.first >> key.second;
+    for (size_t& value : values) {
+      fields >> value;
+    }
+    if (!fields) {
+      throw std::runtime_error("Malformed baseline line: " + line);
+    }
+    table[key] = values;
+  }
+  return table;
+}
+
+void writeBaseline(const std::filesystem::path& path, const Table& table) {
+  std::ofstream out(path);
+  out << "# Generated by cepheid_corpus --update\n# program function";
+  for (const std::string_view metric : metrics) {
+    out << " " << metric;
+  }
+  out << "\n";
+  for (const auto& [key, values] : table) {
+    out << key.first << " " << key.second;
+    for (const size_t value : values) {
+      out << " " << value;
+    }
+    out << "\n";
+  }
+}
+
+/// Print every difference from the baseline, returning whether there were any
+bool compare(const Table& baseline, const Table& current) {
+  bool changed = false;
+  Row baselineTotals{};
+  Row currentTotals{};
+  for (const auto& [key, values] : baseline) {
+    const std::string name = key.first + " " + key.second;
+    const auto found = current.find(key);
+    if (found == current.end()) {
+      std::cout << name << ": missing\n";
+      changed = true;
+      continue;
+    }
+    for (size_t i = 0; i < metrics.size(); i++) {
+      baselineTotals[i] += values[i];
+      currentTotals[i] += found->second[i];
+      if (values[i] != found->second[i]) {
+        const auto delta = static_cast<long long>(found->second[i]) - static_cast<long long>(values[i]);
+        std::cout << name << ": " << metrics[i] << " " << values[i] << " -> " << found->second[i] << " ("
+                  << (delta > 0 ? "+" : "") << delta << ")\n";
+        changed = true;
+      }
+    }
+  }
+  for (const auto& [key, values] : current) {
+    if (!baseline.contains(key)) {
+      std::cout << key.first << " " << key.second << ": not in baseline\n";
+      changed = true;
+    }
+  }
+
+  std::cout << "Totals over functions in both:\n";
+  for (size_t i = 0; i < metrics.size(); i++) {
+    std::cout << "  " << metrics[i] << ": " << baselineTotals[i];
+    if (currentTotals[i] != baselineTotals[i]) {
+      std::cout << " -> " << currentTotals[i];
+    }
+    std::cout << "\n";
+  }
+  return changed;
+}
+}  // namespace
+
+/**
+ * Compiles every program of the golden corpus and compares the code quality metrics of each function against the
+ * checked in baseline, failing on any difference so that codegen changes are seen and accepted deliberately.
+ *
+ * Usage: cepheid_corpus <corpus directory> [--update]
+ */
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: cepheid_corpus <corpus directory> [--update]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path corpus = argv[1];
+  const bool update = argc > 2 && std::string_view(argv[2]) == "--update";
+  const std::filesystem::path baselinePath = corpus / "baseline.txt";
+
+  try {
+    const Table current = measureCorpus(corpus / "programs");
+    if (update) {
+      writeBaseline(baselinePath, current);
+      std::cout << "Wrote " << current.size() << " functions to " << baselinePath.string() << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    if (compare(readBaseline(baselinePath), current)) {
+      std::cout << "Code quality metrics differ from the baseline. If the change is intended, rerun with --update and "
+                   "commit the new baseline."
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Code quality metrics match the baseline" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include "BuildCache.h"
+
+#include <Build/ContentHash.h>
+#include <Build/InterfaceFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <vector>
+
+using namespace Cepheid::Build;
+
+namespace {
+constexpr std::string_view assemblyExtension = ".asm";
+constexpr std::string_view objectExtension = ".obj";
+constexpr std::string_view temporaryExtension = ".tmp";
+// Longer than copying a file takes, so a temporary this old was left by a build that stopped before renaming it
+constexpr auto staleTemporaryAge = std::chrono::minutes(10);
+}  // namespace
+
+BuildCache::BuildCache(std::filesystem::path directory, uintmax_t maxSize, std::string compilerIdentity)
+    : m_directory(std::move(directory)),
+      m_maxSize(maxSize),
+      m_compilerIdentity(std::move(compilerIdentity)),
+      m_instance(std::random_device{}()) {
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+}
+
+std::string BuildCache::key(std::string_view source,
+                            const Compiler::Options& options,
+                            std::span<const Sema::ModuleInterface* const> imports) const {
+  ContentHash hash;
+  hash.add(m_compilerIdentity).add(source);
+
+  hash.add(options.instrument ? 1 : 0);
+  hash.add(options.ifConversionCost);
+  hash.add(options.target.popcnt ? 1 : 0).add(options.target.bitCounts ? 1 : 0);
+  // Line information names the source, so the same source at another path assembles differently
+  hash.add(options.debugInfo ? 1 : 0);
+  if (options.debugInfo) {
+    hash.add(options.sourceName);
+  }
+  std::stringstream profile;
+  if (options.profile) {
+    options.profile->write(profile);
+  }
+  hash.add(profile.str());
+
+  // Calls are generated from the callee's signature, so a change to any of them changes the output
+  hash.add(imports.size());
+  for (const Sema::ModuleInterface* interface : imports) {
+    hash.add(InterfaceFile::interfaceHash(*interface));
+  }
+  return hash.hex();
+}
+
+std::optional<BuildCache::Entry> BuildCache::lookup(const std::string& key) {
+  const std::filesystem::path assemblyPath = m_directory / (key + std::string(assemblyExtension));
+  const std::filesystem::path objectPath = m_directory / (key + std::string(objectExtension));
+
+  std::error_code error;
+  if (!std::filesystem::exists(assemblyPath, error) || !std::filesystem::exists(objectPath, error)) {
+    m_misses++;
+    return std::nullopt;
+  }
+
+  // The object's modification time is when the entry was last used
+  std::filesystem::last_write_time(objectPath, std::filesystem::file_time_type::clock::now(), error);
+  m_hits++;
+  return Entry{assemblyPath, objectPath};
+}
+
+void BuildCache::store(const std::string& key,
+                       const std::filesystem::path& assembly,
+                       const std::filesystem::path& object) {
+  if (storeFile(key, object, objectExtension) && storeFile(key, assembly, assemblyExtension)) {
+    m_stores++;
+  }
+}
+
+void BuildCache::trim() {
+  struct CachedUnit {
+    std::filesystem::file_time_type lastUsed = std::filesystem::file_time_type::max();
+    uintmax_t size = 0;
+    std::vector<std::filesystem::path> files;
+  };
+
+  std::error_code error;
+  std::map<std::string, CachedUnit> units;
+  uintmax_t totalSize = 0;
+  const auto staleBefore = std::filesystem::file_time_type::clock::now() - staleTemporaryAge;
+  for (const auto& file : std::filesystem::directory_iterator(m_directory, error)) {
+    const std::filesystem::path& path = file.path();
+    if (path.extension() != assemblyExtension && path.extension() != objectExtension &&
+        path.extension() != temporaryExtension) {
+      continue;
+    }
+    const uintmax_t size = file.file_size(error);
+    if (error) {
+      continue;
+    }
+
+    // Another build may still be writing a recent one, so it takes up space but can't be evicted
+    if (path.extension() == temporaryExtension) {
+      const std::filesystem::file_time_type written = file.last_write_time(error);
+      if (!error && written < staleBefore) {
+        std::filesystem::remove(path, error);
+      } else {
+        totalSize += size;
+      }
+      continue;
+    }
+
+    CachedUnit& unit = units[path.stem().string()];
+    unit.size += size;
+    unit.files.push_back(path);
+    if (path.extension() == objectExtension) {
+      unit.lastUsed = file.last_write_time(error);
+    }
+    totalSize += size;
+  }
+  if (totalSize <= m_maxSize) {
+    return;
+  }
+
+  std::vector<const CachedUnit*> byAge;
+  for (const CachedUnit& unit : units | std::views::values) {
+    byAge.push_back(&unit);
+  }
+  std::ranges::sort(byAge, {}, &CachedUnit::lastUsed);
+
+  for (const CachedUnit* unit : byAge) {
+    if (totalSize <= m_maxSize) {
+      break;
+    }
+    // The assembly goes first, so a reader never finds it without its object
+    for (const std::string_view extension : {assemblyExtension, objectExtension}) {
+      for (const std::filesystem::path& file : unit->files) {
+        if (file.extension() == extension) {
+          std::filesystem::remove(file, error);
+        }
+      }
+    }
+    totalSize -= unit->size;
+    m_evictions++;
+  }
+}
+
+BuildCache::Stats BuildCache::stats() const {
+  return {m_hits, m_misses, m_stores, m_evictions};
+}
+
+bool BuildCache::storeFile(const std::string& key, const std::filesystem::path& file, std::string_view extension) {
+  std::error_code error;
+  const std::filesystem::path temporary = temporaryPath(key);
+  std::filesystem::copy_file(file, temporary, std::filesystem::copy_options::overwrite_existing, error);
+  if (!error) {
+    std::filesystem::rename(temporary, m_directory / (key + std::string(extension)), error);
+  }
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+std::filesystem::path BuildCache::temporaryPath(const std::string& key) {
+  return m_directory / (key + "." + std::to_string(m_instance) + "." + std::to_string(m_nextTemporary++) +
+                        std::string(temporaryExtension));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Compiler.h>
+#include <Semantic/ModuleInterface.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Cepheid::Build {
+/**
+ * On disk cache of compiled source files, keyed by a hash of everything that goes into their output.
+ *
+ * An entry is the generated assembly and the object assembled from it, stored as <key>.asm and <key>.obj. Files are
+ * written under a temporary name and renamed into place, the assembly last, so builds sharing a cache never see half
+ * an entry. A hit refreshes the entry's modification time, and trimming removes the least recently used entries until
+ * the cache fits its size limit. The cache is only an optimisation, so failing to read or write it never fails a build.
+ */
+class BuildCache {
+ public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stores = 0;
+    size_t evictions = 0;
+  };
+
+  struct Entry {
+    std::filesystem::path assembly;
+    std::filesystem::path object;
+  };
+
+  /// compilerIdentity distinguishes builds of the compiler that could generate different code
+  BuildCache(std::filesystem::path directory, uintmax_t maxSize, std::string compilerIdentity);
+
+  /// Key for a source file compiled with the given options, calling into the given module interfaces
+  [[nodiscard]] std::string key(std::string_view source,
+                                const Compiler::Options& options,
+                                std::span<const Sema::ModuleInterface* const> imports = {}) const;
+
+  [[nodiscard]] std::optional<Entry> lookup(const std::string& key);
+
+  /// Store copies of generated assembly and the object assembled from it
+  void store(const std::string& key, const std::filesystem::path& assembly, const std::filesystem::path& object);
+
+  /// Remove the least recently used entries until the cache is no bigger than its limit, counting the temporary files
+  /// of stores in progress. Temporary files old enough to have been left by a build that stopped are removed.
+  void trim();
+
+  [[nodiscard]] Stats stats() const;
+
+ private:
+  [[nodiscard]] std::filesystem::path temporaryPath(const std::string& key);
+  /// Copy a file into the cache under a temporary name, then rename it into place
+  [[nodiscard]] bool storeFile(const std::string& key, const std::filesystem::path& file, std::string_view extension);
+
+  std::filesystem::path m_directory;
+  uintmax_t m_maxSize;
+  std::string m_compilerIdentity;
+  // Keeps temporary names from different processes and threads apart
+  uint64_t m_instance;
+  std::atomic<uint64_t> m_nextTemporary = 0;
+
+  std::atomic<size_t> m_hits = 0;
+  std::atomic<size_t> m_misses = 0;
+  std::atomic<size_t> m_stores = 0;
+  std::atomic<size_t> m_evictions = 0;
+};
+
+}  // namespace Cepheid::Build
@@ -0,0 +1 @@
+#include "BuildException.h"
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+namespace Cepheid::Build {
+
+class BuildException : public std::exception {
+ public:
+  BuildException() = default;
+  explicit BuildException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
+};
+
+}  // namespace Cepheid::Build
@@ -0,0 +1,117 @@
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace Cepheid::Build;
+
+namespace {
+uint64_t finalMix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+uint64_t readBlock(const char* bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+  }
+  return value;
+}
+}  // namespace
+
+ContentHash& ContentHash::add(std::string_view bytes) {
+  add(static_cast<uint64_t>(bytes.size()));
+  m_bytes.append(bytes);
+  return *this;
+}
+
+ContentHash& ContentHash::add(uint64_t value) {
+  for (size_t i = 0; i < sizeof(value); i++) {
+    m_bytes.push_back(static_cast<char>(value >> (8 * i)));
+  }
+  return *this;
+}
+
+ContentHash& ContentHash::add(const Digest& digest) {
+  return add(digest[0]).add(digest[1]);
+}
+
+ContentHash::Digest ContentHash::digest() const {
+  constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+  constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+  const size_t length = m_bytes.size();
+  const size_t blocks = length / 16;
+  uint64_t h1 = 0;
+  uint64_t h2 = 0;
+
+  for (size_t i = 0; i < blocks; i++) {
+    uint64_t k1 = readBlock(m_bytes.data() + i * 16);
+    uint64_t k2 = readBlock(m_bytes.data() + i * 16 + 8);
+
+    k1 *= c1;
+    k1 = std::rotl(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+    h1 = std::rotl(h1, 27);
+    h1 += h2;
+    h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2;
+    k2 = std::rotl(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+    h2 = std::rotl(h2, 31);
+    h2 += h1;
+    h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  // The last partial block, read little endian
+  const auto* tail = reinterpret_cast<const unsigned char*>(m_bytes.data() + blocks * 16);
+  const size_t tailLength = length & 15;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  for (size_t i = tailLength; i > 8; i--) {
+    k2 ^= static_cast<uint64_t>(tail[i - 1]) << (8 * (i - 9));
+  }
+  for (size_t i = std::min<size_t>(tailLength, 8); i > 0; i--) {
+    k1 ^= static_cast<uint64_t>(tail[i - 1]) << (8 * (i - 1));
+  }
+  if (tailLength > 8) {
+    k2 *= c2;
+    k2 = std::rotl(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+  }
+  if (tailLength > 0) {
+    k1 *= c1;
+    k1 = std::rotl(k1, 31);
+    k1 *= c2;
+    h1 ^= k1;
+  }
+
+  h1 ^= length;
+  h2 ^= length;
+  h1 += h2;
+  h2 += h1;
+  h1 = finalMix(h1);
+  h2 = finalMix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
+std::string ContentHash::hex() const {
+  constexpr std::string_view digits = "0123456789abcdef";
+  std::string result;
+  for (const uint64_t half : digest()) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      result.push_back(digits[(half >> shift) & 0xf]);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Cepheid::Build {
+/**
+ * 128 bit MurmurHash3 of a sequence of fields.
+ *
+ * Each field is added with its length, so moving bytes from one field to the next changes the hash. Not a
+ * cryptographic hash, but wide enough that an accidental collision between cache keys isn't a practical concern.
+ */
+class ContentHash {
+ public:
+  using Digest = std::array<uint64_t, 2>;
+
+  ContentHash& add(std::string_view bytes);
+  ContentHash& add(uint64_t value);
+  ContentHash& add(const Digest& digest);
+
+  [[nodiscard]] Digest digest() const;
+  /// Digest as 32 lower case hex digits, usable as a file name
+  [[nodiscard]] std::string hex() const;
+
+ private:
+  std::string m_bytes;
+};
+
+}  // namespace Cepheid::Build
@@ -0,0 +1,330 @@
+#include "InterfaceFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+using namespace Cepheid::Build;
+
+namespace {
+constexpr std::string_view magic = "CEPI";
+constexpr uint32_t formatVersion = 1;
+constexpr uint32_t definesMainFlag = 1;
+
+// Sizes of the header and of a record in each table
+constexpr size_t headerSize = 68;
+constexpr size_t typeSize = 20;
+constexpr size_t functionSize = 20;
+constexpr size_t parameterSize = 4;
+constexpr size_t fileSize = 8;
+constexpr size_t importSize = 8;
+
+class Writer {
+ public:
+  void u32(size_t value) {
+    for (size_t i = 0; i < 4; i++) {
+      m_bytes.push_back(static_cast<char>(value >> (8 * i)));
+    }
+  }
+
+  void hash(const InterfaceFile::Hash& hash) {
+    for (const uint64_t half : hash) {
+      u32(half & 0xffffffff);
+      u32(half >> 32);
+    }
+  }
+
+  void bytes(std::string_view bytes) {
+    m_bytes.append(bytes);
+  }
+
+  /// Reference to a name in the string table, as its offset and length
+  void name(std::string_view name) {
+    const auto [it, inserted] = m_stringOffsets.try_emplace(std::string(name), m_strings.size());
+    if (inserted) {
+      m_strings.append(name);
+    }
+    u32(it->second);
+    u32(name.size());
+  }
+
+  [[nodiscard]] std::string finish() {
+    return std::move(m_bytes) + m_strings;
+  }
+
+ private:
+  std::string m_bytes;
+  std::string m_strings;
+  std::map<std::string, size_t, std::less<>> m_stringOffsets;
+};
+
+[[nodiscard]] std::string_view typeName(Cepheid::Sema::ValueType type) {
+  for (const Cepheid::Sema::PrimitiveType& primitive : Cepheid::Sema::primitiveTypes()) {
+    if (primitive.type == type) {
+      return primitive.name;
+    }
+  }
+  return {};
+}
+
+[[nodiscard]] std::string serialise(const Cepheid::Sema::ModuleInterface& interface,
+                                    const InterfaceFile::Record& record) {
+  std::vector<Cepheid::Sema::ValueType> types;
+  const auto typeIndex = [&types](Cepheid::Sema::ValueType type) {
+    const auto it = std::ranges::find(types, type);
+    if (it != types.end()) {
+      return static_cast<size_t>(it - types.begin());
+    }
+    types.push_back(type);
+    return types.size() - 1;
+  };
+  std::vector<size_t> parameters;
+  std::vector<size_t> returnTypes;
+  for (const Cepheid::Sema::FunctionSignature& function : interface.functions) {
+    returnTypes.push_back(typeIndex(function.returnType));
+    for (const Cepheid::Sema::ValueType parameter : function.parameters) {
+      parameters.push_back(typeIndex(parameter));
+    }
+  }
+  size_t importCount = 0;
+  for (const auto& imports : record.fileImports) {
+    importCount += imports.size();
+  }
+
+  Writer writer;
+  writer.bytes(magic);
+  writer.u32(formatVersion);
+  writer.hash(InterfaceFile::interfaceHash(interface));
+  writer.hash(record.sourceHash);
+  writer.u32(record.definesMain ? definesMainFlag : 0);
+  writer.u32(types.size());
+  writer.u32(interface.functions.size());
+  writer.u32(parameters.size());
+  writer.u32(record.fileImports.size());
+  writer.u32(importCount);
+
+  // The string table size closes the header, and is only known once everything else is written
+  Writer body;
+  for (const Cepheid::Sema::ValueType type : types) {
+    body.name(typeName(type));
+    body.u32(type.size);
+    // Types are aligned to their size, as the generator lays them out
+    body.u32(type.size);
+    body.u32(type.isSigned ? 1 : 0);
+  }
+  size_t firstParameter = 0;
+  for (size_t i = 0; i < interface.functions.size(); i++) {
+    const Cepheid::Sema::FunctionSignature& function = interface.functions[i];
+    body.name(function.name);
+    body.u32(returnTypes[i]);
+    body.u32(firstParameter);
+    body.u32(function.parameters.size());
+    firstParameter += function.parameters.size();
+  }
+  for (const size_t parameter : parameters) {
+    body.u32(parameter);
+  }
+  size_t firstImport = 0;
+  for (const auto& imports : record.fileImports) {
+    body.u32(firstImport);
+    body.u32(imports.size());
+    firstImport += imports.size();
+  }
+  for (const auto& imports : record.fileImports) {
+    for (const std::string& imported : imports) {
+      body.name(imported);
+    }
+  }
+
+  std::string bodyBytes = body.finish();
+  const size_t tablesSize = types.size() * typeSize + interface.functions.size() * functionSize +
+                            parameters.size() * parameterSize + record.fileImports.size() * fileSize +
+                            importCount * importSize;
+  writer.u32(bodyBytes.size() - tablesSize);
+
+  return writer.finish() + bodyBytes;
+}
+}  // namespace
+
+InterfaceFile::InterfaceFile(MappedFile file) : m_file(std::move(file)) {
+}
+
+InterfaceFile::Hash InterfaceFile::interfaceHash(const Sema::ModuleInterface& interface) {
+  ContentHash hash;
+  hash.add(interface.name).add(interface.functions.size());
+  for (const Sema::FunctionSignature& function : interface.functions) {
+    hash.add(function.name).add(function.parameters.size());
+    for (const Sema::ValueType parameter : function.parameters) {
+      hash.add(parameter.size).add(parameter.isSigned ? 1 : 0);
+    }
+    hash.add(function.returnType.size).add(function.returnType.isSigned ? 1 : 0);
+  }
+  return hash.digest();
+}
+
+std::optional<InterfaceFile> InterfaceFile::open(const std::filesystem::path& path) {
+  std::optional<MappedFile> file = MappedFile::open(path);
+  if (!file) {
+    return std::nullopt;
+  }
+
+  InterfaceFile interfaceFile(std::move(*file));
+  if (!interfaceFile.validate()) {
+    return std::nullopt;
+  }
+  return interfaceFile;
+}
+
+void InterfaceFile::write(const std::filesystem::path& path,
+                          const Sema::ModuleInterface& interface,
+                          const Record& record) {
+  const std::string bytes = serialise(interface, record);
+
+  // An unchanged file keeps its modification time, so anything watching it sees no change
+  if (const std::optional<MappedFile> existing = MappedFile::open(path)) {
+    const std::span<const std::byte> existingBytes = existing->bytes();
+    if (existingBytes.size() == bytes.size() &&
+        std::equal(existingBytes.begin(), existingBytes.end(), reinterpret_cast<const std::byte*>(bytes.data()))) {
+      return;
+    }
+  }
+
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream output(temporary, std::ios::binary);
+    output << bytes;
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+  }
+}
+
+InterfaceFile::Hash InterfaceFile::interfaceHash() const {
+  return readHash(8);
+}
+
+InterfaceFile::Hash InterfaceFile::sourceHash() const {
+  return readHash(24);
+}
+
+std::optional<Cepheid::Sema::ModuleInterface> InterfaceFile::interface(std::string moduleName) const {
+  std::vector<Sema::ValueType> types;
+  for (size_t i = 0; i < m_types.count; i++) {
+    const size_t offset = m_types.offset + i * typeSize;
+    const Sema::ValueType type{read(offset + 8), read(offset + 16) != 0};
+    const std::optional<Sema::ValueType> primitive = Sema::primitiveType(string(offset));
+    if (!primitive || *primitive != type || read(offset + 12) != type.size) {
+      return std::nullopt;
+    }
+    types.push_back(type);
+  }
+
+  Sema::ModuleInterface interface{std::move(moduleName), {}};
+  interface.functions.reserve(m_functions.count);
+  for (size_t i = 0; i < m_functions.count; i++) {
+    const size_t offset = m_functions.offset + i * functionSize;
+    Sema::FunctionSignature& function = interface.functions.emplace_back();
+    function.name = string(offset);
+    function.returnType = types[read(offset + 8)];
+    const size_t firstParameter = read(offset + 12);
+    const size_t parameterCount = read(offset + 16);
+    for (size_t j = 0; j < parameterCount; j++) {
+      function.parameters.push_back(types[read(m_parameters.offset + (firstParameter + j) * parameterSize)]);
+    }
+  }
+  return interface;
+}
+
+InterfaceFile::Record InterfaceFile::record() const {
+  Record record{sourceHash(), (m_flags & definesMainFlag) != 0, {}};
+  for (size_t i = 0; i < m_files.count; i++) {
+    const size_t offset = m_files.offset + i * fileSize;
+    const size_t firstImport = read(offset);
+    const size_t importCount = read(offset + 4);
+    std::vector<std::string>& imports = record.fileImports.emplace_back();
+    for (size_t j = 0; j < importCount; j++) {
+      imports.emplace_back(string(m_imports.offset + (firstImport + j) * importSize));
+    }
+  }
+  return record;
+}
+
+bool InterfaceFile::validate() {
+  const std::span<const std::byte> bytes = m_file.bytes();
+  if (bytes.size() < headerSize ||
+      !std::equal(magic.begin(), magic.end(), bytes.begin(), [](char c, std::byte b) {
+        return static_cast<std::byte>(c) == b;
+      }) ||
+      read(4) != formatVersion) {
+    return false;
+  }
+
+  m_flags = read(40);
+  size_t offset = headerSize;
+  const auto table = [&offset](Table& table, size_t count, size_t recordSize) {
+    table = {offset, count};
+    offset += count * recordSize;
+  };
+  table(m_types, read(44), typeSize);
+  table(m_functions, read(48), functionSize);
+  table(m_parameters, read(52), parameterSize);
+  table(m_files, read(56), fileSize);
+  table(m_imports, read(60), importSize);
+  table(m_strings, read(64), 1);
+  if (offset != bytes.size()) {
+    return false;
+  }
+
+  // Every reference is checked once here, so the accessors can index without checking
+  const auto validName = [this](size_t offset) { return size_t{read(offset)} + read(offset + 4) <= m_strings.count; };
+  for (size_t i = 0; i < m_types.count; i++) {
+    if (!validName(m_types.offset + i * typeSize)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_functions.count; i++) {
+    const size_t function = m_functions.offset + i * functionSize;
+    if (!validName(function) || read(function + 8) >= m_types.count ||
+        size_t{read(function + 12)} + read(function + 16) > m_parameters.count) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_parameters.count; i++) {
+    if (read(m_parameters.offset + i * parameterSize) >= m_types.count) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_files.count; i++) {
+    const size_t file = m_files.offset + i * fileSize;
+    if (size_t{read(file)} + read(file + 4) > m_imports.count) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < m_imports.count; i++) {
+    if (!validName(m_imports.offset + i * importSize)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t InterfaceFile::read(size_t offset) const {
+  const std::span<const std::byte> bytes = m_file.bytes();
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(bytes[offset + i]) << (8 * i);
+  }
+  return value;
+}
+
+InterfaceFile::Hash InterfaceFile::readHash(size_t offset) const {
+  return {read(offset) | uint64_t{read(offset + 4)} << 32, read(offset + 8) | uint64_t{read(offset + 12)} << 32};
+}
+
+std::string_view InterfaceFile::string(size_t offset) const {
+  const auto* strings = reinterpret_cast<const char*>(m_file.bytes().data() + m_strings.offset);
+  return {strings + read(offset), read(offset + 4)};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Build/ContentHash.h>
+#include <Build/MappedFile.h>
+#include <Semantic/ModuleInterface.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Cepheid::Build {
+/**
+ * Compact binary summary of a module, written by the build that compiled it.
+ *
+ * It holds the signatures of the module's exported functions and the layouts of the types they use. Importers read
+ * them as fixed size records from a mapped file instead of parsing the module's sources. It also records what a build
+ * needs to schedule the module without parsing it: the modules each file imports and whether the module defines main.
+ * The header has two hashes. The source hash says whether the file is still valid for the module's current sources.
+ * The interface hash covers only what importers depend on, so they only rebuild when it changes.
+ *
+ * Every field is a little endian u32 apart from the hashes, which are pairs of u64s.
+ *   header      "CEPI", format version, interface hash, source hash, flags, then the count of each table below
+ *   types       name, name length, size, alignment, signedness
+ *   functions   name, name length, return type, first parameter, parameter count
+ *   parameters  type
+ *   files       first import, import count
+ *   imports     name, name length
+ *   strings     names, referenced by their offset into this table
+ */
+class InterfaceFile {
+ public:
+  using Hash = ContentHash::Digest;
+
+  /// What a build knows about a module besides its interface
+  struct Record {
+    Hash sourceHash{};
+    bool definesMain = false;
+    /// Modules imported by each of the module's files, in the order the config lists the files
+    std::vector<std::vector<std::string>> fileImports;
+  };
+
+  [[nodiscard]] static Hash interfaceHash(const Sema::ModuleInterface& interface);
+
+  /// Nothing if the file is missing, malformed or in a different format version
+  [[nodiscard]] static std::optional<InterfaceFile> open(const std::filesystem::path& path);
+
+  /// Write a module's interface file, leaving an existing file untouched if its contents wouldn't change
+  static void write(const std::filesystem::path& path, const Sema::ModuleInterface& interface, const Record& record);
+
+  [[nodiscard]] Hash interfaceHash() const;
+  [[nodiscard]] Hash sourceHash() const;
+
+  /// Nothing if a type's layout doesn't match this compiler's, so the module has to be read from source
+  [[nodiscard]] std::optional<Sema::ModuleInterface> interface(std::string moduleName) const;
+  [[nodiscard]] Record record() const;
+
+ private:
+  struct Table {
+    size_t offset = 0;
+    size_t count = 0;
+  };
+
+  explicit InterfaceFile(MappedFile file);
+
+  [[nodiscard]] bool validate();
+  [[nodiscard]] uint32_t read(size_t offset) const;
+  [[nodiscard]] Hash readHash(size_t offset) const;
+  [[nodiscard]] std::string_view string(size_t offset) const;
+
+  MappedFile m_file;
+  uint32_t m_flags = 0;
+  Table m_types;
+  Table m_functions;
+  Table m_parameters;
+  Table m_files;
+  Table m_imports;
+  Table m_strings;
+};
+
+}  // namespace Cepheid::Build
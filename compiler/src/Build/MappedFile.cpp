@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Cepheid::Build;
+
+std::optional<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+  MappedFile mapped;
+#ifdef _WIN32
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return std::nullopt;
+  }
+  mapped.m_file = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    return std::nullopt;
+  }
+  mapped.m_size = static_cast<size_t>(size.QuadPart);
+  if (mapped.m_size == 0) {
+    // Empty files can't be mapped, but are a valid empty view
+    return mapped;
+  }
+
+  mapped.m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapped.m_mapping) {
+    return std::nullopt;
+  }
+  mapped.m_data = static_cast<const std::byte*>(MapViewOfFile(mapped.m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!mapped.m_data) {
+    return std::nullopt;
+  }
+#else
+  const int file = ::open(path.c_str(), O_RDONLY);
+  if (file < 0) {
+    return std::nullopt;
+  }
+  struct stat status {};
+  if (fstat(file, &status) != 0) {
+    ::close(file);
+    return std::nullopt;
+  }
+  mapped.m_size = static_cast<size_t>(status.st_size);
+  if (mapped.m_size == 0) {
+    ::close(file);
+    return mapped;
+  }
+
+  // The mapping keeps the file alive, so the descriptor isn't needed once it's made
+  void* data = mmap(nullptr, mapped.m_size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (data == MAP_FAILED) {
+    return std::nullopt;
+  }
+  mapped.m_data = static_cast<const std::byte*>(data);
+#endif
+  return mapped;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+    m_file = std::exchange(other.m_file, nullptr);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+std::span<const std::byte> MappedFile::bytes() const {
+  return {m_data, m_size};
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+  if (m_data) {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file) {
+    CloseHandle(m_file);
+  }
+  m_file = nullptr;
+  m_mapping = nullptr;
+#else
+  if (m_data) {
+    munmap(const_cast<std::byte*>(m_data), m_size);
+  }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace Cepheid::Build {
+/// Read only view of a whole file mapped into memory
+class MappedFile {
+ public:
+  /// Nothing if the file can't be opened or mapped
+  [[nodiscard]] static std::optional<MappedFile> open(const std::filesystem::path& path);
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(const MappedFile& other) = delete;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  [[nodiscard]] std::span<const std::byte> bytes() const;
+
+ private:
+  MappedFile() = default;
+  void close();
+
+  const std::byte* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
+
+}  // namespace Cepheid::Build
@@ -0,0 +1,27 @@
+#include "ModuleCache.h"
+
+using namespace Cepheid::Build;
+
+ModuleCache::ModuleCache(size_t capacity) : m_capacity(capacity) {
+}
+
+std::optional<ModuleCache::Entry> ModuleCache::lookup(const ContentHash::Digest& sourceHash) const {
+  std::lock_guard lock(m_mutex);
+  const auto it = m_entries.find(sourceHash);
+  if (it == m_entries.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void ModuleCache::store(const ContentHash::Digest& sourceHash, Entry entry) {
+  std::lock_guard lock(m_mutex);
+  if (!m_entries.insert_or_assign(sourceHash, std::move(entry)).second) {
+    return;
+  }
+  m_order.push_back(sourceHash);
+  while (m_entries.size() > m_capacity) {
+    m_entries.erase(m_order.front());
+    m_order.pop_front();
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Build/ContentHash.h>
+#include <Build/InterfaceFile.h>
+#include <Semantic/ModuleInterface.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+
+namespace Cepheid::Build {
+/**
+ * Module interfaces kept in memory between builds, keyed by the hash of the module's sources.
+ *
+ * Lets a long running compiler skip even reading a module's interface file. Safe to share between concurrent builds.
+ * Once full, the oldest module is forgotten first.
+ */
+class ModuleCache {
+ public:
+  struct Entry {
+    Sema::ModuleInterface interface;
+    InterfaceFile::Record record;
+  };
+
+  explicit ModuleCache(size_t capacity = 4096);
+
+  [[nodiscard]] std::optional<Entry> lookup(const ContentHash::Digest& sourceHash) const;
+  void store(const ContentHash::Digest& sourceHash, Entry entry);
+
+ private:
+  size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::map<ContentHash::Digest, Entry> m_entries;
+  std::deque<ContentHash::Digest> m_order;
+};
+
+}  // namespace Cepheid::Build
@@ -0,0 +1,322 @@
+#include "Project.h"
+
+#include <Build/BuildCache.h>
+#include <Build/BuildException.h>
+#include <Build/InterfaceFile.h>
+#include <Build/ThreadPool.h>
+#include <Generator/OutputSink.h>
+#include <Parser/Node/Function.h>
+#include <Trace/Trace.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace Cepheid::Build;
+
+using Cepheid::Parser::Nodes::NodeType;
+
+namespace {
+[[noreturn]] void fail(const std::filesystem::path& path, std::string_view message) {
+  throw BuildException((path.string() + ": " + std::string(message)).c_str());
+}
+}  // namespace
+
+Project::Project(const Config& config,
+                 std::filesystem::path root,
+                 std::filesystem::path interfaceDirectory,
+                 ModuleCache* moduleCache)
+    : m_root(std::move(root)), m_interfaceDirectory(std::move(interfaceDirectory)), m_moduleCache(moduleCache) {
+  const auto addModule = [&](std::string_view name, const std::vector<std::string>& sources) {
+    for (const Module& module : m_modules) {
+      if (module.name == name) {
+        throw BuildException(("Module " + std::string(name) + " declared more than once").c_str());
+      }
+    }
+    Module& module = m_modules.emplace_back();
+    module.name = name;
+    for (const std::string& source : sources) {
+      module.files.push_back(m_files.size());
+      File& file = m_files.emplace_back();
+      file.path = m_root / source;
+      file.module = m_modules.size() - 1;
+    }
+  };
+
+  // The project's own sources form a module named after it
+  if (!config.sources().empty()) {
+    addModule(config.name(), config.sources());
+  }
+  for (const ModuleConfig& module : config.modules()) {
+    addModule(module.name, module.sources);
+  }
+  if (m_files.empty()) {
+    throw BuildException("Project has no source files");
+  }
+
+  // Every output goes in one directory, so a/b.cep and a_b.cep would overwrite each other's assembly. Names are
+  // compared ignoring case, as they are on Windows.
+  std::map<std::string, const File*> outputs;
+  for (File& file : m_files) {
+    file.outputName = file.path.lexically_relative(m_root).replace_extension().generic_string();
+    std::ranges::replace(file.outputName, '/', '_');
+    std::string folded = file.outputName;
+    std::ranges::transform(folded, folded.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (const auto [it, inserted] = outputs.try_emplace(std::move(folded), &file); !inserted) {
+      fail(file.path, "Output name " + file.outputName + " is also used by " + it->second->path.string());
+    }
+  }
+}
+
+std::vector<CompiledUnit> Project::build(ThreadPool& pool,
+                                         const Compiler::Options& options,
+                                         const std::filesystem::path& outputDirectory,
+                                         BuildCache* cache) {
+  readSources(pool);
+  for (Module& module : m_modules) {
+    pool.submit([this, &module] { loadModule(module); });
+  }
+  pool.wait();
+  resolveImports();
+  checkCycles();
+
+  if (std::ranges::count_if(m_modules, &Module::definesMain) != 1) {
+    throw BuildException("Project needs exactly one main function");
+  }
+
+  m_units.resize(m_files.size());
+  m_waiting = std::make_unique<std::atomic<size_t>[]>(m_modules.size());
+  for (size_t i = 0; i < m_modules.size(); i++) {
+    m_waiting[i] = m_modules[i].imports.size();
+  }
+  for (size_t i = 0; i < m_modules.size(); i++) {
+    if (m_modules[i].imports.empty()) {
+      pool.submit([this, i, &pool, &options, &outputDirectory, cache] {
+        compileModule(i, pool, options, outputDirectory, cache);
+      });
+    }
+  }
+  pool.wait();
+
+  return std::move(m_units);
+}
+
+void Project::readSources(ThreadPool& pool) {
+  for (File& file : m_files) {
+    pool.submit([&file] {
+      const Trace::Span span("read");
+      std::ifstream input(file.path, std::ios::binary);
+      if (!input) {
+        fail(file.path, "Unable to open source file");
+      }
+      std::stringstream src;
+      src << input.rdbuf();
+      file.source = src.str();
+    });
+  }
+  pool.wait();
+}
+
+void Project::loadModule(Module& module) {
+  ContentHash hash;
+  hash.add(Compiler::version).add(module.name).add(module.files.size());
+  for (const size_t fileIndex : module.files) {
+    hash.add(m_files[fileIndex].path.generic_string()).add(m_files[fileIndex].source);
+  }
+  const ContentHash::Digest sourceHash = hash.digest();
+
+  std::optional<ModuleCache::Entry> entry;
+  if (m_moduleCache) {
+    entry = m_moduleCache->lookup(sourceHash);
+  }
+  if (!entry) {
+    const std::filesystem::path path = m_interfaceDirectory / (module.name + ".cepi");
+    if (!m_interfaceDirectory.empty()) {
+      entry = readInterfaceFile(module, path, sourceHash);
+    }
+    if (!entry) {
+      entry = parseModule(module, sourceHash);
+      if (!m_interfaceDirectory.empty()) {
+        InterfaceFile::write(path, entry->interface, entry->record);
+      }
+    }
+    if (m_moduleCache) {
+      m_moduleCache->store(sourceHash, *entry);
+    }
+  }
+
+  module.interface = std::move(entry->interface);
+  module.definesMain = entry->record.definesMain;
+  for (size_t i = 0; i < module.files.size(); i++) {
+    m_files[module.files[i]].importNames = std::move(entry->record.fileImports[i]);
+  }
+}
+
+std::optional<ModuleCache::Entry> Project::readInterfaceFile(
+    const Module& module, const std::filesystem::path& path, ContentHash::Digest hash) const {
+  const std::optional<InterfaceFile> file = InterfaceFile::open(path);
+  if (!file || file->sourceHash() != hash) {
+    return std::nullopt;
+  }
+  std::optional<Sema::ModuleInterface> interface = file->interface(module.name);
+  InterfaceFile::Record record = file->record();
+  if (!interface || record.fileImports.size() != module.files.size()) {
+    return std::nullopt;
+  }
+  return ModuleCache::Entry{std::move(*interface), std::move(record)};
+}
+
+ModuleCache::Entry Project::parseModule(const Module& module, ContentHash::Digest hash) {
+  ModuleCache::Entry entry{{module.name, {}}, {hash, false, {}}};
+  for (const size_t fileIndex : module.files) {
+    File& file = m_files[fileIndex];
+    parseFile(file);
+
+    std::vector<std::string>& imports = entry.record.fileImports.emplace_back();
+    for (const auto& child : file.tree->children()) {
+      if (child->type() == NodeType::ModuleDeclaration && child->token()->value != module.name) {
+        fail(file.path, "Declares module " + child->token()->value.value() + " but is a source of " + module.name);
+      }
+      if (child->type() == NodeType::Import) {
+        imports.push_back(child->token()->value.value());
+      }
+      const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get());
+      entry.record.definesMain |= function && function->name() == "main";
+    }
+
+    try {
+      Sema::addExports(file.tree.get(), entry.interface);
+    } catch (const std::exception& e) {
+      fail(file.path, e.what());
+    }
+  }
+  return entry;
+}
+
+void Project::parseFile(File& file) {
+  try {
+    file.tree = Compiler::parse(file.source);
+  } catch (const std::exception& e) {
+    fail(file.path, e.what());
+  }
+}
+
+void Project::resolveImports() {
+  for (File& file : m_files) {
+    Module& module = m_modules[file.module];
+    for (const std::string& importName : file.importNames) {
+      const size_t imported = moduleIndex(importName);
+      if (imported == m_modules.size()) {
+        fail(file.path, "Imports unknown module " + importName);
+      }
+      // Files can always call the functions exported by the rest of their own module
+      if (imported != file.module) {
+        file.imports.push_back(imported);
+      }
+    }
+
+    for (const size_t imported : file.imports) {
+      if (std::ranges::find(module.imports, imported) == module.imports.end()) {
+        module.imports.push_back(imported);
+        m_modules[imported].dependents.push_back(file.module);
+      }
+    }
+  }
+}
+
+void Project::checkCycles() const {
+  enum class State { Unvisited, Visiting, Done };
+  std::vector<State> states(m_modules.size(), State::Unvisited);
+
+  const auto visit = [&](const auto& self, size_t index) -> void {
+    states[index] = State::Visiting;
+    for (const size_t imported : m_modules[index].imports) {
+      if (states[imported] == State::Visiting) {
+        throw BuildException(("Import cycle through module " + m_modules[imported].name).c_str());
+      }
+      if (states[imported] == State::Unvisited) {
+        self(self, imported);
+      }
+    }
+    states[index] = State::Done;
+  };
+
+  for (size_t i = 0; i < m_modules.size(); i++) {
+    if (states[i] == State::Unvisited) {
+      visit(visit, i);
+    }
+  }
+}
+
+void Project::compileModule(size_t index,
+                            ThreadPool& pool,
+                            const Compiler::Options& options,
+                            const std::filesystem::path& outputDirectory,
+                            BuildCache* cache) {
+  const Module& module = m_modules[index];
+
+  // Dependents only need the interface, so can start before this module's code is generated
+  for (const size_t dependent : module.dependents) {
+    if (m_waiting[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      pool.submit([this, dependent, &pool, &options, &outputDirectory, cache] {
+        compileModule(dependent, pool, options, outputDirectory, cache);
+      });
+    }
+  }
+
+  for (const size_t fileIndex : module.files) {
+    pool.submit([this, fileIndex, &options, &outputDirectory, cache] {
+      File& file = m_files[fileIndex];
+      const Trace::Span span(file.path.string(), Trace::Recorder::Category::File);
+      CompiledUnit& unit = m_units[fileIndex];
+      unit.source = file.path;
+      unit.module = m_modules[file.module].name;
+
+      unit.assembly = outputDirectory / (file.outputName + ".asm");
+
+      std::vector<const Sema::ModuleInterface*> imports{&m_modules[file.module].interface};
+      for (const size_t imported : file.imports) {
+        imports.push_back(&m_modules[imported].interface);
+      }
+
+      Compiler::Options fileOptions = options;
+      fileOptions.sourceName = file.path.string();
+
+      if (cache) {
+        unit.cacheKey = cache->key(file.source, fileOptions, imports);
+        if (std::optional<BuildCache::Entry> entry = cache->lookup(unit.cacheKey)) {
+          std::error_code error;
+          std::filesystem::copy_file(
+              entry->assembly, unit.assembly, std::filesystem::copy_options::overwrite_existing, error);
+          if (!error) {
+            unit.cachedObject = std::move(entry->object);
+            return;
+          }
+        }
+      }
+
+      if (!file.tree) {
+        parseFile(file);
+      }
+      try {
+        Compiler compiler(fileOptions);
+        Gen::FileSink sink(unit.assembly);
+        compiler.compile(std::move(file.tree), imports, sink, file.source);
+        sink.flush();
+      } catch (const std::exception& e) {
+        fail(file.path, e.what());
+      }
+    });
+  }
+}
+
+size_t Project::moduleIndex(std::string_view name) const {
+  for (size_t i = 0; i < m_modules.size(); i++) {
+    if (m_modules[i].name == name) {
+      return i;
+    }
+  }
+  return m_modules.size();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Build/ContentHash.h>
+#include <Build/ModuleCache.h>
+#include <Compiler.h>
+#include <Config.h>
+#include <Parser/Node/ParseNode.h>
+#include <Semantic/ModuleInterface.h>
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Cepheid::Build {
+class BuildCache;
+class ThreadPool;
+
+/// Assembly for one source file of a project
+struct CompiledUnit {
+  std::filesystem::path source;
+  std::string module;
+  /// File the assembly was written to
+  std::filesystem::path assembly;
+  /// Key to store the unit's object under, if the build has a cache
+  std::string cacheKey;
+  /// Object found in the cache, in which case the unit needn't be assembled
+  std::filesystem::path cachedObject;
+};
+
+/**
+ * Compiles every source file of a project.
+ *
+ * Files are grouped into the modules the config declares and ordered by their imports. A module is compiled as soon as
+ * every module it imports has published its interface, with a task for each of its files, so modules that don't
+ * depend on each other are compiled at the same time. With a cache, files whose source, options and imported
+ * interfaces are unchanged aren't compiled at all.
+ *
+ * Given an interface directory, each module's interface is written there as an InterfaceFile. A module whose sources
+ * haven't changed since is read back from that file instead of being parsed, so a file is only parsed if it has to be
+ * compiled.
+ */
+class Project {
+ public:
+  /**
+   * Source paths in the config are relative to root. Interface files aren't used if interfaceDirectory is empty, and a
+   * module cache lets a long running compiler keep interfaces from one build to the next.
+   */
+  Project(const Config& config,
+          std::filesystem::path root,
+          std::filesystem::path interfaceDirectory = {},
+          ModuleCache* moduleCache = nullptr);
+
+  /**
+   * Compile every file, throwing a BuildException naming the file for the first error. Each file's assembly is written
+   * to outputDirectory as it's generated, named after the file's path relative to the root.
+   */
+  [[nodiscard]] std::vector<CompiledUnit> build(ThreadPool& pool,
+                                                const Compiler::Options& options,
+                                                const std::filesystem::path& outputDirectory,
+                                                BuildCache* cache = nullptr);
+
+ private:
+  struct File {
+    std::filesystem::path path;
+    /// What the file's assembly and object are called in the output directory, unique within the project
+    std::string outputName;
+    size_t module;
+    std::string source;
+    /// Only parsed if the module's interface file is stale, or the file has to be compiled
+    Parser::Nodes::NodePtr tree;
+    std::vector<std::string> importNames;
+    std::vector<size_t> imports;
+  };
+
+  struct Module {
+    std::string name;
+    std::vector<size_t> files;
+    std::vector<size_t> imports;
+    std::vector<size_t> dependents;
+    Sema::ModuleInterface interface;
+    bool definesMain = false;
+  };
+
+  void readSources(ThreadPool& pool);
+  void loadModule(Module& module);
+  [[nodiscard]] std::optional<ModuleCache::Entry> readInterfaceFile(
+      const Module& module, const std::filesystem::path& path, ContentHash::Digest hash) const;
+  [[nodiscard]] ModuleCache::Entry parseModule(const Module& module, ContentHash::Digest hash);
+  void parseFile(File& file);
+  void resolveImports();
+  void checkCycles() const;
+  void compileModule(size_t module,
+                     ThreadPool& pool,
+                     const Compiler::Options& options,
+                     const std::filesystem::path& outputDirectory,
+                     BuildCache* cache);
+
+  [[nodiscard]] size_t moduleIndex(std::string_view name) const;
+
+  std::filesystem::path m_root;
+  std::filesystem::path m_interfaceDirectory;
+  ModuleCache* m_moduleCache;
+  std::vector<File> m_files;
+  std::vector<Module> m_modules;
+  // Imports of each module that haven't published their interface yet
+  std::unique_ptr<std::atomic<size_t>[]> m_waiting;
+  std::vector<CompiledUnit> m_units;
+};
+
+}  // namespace Cepheid::Build
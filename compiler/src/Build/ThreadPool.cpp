@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+
+#include <Trace/Trace.h>
+
+#include <algorithm>
+#include <utility>
+
+using namespace Cepheid::Build;
+
+namespace {
+// Lets a task submit to the queue of the worker running it
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (size_t i = 0; i < threadCount; i++) {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threadCount; i++) {
+    m_threads.emplace_back([this, i] { run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  // Tasks are traced with whatever the submitting thread was tracing with
+  if (Trace::Recorder* recorder = Trace::current()) {
+    task = [recorder, task = std::move(task)] {
+      const Trace::Scope scope(recorder);
+      task();
+    };
+  }
+
+  size_t index;
+  {
+    std::lock_guard lock(m_mutex);
+    // Counted before it's queued, so wait can't see an empty pool while a task is on its way in
+    m_queued++;
+    m_pending++;
+    index = currentPool == this ? currentWorker : m_nextWorker++ % m_workers.size();
+  }
+  {
+    Worker& worker = *m_workers[index];
+    std::lock_guard lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  m_wake.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_pending == 0; });
+  if (m_error) {
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+  }
+}
+
+size_t ThreadPool::threadCount() const {
+  return m_threads.size();
+}
+
+void ThreadPool::run(size_t index) {
+  currentPool = this;
+  currentWorker = index;
+
+  while (true) {
+    std::optional<Task> task = take(index);
+    if (!task) {
+      std::unique_lock lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stopping || m_queued > 0; });
+      if (m_stopping && m_queued == 0) {
+        return;
+      }
+      continue;
+    }
+
+    {
+      std::lock_guard lock(m_mutex);
+      m_queued--;
+    }
+
+    std::exception_ptr error;
+    try {
+      (*task)();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (error && !m_error) {
+      m_error = error;
+    }
+    if (--m_pending == 0) {
+      m_idle.notify_all();
+    }
+  }
+}
+
+std::optional<ThreadPool::Task> ThreadPool::take(size_t index) {
+  {
+    Worker& worker = *m_workers[index];
+    std::lock_guard lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      Task task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+      return task;
+    }
+  }
+
+  // Steal the oldest task from the next worker that has one
+  for (size_t i = 1; i < m_workers.size(); i++) {
+    Worker& victim = *m_workers[(index + i) % m_workers.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      Task task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return task;
+    }
+  }
+  return std::nullopt;
+}
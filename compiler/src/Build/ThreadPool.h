@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Cepheid::Build {
+/**
+ * Fixed size pool of worker threads, each with a queue of its own.
+ *
+ * A worker runs the newest task in its own queue first, so the tasks a task submits run next on the same thread, and
+ * steals the oldest task from another worker's queue when its own is empty. Tasks submitted from outside the pool are
+ * spread over the workers in turn.
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /// One worker per hardware thread by default
+  explicit ThreadPool(size_t threadCount = 0);
+  ThreadPool(const ThreadPool& other) = delete;
+  ThreadPool(ThreadPool&& other) noexcept = delete;
+  ThreadPool& operator=(const ThreadPool& other) = delete;
+  ThreadPool& operator=(ThreadPool&& other) noexcept = delete;
+  ~ThreadPool();
+
+  void submit(Task task);
+
+  /// Block until every submitted task has finished, rethrowing the first exception a task threw. Not for use in a task.
+  void wait();
+
+  [[nodiscard]] size_t threadCount() const;
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void run(size_t index);
+  [[nodiscard]] std::optional<Task> take(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  // Tasks sitting in a queue, and tasks submitted but not yet finished
+  size_t m_queued = 0;
+  size_t m_pending = 0;
+  size_t m_nextWorker = 0;
+  bool m_stopping = false;
+  std::exception_ptr m_error;
+};
+
+}  // namespace Cepheid::Build
@@ -1,13 +1,142 @@
 #include "Compiler.h"
 
 #include <Generator/Generator.h>
+#include <Generator/OutputSink.h>
 #include <Parser/Parser.h>
+#include <Semantic/TypeChecker.h>
+#include <Tokeniser/LineTable.h>
 #include <Tokeniser/Tokenizer.h>
+#include <Trace/Trace.h>
 
 using namespace Cepheid;
 
-std::string Compiler::compile(std::string_view src) const {
-  std::vector<Tokens::Token> tokens = Tokens::Tokeniser(src).tokenise();
-  std::unique_ptr<Parser::Nodes::Node> parseTree = Parser::Parser(tokens).parse();
-  return Gen::Generator(std::move(parseTree)).generate();
+namespace {
+/// Counts the instructions passing through to another sink, for the generate span
+class CountingSink : public Gen::OutputSink {
+ public:
+  explicit CountingSink(Gen::OutputSink& sink) : m_sink(sink) {
+  }
+
+  void write(std::string_view text) override {
+    m_instructions += Gen::instructionCount(text);
+    m_sink.write(text);
+  }
+
+  void flush() override {
+    m_sink.flush();
+  }
+
+  [[nodiscard]] size_t instructions() const {
+    return m_instructions;
+  }
+
+ private:
+  Gen::OutputSink& m_sink;
+  size_t m_instructions = 0;
+};
+}  // namespace
+
+Compiler::Compiler(Options options) : m_options(std::move(options)) {
+}
+
+std::string Compiler::compile(std::string_view src) {
+  Gen::StringSink sink;
+  compile(src, sink);
+  return sink.take();
+}
+
+void Compiler::compile(std::string_view src, Gen::OutputSink& sink) {
+  // Trees never outlive the compilation that made them, so the last one has gone by now
+  m_arena.reset();
+  const Parser::Nodes::NodeArena::Scope scope(&m_arena);
+  compile(parse(src), {}, sink, src);
+}
+
+std::vector<Compiler::Result> Compiler::compileBatch(std::span<const std::string_view> sources) {
+  std::vector<Result> results;
+  results.reserve(sources.size());
+  for (const std::string_view src : sources) {
+    Result& result = results.emplace_back();
+    try {
+      result.assembly = compile(src);
+      result.deadCode = m_deadCodeReport;
+      result.interprocedural = m_interproceduralReport;
+      result.functionStats = std::move(m_functionStats);
+    } catch (const std::exception& e) {
+      result.error = e.what();
+    }
+  }
+  return results;
+}
+
+std::string Compiler::compile(Parser::Nodes::NodePtr parseTree, std::span<const Sema::ModuleInterface* const> imports) {
+  Gen::StringSink sink;
+  compile(std::move(parseTree), imports, sink);
+  return sink.take();
+}
+
+void Compiler::compile(Parser::Nodes::NodePtr parseTree,
+                       std::span<const Sema::ModuleInterface* const> imports,
+                       Gen::OutputSink& sink,
+                       std::string_view src) {
+  Sema::ExpressionTypes types;
+  {
+    const Trace::Span span("type check");
+    types = Sema::TypeChecker().run(parseTree.get(), imports);
+  }
+  {
+    // Runs after checking, so that removing code doesn't change which programs are accepted
+    const Trace::Span span("optimise");
+    m_deadCodeReport = Opt::DeadCodeElimination().run(parseTree.get());
+  }
+  {
+    // Needs the types, and runs after checking them so that errors in functions it removes are still reported
+    const Trace::Span span("interprocedural");
+    m_interproceduralReport = Opt::Interprocedural().run(parseTree.get(), types);
+  }
+
+  Trace::Span span("generate");
+  std::optional<Tokens::LineTable> lines;
+  if (m_options.debugInfo && !src.empty()) {
+    lines.emplace(src);
+  }
+  const Gen::GeneratorOptions generatorOptions{m_options.instrument,
+                                               m_options.profile ? &*m_options.profile : nullptr,
+                                               m_options.stats,
+                                               lines ? &*lines : nullptr,
+                                               m_options.sourceName,
+                                               m_options.ifConversionCost,
+                                               m_options.target};
+  Gen::Generator generator(std::move(parseTree), std::move(types), generatorOptions);
+  if (span.isRecording()) {
+    CountingSink counter(sink);
+    generator.generate(counter);
+    span.count(Trace::Recorder::Counter::Instructions, counter.instructions());
+  } else {
+    generator.generate(sink);
+  }
+  m_functionStats = generator.functionStats();
+}
+
+Parser::Nodes::NodePtr Compiler::parse(std::string_view src) {
+  std::vector<Tokens::Token> tokens;
+  {
+    Trace::Span span("tokenise");
+    tokens = Tokens::Tokeniser(src).tokenise();
+    span.count(Trace::Recorder::Counter::Tokens, tokens.size());
+  }
+  const Trace::Span span("parse");
+  return Parser::Parser(tokens, src).parse();
+}
+
+const Opt::DeadCodeElimination::Report& Compiler::deadCodeReport() const {
+  return m_deadCodeReport;
+}
+
+const Opt::Interprocedural::Report& Compiler::interproceduralReport() const {
+  return m_interproceduralReport;
+}
+
+const std::vector<Gen::FunctionStats>& Compiler::functionStats() const {
+  return m_functionStats;
 }
@@ -1,10 +1,91 @@
 #pragma once
 
+#include <Generator/CodeStats.h>
+#include <Generator/InstructionSelection.h>
+#include <Generator/OutputSink.h>
+#include <Generator/Profile.h>
+#include <Generator/Target.h>
+#include <Optimiser/DeadCodeElimination.h>
+#include <Optimiser/Interprocedural.h>
+#include <Parser/Node/NodeArena.h>
+#include <Parser/Node/ParseNode.h>
+#include <Semantic/ModuleInterface.h>
+
+#include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace Cepheid {
+/**
+ * Compiles Cepheid source to NASM assembly.
+ *
+ * Compilations share no mutable state, so separate Compilers can run on different threads at once. A Compiler is only
+ * used by one thread at a time, as it keeps the reports and node arena of its last compilation.
+ */
 class Compiler {
  public:
-  [[nodiscard]] std::string compile(std::string_view src) const;
+  struct Options {
+    /// Build a program that writes branch and loop counts to a profile when it exits
+    bool instrument = false;
+    /// Profile from an instrumented run to optimise for
+    std::optional<Gen::Profile> profile;
+    /// Measure the code generated for each function, for functionStats
+    bool stats = false;
+    /// Mark the generated code with the source lines it came from, which the assembler turns into line information
+    bool debugInfo = false;
+    /// Path of the source being compiled, as named by the line information
+    std::string sourceName;
+    /// Most an if body's value may cost to be stored with a conditional move instead of branched around, 0 for never
+    size_t ifConversionCost = Gen::defaultIfConversionCost;
+    /// Processor the program has to run on, which decides how intrinsics are generated
+    Gen::Target target;
+  };
+
+  /// Outcome of compiling one source of a batch
+  struct Result {
+    std::string assembly;
+    /// Why the source didn't compile, empty if it did
+    std::string error;
+    Opt::DeadCodeElimination::Report deadCode;
+    Opt::Interprocedural::Report interprocedural;
+    std::vector<Gen::FunctionStats> functionStats;
+  };
+
+  /// Changed whenever the generated code changes, so output cached by an older compiler isn't reused
+  static constexpr std::string_view version = "0.1.1";
+
+  Compiler() = default;
+  explicit Compiler(Options options);
+
+  [[nodiscard]] std::string compile(std::string_view src);
+  /// Compile to a sink, which is written a function at a time as the code is generated
+  void compile(std::string_view src, Gen::OutputSink& sink);
+
+  /// Compile each source in turn, reusing the same arena for every parse tree. A source that fails to compile is
+  /// reported in its result rather than stopping the batch.
+  [[nodiscard]] std::vector<Result> compileBatch(std::span<const std::string_view> sources);
+
+  /// Compile a parsed source file of a project, which can call the functions exported by the modules it imports
+  [[nodiscard]] std::string compile(
+      Parser::Nodes::NodePtr parseTree, std::span<const Sema::ModuleInterface* const> imports);
+  /// The tree's source is only needed to write line information
+  void compile(Parser::Nodes::NodePtr parseTree,
+               std::span<const Sema::ModuleInterface* const> imports,
+               Gen::OutputSink& sink,
+               std::string_view src = {});
+
+  [[nodiscard]] static Parser::Nodes::NodePtr parse(std::string_view src);
+
+  [[nodiscard]] const Opt::DeadCodeElimination::Report& deadCodeReport() const;
+  [[nodiscard]] const Opt::Interprocedural::Report& interproceduralReport() const;
+  [[nodiscard]] const std::vector<Gen::FunctionStats>& functionStats() const;
+
+ private:
+  Options m_options;
+  Parser::Nodes::NodeArena m_arena;
+  Opt::DeadCodeElimination::Report m_deadCodeReport;
+  Opt::Interprocedural::Report m_interproceduralReport;
+  std::vector<Gen::FunctionStats> m_functionStats;
 };
 }  // namespace Cepheid
@@ -10,12 +10,34 @@ std::string_view Cepheid::Config::description() const {
   return m_description;
 }
 
+const std::vector<std::string>& Cepheid::Config::sources() const {
+  return m_sources;
+}
+
+const std::vector<Cepheid::ModuleConfig>& Cepheid::Config::modules() const {
+  return m_modules;
+}
+
+void Cepheid::to_json(nlohmann::json& json, const ModuleConfig& module) {
+  json = nlohmann::json{{"name", module.name}, {"sources", module.sources}};
+}
+
+void Cepheid::from_json(const nlohmann::json& json, ModuleConfig& module) {
+  json.at("name").get_to(module.name);
+  module.sources = json.value("sources", std::vector<std::string>{});
+}
+
 void Cepheid::to_json(nlohmann::json& json, const Config& config) {
-  json = nlohmann::json{{"name", config.m_name}, {"description", config.m_description}};
+  json = nlohmann::json{{"name", config.m_name},
+                        {"description", config.m_description},
+                        {"sources", config.m_sources},
+                        {"modules", config.m_modules}};
 }
 
 #define GET_VALUE(config, json, key, default) config.m_##key = json.value(#key, default)
 void Cepheid::from_json(const nlohmann::json& json, Config& config) {
   GET_VALUE(config, json, name, "");
   GET_VALUE(config, json, description, "");
+  GET_VALUE(config, json, sources, std::vector<std::string>{});
+  GET_VALUE(config, json, modules, std::vector<ModuleConfig>{});
 }
@@ -2,19 +2,35 @@
 
 #include <nlohmann/json_fwd.hpp>
 #include <string>
+#include <vector>
 
 namespace Cepheid {
+/// A named group of source files, which other modules can import
+struct ModuleConfig {
+  std::string name;
+  std::vector<std::string> sources;
+};
+
+void to_json(nlohmann::json& json, const ModuleConfig& module);
+void from_json(const nlohmann::json& json, ModuleConfig& module);
+
 class Config {
  public:
   [[nodiscard]] std::string_view name() const;
   [[nodiscard]] std::string_view description() const;
 
+  /// Source files of the project's own module, which is named after the project
+  [[nodiscard]] const std::vector<std::string>& sources() const;
+  [[nodiscard]] const std::vector<ModuleConfig>& modules() const;
+
   friend void to_json(nlohmann::json& json, const Config& config);
   friend void from_json(const nlohmann::json& json, Config& config);
  private:
   std::string m_name;
   std::string m_description;
+  std::vector<std::string> m_sources;
+  std::vector<ModuleConfig> m_modules;
 };
 
 
-}  // namespace Cepheid
\ No newline at end of file
+}  // namespace Cepheid
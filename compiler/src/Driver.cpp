@@ -0,0 +1,441 @@
+#include "Driver.h"
+
+#include <Build/BuildCache.h>
+#include <Build/BuildException.h>
+#include <Build/Project.h>
+#include <Build/ThreadPool.h>
+#include <Compiler.h>
+#include <Config.h>
+#include <Generator/CodeStats.h>
+#include <Generator/OutputSink.h>
+#include <Generator/Target.h>
+#include <Trace/Trace.h>
+
+#include <nlohmann/json.hpp>
+
+#include <charconv>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+using namespace Cepheid;
+
+namespace {
+/// Nothing unless the whole of text is a number that isn't negative
+std::optional<uintmax_t> parseNumber(std::string_view text) {
+  uintmax_t value = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (text.empty() || error != std::errc{} || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+/// argv[0] is only a path to the executable when it was run by one, rather than found on the PATH
+std::filesystem::path runningExecutable(const char* executable) {
+#ifdef _WIN32
+  std::wstring path(MAX_PATH, L'\0');
+  while (const DWORD length = GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size()))) {
+    if (length < path.size()) {
+      path.resize(length);
+      return path;
+    }
+    path.resize(path.size() * 2);
+  }
+#else
+  std::error_code error;
+  std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+  if (!error) {
+    return path;
+  }
+#endif
+  return executable;
+}
+
+void printCacheStats(const Build::BuildCache& cache, std::ostream& out) {
+  const Build::BuildCache::Stats stats = cache.stats();
+  out << "Build cache:\n"
+      << "  hits: " << stats.hits << "\n"
+      << "  misses: " << stats.misses << "\n"
+      << "  stores: " << stats.stores << "\n"
+      << "  evictions: " << stats.evictions << std::endl;
+}
+
+/// Paths are quoted, as resolving them against the working directory can introduce spaces
+std::string linkCommand(const std::vector<std::filesystem::path>& objects,
+                        const std::filesystem::path& output,
+                        bool debugInfo) {
+  std::stringstream link;
+  link << "\"C:\\Program Files\\Microsoft Visual "
+          "Studio\\2022\\Community\\VC\\Auxiliary\\Build\\vcvarsall.bat\" amd64 10.0.22000.0 && ";
+  link << "link.exe";
+  for (const std::filesystem::path& object : objects) {
+    link << " \"" << object.string() << "\"";
+  }
+  link << " /subsystem:console /entry:_entry /out:\"" << output.string() << "\" kernel32.lib msvcrt.lib";
+  if (debugInfo) {
+    link << " /debug";
+  }
+  return link.str();
+}
+
+/// Line information is written as CodeView, the only debug format NASM has for win64 objects
+std::string assembleCommand(const std::filesystem::path& assembly,
+                            const std::filesystem::path& object,
+                            bool debugInfo) {
+  return std::string("nasm -f win64 ") + (debugInfo ? "-g -F cv8 " : "") + "-o \"" + object.string() + "\" \"" +
+         assembly.string() + "\" 2>&1";
+}
+
+/// Compile every source of a project on a pool of threads, then assemble each file and link them together
+int buildProject(const std::filesystem::path& configPath,
+                 const std::filesystem::path& output,
+                 const std::filesystem::path& buildDir,
+                 const Compiler::Options& options,
+                 Build::BuildCache* cache,
+                 Build::ModuleCache* moduleCache,
+                 std::ostream& out,
+                 std::ostream& err) {
+  if (options.instrument) {
+    // Every file would define its own counters and profile writer
+    err << "--instrument is only supported for single file builds" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream configFile(configPath);
+  if (!configFile) {
+    err << "Unable to open project " << configPath << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    const auto config = nlohmann::json::parse(configFile).get<Config>();
+    const std::filesystem::path root = configPath.parent_path();
+    std::filesystem::create_directories(buildDir);
+
+    Build::ThreadPool pool;
+    Build::Project project(config, root, buildDir, moduleCache);
+    const std::vector<Build::CompiledUnit> units = project.build(pool, options, buildDir, cache);
+
+    std::vector<std::filesystem::path> objects;
+    for (const Build::CompiledUnit& unit : units) {
+      const std::filesystem::path objPath = std::filesystem::path(unit.assembly).replace_extension(".obj");
+      objects.push_back(objPath);
+
+      // Another build trimming the cache can remove the object after the lookup, leaving it to be assembled again
+      if (!unit.cachedObject.empty()) {
+        const Trace::Span span("write");
+        std::error_code error;
+        std::filesystem::copy_file(
+            unit.cachedObject, objPath, std::filesystem::copy_options::overwrite_existing, error);
+        if (!error) {
+          continue;
+        }
+      }
+      pool.submit([&unit, objPath, cache, &options] {
+        {
+          const Trace::Span span("assemble");
+          if (system(assembleCommand(unit.assembly, objPath, options.debugInfo).c_str()) != 0) {
+            throw Build::BuildException(("Assemble failed for " + unit.assembly.string()).c_str());
+          }
+        }
+        if (cache) {
+          cache->store(unit.cacheKey, unit.assembly, objPath);
+        }
+      });
+    }
+    pool.wait();
+
+    const Trace::Span span("link");
+    if (int ret = system(linkCommand(objects, output, options.debugInfo).c_str()); ret != 0) {
+      out << "Link failed with code:" << ret << std::endl;
+      return ret;
+    }
+  } catch (const std::exception& e) {
+    err << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+/// Compile a single source file, then assemble and link it
+int buildFile(const std::filesystem::path& input,
+              const std::filesystem::path& output,
+              Compiler::Options options,
+              bool optReport,
+              bool stats,
+              Build::BuildCache* cache,
+              std::ostream& out,
+              std::ostream& err) {
+  std::string src;
+  {
+    const Trace::Span span("read");
+    std::ifstream infile(input);
+    std::stringstream ss;
+    ss << infile.rdbuf();
+    src = ss.str();
+  }
+
+  // Named after the output, so builds of different outputs from one directory, as a server runs them, don't collide
+  const bool debugInfo = options.debugInfo;
+  const std::filesystem::path asmPath = std::filesystem::path(output).replace_extension(".asm");
+  const std::filesystem::path objPath = std::filesystem::path(output).replace_extension(".obj");
+
+  // The reports come from compiling, so asking for one skips the lookup
+  const std::string cacheKey = cache ? cache->key(src, options) : std::string();
+  std::optional<Build::BuildCache::Entry> cached;
+  if (cache && !optReport && !stats) {
+    cached = cache->lookup(cacheKey);
+  }
+
+  // Another build trimming the cache can remove the entry after the lookup, which is then compiled as a miss
+  if (cached) {
+    const Trace::Span span("write");
+    std::error_code error;
+    std::filesystem::copy_file(cached->assembly, asmPath, std::filesystem::copy_options::overwrite_existing, error);
+    if (!error) {
+      std::filesystem::copy_file(cached->object, objPath, std::filesystem::copy_options::overwrite_existing, error);
+    }
+    if (error) {
+      cached.reset();
+    }
+  }
+  if (!cached) {
+    options.stats = stats;
+    Compiler cep(std::move(options));
+    try {
+      // Functions are written out as they're generated rather than holding the whole program in memory
+      Gen::FileSink sink(asmPath);
+      cep.compile(src, sink);
+      sink.flush();
+    } catch (const std::exception& e) {
+      err << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (optReport) {
+      const auto& report = cep.deadCodeReport();
+      out << "Dead code elimination:\n"
+          << "  unreachable statements: " << report.unreachableStatements << "\n"
+          << "  pure expression statements: " << report.pureExpressions << "\n"
+          << "  dead stores: " << report.deadStores << "\n"
+          << "  unused variables: " << report.unusedVariables << "\n";
+      const auto& calls = cep.interproceduralReport();
+      out << "Interprocedural:\n"
+          << "  unreachable functions: " << calls.unreachableFunctions << "\n"
+          << "  constant parameters: " << calls.constantParameters << "\n"
+          << "  constant calls: " << calls.constantCalls << std::endl;
+    }
+    if (stats) {
+      out << "Function stats:\n";
+      Gen::writeStats(out, cep.functionStats());
+      out << std::flush;
+    }
+
+    {
+      const Trace::Span span("assemble");
+      if (int ret = system(assembleCommand(asmPath, objPath, debugInfo).c_str()); ret != 0) {
+        out << "Assemble failed with code:" << ret << std::endl;
+        return ret;
+      }
+    }
+    if (cache) {
+      cache->store(cacheKey, asmPath, objPath);
+    }
+  }
+
+  const Trace::Span span("link");
+  if (int ret = system(linkCommand({objPath}, output, debugInfo).c_str()); ret != 0) {
+    out << "Link failed with code:" << ret << std::endl;
+    return ret;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+Driver::Driver(std::string compilerIdentity, Build::ModuleCache* moduleCache)
+    : m_compilerIdentity(std::move(compilerIdentity)), m_moduleCache(moduleCache) {
+}
+
+int Driver::run(std::span<const std::string> argList,
+                const std::filesystem::path& directory,
+                std::ostream& out,
+                std::ostream& err) const {
+  if (argList.empty()) {
+    out << usage() << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const auto resolve = [&directory](std::string_view path) { return directory / std::filesystem::path(path); };
+
+  std::vector<std::string> args;
+  bool optReport = false;
+  bool stats = false;
+  bool useCache = true;
+  bool cacheStats = false;
+  bool timeReport = false;
+  std::filesystem::path tracePath;
+  std::filesystem::path cacheDir = resolve(".cepheid-cache");
+  uintmax_t cacheSize = 512;
+  Compiler::Options options;
+  for (auto arg = argList.begin(); arg != argList.end(); ++arg) {
+    if (*arg == "--opt-report") {
+      optReport = true;
+    } else if (*arg == "--stats") {
+      stats = true;
+    } else if (*arg == "--debug-info") {
+      options.debugInfo = true;
+    } else if (*arg == "--instrument") {
+      options.instrument = true;
+    } else if (*arg == "--if-convert-cost") {
+      if (++arg == argList.end()) {
+        err << "--if-convert-cost needs a cost.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      const std::optional<uintmax_t> cost = parseNumber(*arg);
+      if (!cost) {
+        err << "--if-convert-cost needs a cost, not " << *arg << ".\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      options.ifConversionCost = *cost;
+    } else if (*arg == "--target") {
+      if (++arg == argList.end()) {
+        err << "--target needs a processor level.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      const std::optional<Gen::Target> target = Gen::Target::level(*arg);
+      if (!target) {
+        err << "Unknown target " << *arg << ", expected x86-64, x86-64-v2, x86-64-v3 or x86-64-v4" << std::endl;
+        return EXIT_FAILURE;
+      }
+      options.target = *target;
+    } else if (*arg == "--profile-use") {
+      if (++arg == argList.end()) {
+        err << "--profile-use needs a profile.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      std::ifstream profileFile{resolve(*arg)};
+      if (!profileFile) {
+        err << "Unable to open profile " << *arg << std::endl;
+        return EXIT_FAILURE;
+      }
+      options.profile = Gen::Profile::read(profileFile);
+    } else if (*arg == "--cache-dir") {
+      if (++arg == argList.end()) {
+        err << "--cache-dir needs a directory.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      cacheDir = resolve(*arg);
+    } else if (*arg == "--cache-size") {
+      if (++arg == argList.end()) {
+        err << "--cache-size needs a size in MiB.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      const std::optional<uintmax_t> size = parseNumber(*arg);
+      if (!size || *size > std::numeric_limits<uintmax_t>::max() / (1024 * 1024)) {
+        err << "--cache-size needs a size in MiB, not " << *arg << ".\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      cacheSize = *size;
+    } else if (*arg == "--cache-stats") {
+      cacheStats = true;
+    } else if (*arg == "--no-cache") {
+      useCache = false;
+    } else if (*arg == "--time-report") {
+      timeReport = true;
+    } else if (arg->starts_with("--trace=")) {
+      tracePath = resolve(std::string_view(*arg).substr(std::string_view("--trace=").size()));
+    } else if (*arg == "--trace") {
+      if (++arg == argList.end()) {
+        err << "--trace needs a file.\n" << usage() << std::endl;
+        return EXIT_FAILURE;
+      }
+      tracePath = resolve(*arg);
+    } else {
+      args.push_back(*arg);
+    }
+  }
+
+  if (args.size() != 2) {
+    err << "Invalid number of arguments.\n" << usage() << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path input = resolve(args[0]);
+  const std::filesystem::path output = resolve(args[1]);
+
+  std::unique_ptr<Build::BuildCache> cache;
+  if (useCache) {
+    cache = std::make_unique<Build::BuildCache>(cacheDir, cacheSize * 1024 * 1024, m_compilerIdentity);
+  }
+
+  std::unique_ptr<Trace::Recorder> recorder;
+  if (timeReport || !tracePath.empty()) {
+    recorder = std::make_unique<Trace::Recorder>(&Trace::allocationCount);
+  }
+
+  int ret;
+  {
+    const Trace::Scope scope(recorder.get());
+    if (args[0].ends_with(".json") && stats) {
+      // Units that come from the build cache were never generated to measure
+      err << "--stats is only supported for single file builds" << std::endl;
+      ret = EXIT_FAILURE;
+    } else if (args[0].ends_with(".json")) {
+      // Each output gets its own build directory, so concurrent builds of one project don't overwrite each other
+      const std::filesystem::path buildDir = resolve("build") / output.stem();
+      ret = buildProject(input, output, buildDir, options, cache.get(), m_moduleCache, out, err);
+    } else {
+      options.sourceName = input.string();
+      ret = buildFile(input, output, std::move(options), optReport, stats, cache.get(), out, err);
+    }
+  }
+
+  if (cache) {
+    cache->trim();
+    if (cacheStats) {
+      printCacheStats(*cache, out);
+    }
+  }
+  if (timeReport) {
+    recorder->writeTimeReport(out);
+  }
+  if (!tracePath.empty()) {
+    std::ofstream trace(tracePath);
+    recorder->writeChromeTrace(trace);
+    if (!trace) {
+      err << "Unable to write trace " << tracePath << std::endl;
+      return ret == EXIT_SUCCESS ? EXIT_FAILURE : ret;
+    }
+  }
+  return ret;
+}
+
+std::string_view Driver::usage() {
+  return "Usage: cepheid [--opt-report] [--stats] [--debug-info] [--instrument] [--profile-use <profile>] "
+         "[--if-convert-cost <cost>] [--target <level>] [--cache-dir <dir>] [--cache-size <MiB>] [--cache-stats] "
+         "[--no-cache] [--time-report] [--trace=<file.json>] <input.cep|cepheid.json> <output>\n"
+         "       cepheid --server [<socket>]";
+}
+
+std::string Driver::compilerIdentity(const char* executable) {
+  std::string identity{Compiler::version};
+  std::error_code error;
+  const std::filesystem::path path = std::filesystem::canonical(runningExecutable(executable), error);
+  if (!error) {
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    const auto modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (!error) {
+      identity += " " + std::to_string(size) + " " + std::to_string(modified);
+    }
+  }
+  return identity;
+}
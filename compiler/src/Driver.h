@@ -0,0 +1,41 @@
+#pragma once
+
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Cepheid::Build {
+class ModuleCache;
+}
+
+namespace Cepheid {
+/**
+ * The compiler's command line, run either by the executable itself or by a compile server on behalf of a client.
+ *
+ * Relative paths in the arguments are taken from the given directory rather than the process's working directory, and
+ * everything is printed to the given streams, so a server can run several invocations at once.
+ */
+class Driver {
+ public:
+  explicit Driver(std::string compilerIdentity, Build::ModuleCache* moduleCache = nullptr);
+
+  /// Run the command line without the executable name, returning the exit code
+  int run(std::span<const std::string> args,
+          const std::filesystem::path& directory,
+          std::ostream& out,
+          std::ostream& err) const;
+
+  [[nodiscard]] static std::string_view usage();
+
+  /// The compiler's version plus the size and modification time of its executable, so rebuilding it invalidates the
+  /// build cache. The executable is the one running, with the given path only used where that can't be found.
+  [[nodiscard]] static std::string compilerIdentity(const char* executable);
+
+ private:
+  std::string m_compilerIdentity;
+  Build::ModuleCache* m_moduleCache;
+};
+
+}  // namespace Cepheid
@@ -0,0 +1,483 @@
+#include "CodeStats.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace Cepheid::Gen;
+
+namespace {
+std::string_view trim(std::string_view text) {
+  const size_t start = text.find_first_not_of(' ');
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(start, text.find_last_not_of(' ') - start + 1);
+}
+
+/// An instruction's mnemonic followed by its operands, without any trailing comment
+std::vector<std::string_view> splitInstruction(std::string_view instruction) {
+  instruction = trim(instruction.substr(0, instruction.find(';')));
+  const size_t space = std::min(instruction.find(' '), instruction.size());
+  std::vector<std::string_view> parts{instruction.substr(0, space)};
+  std::string_view operands = instruction.substr(space);
+  while (!trim(operands).empty()) {
+    const size_t comma = std::min(operands.find(','), operands.size());
+    parts.push_back(trim(operands.substr(0, comma)));
+    operands.remove_prefix(std::min(comma + 1, operands.size()));
+  }
+  return parts;
+}
+
+std::optional<int64_t> parseInteger(std::string_view text) {
+  const bool negative = text.starts_with('-');
+  if (negative) {
+    text.remove_prefix(1);
+  }
+  int base = 10;
+  if (text.starts_with("0x")) {
+    text.remove_prefix(2);
+    base = 16;
+  }
+  uint64_t value = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+  if (text.empty() || error != std::errc() || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+}
+
+bool fitsByte(int64_t value) {
+  return value >= -128 && value <= 127;
+}
+
+struct RegisterInfo {
+  size_t size;
+  /// r8 to r15, which take a REX prefix to name
+  bool extended = false;
+  /// spl, bpl, sil and dil, which take a REX prefix to tell them apart from ah, ch, dh and bh
+  bool byteRex = false;
+  bool accumulator = false;
+};
+
+std::optional<RegisterInfo> registerInfo(std::string_view name) {
+  if (name.size() >= 2 && name[0] == 'r' && std::isdigit(static_cast<unsigned char>(name[1]))) {
+    const size_t digits = name.find_first_not_of("0123456789", 1);
+    const std::string_view suffix = digits == std::string_view::npos ? "" : name.substr(digits);
+    static constexpr std::array<std::pair<std::string_view, size_t>, 4> suffixes = {
+        {{"", 8}, {"d", 4}, {"w", 2}, {"b", 1}}};
+    for (const auto& [letter, size] : suffixes) {
+      if (suffix == letter) {
+        return RegisterInfo{size, true};
+      }
+    }
+    return std::nullopt;
+  }
+
+  static constexpr std::array<std::string_view, 8> words = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"};
+  for (size_t i = 0; i < words.size(); i++) {
+    if (name == words[i]) {
+      return RegisterInfo{2, false, false, i == 0};
+    }
+    if (name.size() == 3 && name.substr(1) == words[i] && (name[0] == 'r' || name[0] == 'e')) {
+      return RegisterInfo{name[0] == 'r' ? 8u : 4u, false, false, i == 0};
+    }
+  }
+  static constexpr std::array<std::string_view, 8> bytes = {"al", "cl", "dl", "bl", "ah", "ch", "dh", "bh"};
+  for (size_t i = 0; i < bytes.size(); i++) {
+    if (name == bytes[i]) {
+      return RegisterInfo{1, false, false, i == 0};
+    }
+  }
+  static constexpr std::array<std::string_view, 4> rexBytes = {"spl", "bpl", "sil", "dil"};
+  if (std::ranges::find(rexBytes, name) != rexBytes.end()) {
+    return RegisterInfo{1, false, true};
+  }
+  return std::nullopt;
+}
+
+struct Operand {
+  enum class Kind { Register, Memory, Immediate, Symbol };
+
+  Kind kind;
+  /// Bytes read or written, or 0 when the instruction decides
+  size_t size = 0;
+  bool accumulator = false;
+  /// Only encodable with a REX prefix
+  bool rex = false;
+  /// SIB and displacement bytes following the ModRM byte
+  size_t addressBytes = 0;
+  int64_t value = 0;
+};
+
+Operand parseAddress(std::string_view address, size_t size) {
+  std::string_view base;
+  bool baseExtended = false;
+  bool hasIndex = false;
+  bool indexExtended = false;
+  bool symbol = false;
+  int64_t displacement = 0;
+
+  bool negative = false;
+  while (!address.empty()) {
+    const size_t end = std::min(address.find_first_of("+-"), address.size());
+    std::string_view term = trim(address.substr(0, end));
+    if (term.starts_with("rel ")) {
+      term = trim(term.substr(4));
+    }
+    if (const size_t star = term.find('*'); star != std::string_view::npos) {
+      hasIndex = true;
+      indexExtended = registerInfo(trim(term.substr(0, star))).value_or(RegisterInfo{8}).extended;
+    } else if (const std::optional<RegisterInfo> reg = registerInfo(term)) {
+      if (base.empty()) {
+        base = term;
+        baseExtended = reg->extended;
+      } else {
+        hasIndex = true;
+        indexExtended = reg->extended;
+      }
+    } else if (const std::optional<int64_t> value = parseInteger(term)) {
+      displacement += negative ? -*value : *value;
+    } else if (!term.empty()) {
+      symbol = true;
+    }
+    negative = end < address.size() && address[end] == '-';
+    address.remove_prefix(std::min(end + 1, address.size()));
+  }
+
+  Operand operand{Operand::Kind::Memory, size};
+  operand.rex = baseExtended || indexExtended;
+  if (base.empty()) {
+    // A lone symbol is addressed relative to rip, anything else needs a SIB byte and a full displacement
+    operand.addressBytes = symbol && !hasIndex ? 4 : 5;
+    return operand;
+  }
+  // rsp and r12 as a base can only be encoded with a SIB byte, rbp and r13 only with a displacement
+  const bool sib = hasIndex || base == "rsp" || base == "r12";
+  size_t displacementBytes = 4;
+  if (!symbol && displacement == 0 && base != "rbp" && base != "r13") {
+    displacementBytes = 0;
+  } else if (!symbol && fitsByte(displacement)) {
+    displacementBytes = 1;
+  }
+  operand.addressBytes = sib + displacementBytes;
+  return operand;
+}
+
+Operand parseOperand(std::string_view text) {
+  static constexpr std::array<std::pair<std::string_view, size_t>, 4> sizes = {
+      {{"byte ", 1}, {"word ", 2}, {"dword ", 4}, {"qword ", 8}}};
+  size_t size = 0;
+  for (const auto& [keyword, bytes] : sizes) {
+    if (text.starts_with(keyword)) {
+      size = bytes;
+      text = trim(text.substr(keyword.size()));
+      break;
+    }
+  }
+
+  if (text.starts_with('[')) {
+    return parseAddress(text.substr(1, text.find(']') - 1), size);
+  }
+  if (const std::optional<RegisterInfo> reg = registerInfo(text)) {
+    return Operand{Operand::Kind::Register, reg->size, reg->accumulator, reg->extended || reg->byteRex};
+  }
+  if (const std::optional<int64_t> value = parseInteger(text)) {
+    return Operand{Operand::Kind::Immediate, size, false, false, 0, *value};
+  }
+  return Operand{Operand::Kind::Symbol, size};
+}
+
+bool isJump(std::string_view mnemonic) {
+  return mnemonic.starts_with('j');
+}
+
+struct Instruction {
+  size_t size;
+  /// Local label a branch jumps to, which decides whether it can be short
+  std::string_view target;
+  bool conditional = false;
+};
+
+/// Lengthen each branch that can't reach its target with a byte displacement until they all can, returning the size
+size_t layOut(std::vector<Instruction>& instructions, const std::unordered_map<std::string_view, size_t>& labels) {
+  std::vector<size_t> offsets(instructions.size() + 1);
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t i = 0; i < instructions.size(); i++) {
+      offsets[i + 1] = offsets[i] + instructions[i].size;
+    }
+    for (size_t i = 0; i < instructions.size(); i++) {
+      Instruction& instruction = instructions[i];
+      if (instruction.target.empty()) {
+        continue;
+      }
+      const auto label = labels.find(instruction.target);
+      const bool reaches =
+          label != labels.end() &&
+          fitsByte(static_cast<int64_t>(offsets[label->second]) - static_cast<int64_t>(offsets[i + 1]));
+      if (!reaches) {
+        // jmp rel32 is e9 plus the displacement, jcc rel32 is two opcode bytes plus it
+        instruction.size = instruction.conditional ? 6 : 5;
+        instruction.target = {};
+        changed = true;
+      }
+    }
+  }
+  return offsets.back();
+}
+
+void countMemoryAccesses(const std::vector<std::string_view>& parts, FunctionStats& stats) {
+  const std::string_view mnemonic = parts[0];
+  const auto memory = std::ranges::find_if(parts.begin() + 1, parts.end(), [](std::string_view operand) {
+    return operand.find('[') != std::string_view::npos;
+  });
+  const bool hasMemory = memory != parts.end();
+
+  if (mnemonic == "lea" || mnemonic == "nop") {
+    return;
+  }
+  if (mnemonic == "push") {
+    stats.stores++;
+    stats.loads += hasMemory;
+  } else if (mnemonic == "pop") {
+    stats.loads++;
+    stats.stores += hasMemory;
+  } else if (!hasMemory) {
+    return;
+  } else if (memory != parts.begin() + 1 || mnemonic == "cmp" || mnemonic == "test" || mnemonic == "call" ||
+             isJump(mnemonic) || mnemonic.starts_with("prefetch")) {
+    stats.loads++;
+  } else if (mnemonic == "mov" || mnemonic.starts_with("set")) {
+    stats.stores++;
+  } else {
+    // Read-modify-write
+    stats.loads++;
+    stats.stores++;
+  }
+}
+}  // namespace
+
+size_t Cepheid::Gen::encodedSize(std::string_view instruction) {
+  std::string text(instruction);
+  std::ranges::transform(text, text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  const std::vector<std::string_view> parts = splitInstruction(text);
+  const std::string_view mnemonic = parts[0];
+  std::vector<Operand> operands;
+  for (size_t i = 1; i < parts.size(); i++) {
+    operands.push_back(parseOperand(parts[i]));
+  }
+
+  // The operand size comes from a register where there is one, as movzx and movsx read a smaller memory operand
+  size_t size = 0;
+  const auto reg = std::ranges::find(operands, Operand::Kind::Register, &Operand::kind);
+  if (reg != operands.end()) {
+    size = reg->size;
+  } else if (const auto sized = std::ranges::find_if(operands, [](const Operand& op) { return op.size != 0; });
+             sized != operands.end()) {
+    size = sized->size;
+  }
+  const auto memory = std::ranges::find(operands, Operand::Kind::Memory, &Operand::kind);
+  const size_t modrm = 1 + (memory != operands.end() ? memory->addressBytes : 0);
+  const bool rex = std::ranges::any_of(operands, &Operand::rex);
+  // An operand size prefix for 16 bit operations, and a REX prefix for 64 bit ones or to reach the newer registers
+  const auto prefixes = [&](bool defaultsTo64 = false) -> size_t {
+    return (size == 2) + (rex || (size == 8 && !defaultsTo64));
+  };
+  const auto immediateSize = [&](const Operand& immediate) -> size_t {
+    return immediate.kind == Operand::Kind::Symbol || size == 0 ? 4 : std::min<size_t>(size, 4);
+  };
+  const auto isImmediate = [](const Operand& op) {
+    return op.kind == Operand::Kind::Immediate || op.kind == Operand::Kind::Symbol;
+  };
+  const auto isByteImmediate = [](const Operand& op) {
+    return op.kind == Operand::Kind::Immediate && fitsByte(op.value);
+  };
+
+  if (mnemonic == "ret" || mnemonic == "leave" || mnemonic == "nop" || mnemonic == "cdq") {
+    return 1;
+  }
+  if (mnemonic == "cqo" || mnemonic == "rdtsc" || mnemonic == "pause") {
+    return 2;
+  }
+  // An F3 prefix turns bsf and bsr into these
+  if (mnemonic == "popcnt" || mnemonic == "lzcnt" || mnemonic == "tzcnt") {
+    return 1 + prefixes() + 2 + modrm;
+  }
+  if (mnemonic == "bsf" || mnemonic == "bsr" || mnemonic.starts_with("prefetch")) {
+    return prefixes() + 2 + modrm;
+  }
+  if (mnemonic == "bswap") {
+    return prefixes() + 2;
+  }
+  if (mnemonic == "push" || mnemonic == "pop") {
+    if (!operands.empty() && isImmediate(operands[0])) {
+      return isByteImmediate(operands[0]) ? 2 : 5;
+    }
+    return prefixes(true) + (memory != operands.end() ? 1 + modrm : 1);
+  }
+  if (mnemonic == "call" || isJump(mnemonic)) {
+    if (!operands.empty() && operands[0].kind == Operand::Kind::Symbol) {
+      return mnemonic == "call" ? 5 : 2;
+    }
+    return prefixes(true) + 1 + modrm;
+  }
+  if (mnemonic.starts_with("set") || mnemonic.starts_with("cmov") || mnemonic == "movzx" || mnemonic == "movsx" ||
+      mnemonic == "bt") {
+    return prefixes() + 2 + modrm;
+  }
+
+  if (operands.size() == 2 && isImmediate(operands[1])) {
+    const Operand& immediate = operands[1];
+    if (mnemonic == "mov") {
+      if (operands[0].kind != Operand::Kind::Register) {
+        return prefixes() + 1 + modrm + immediateSize(immediate);
+      }
+      if (size < 8) {
+        return prefixes() + 1 + immediateSize(immediate);
+      }
+      // A sign extended 32 bit immediate, or else the full 64 bits
+      const bool fits = immediate.kind == Operand::Kind::Immediate &&
+                        immediate.value >= std::numeric_limits<int32_t>::min() &&
+                        immediate.value <= std::numeric_limits<int32_t>::max();
+      return prefixes() + 1 + (fits ? 1 + 4 : 8);
+    }
+
+    static constexpr std::array<std::string_view, 8> arithmetic = {
+        "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+    if (std::ranges::find(arithmetic, mnemonic) != arithmetic.end()) {
+      if (size == 1) {
+        return prefixes() + (operands[0].accumulator ? 1 : 1 + modrm) + 1;
+      }
+      if (isByteImmediate(immediate)) {
+        return prefixes() + 1 + modrm + 1;
+      }
+      return prefixes() + (operands[0].accumulator ? 1 : 1 + modrm) + immediateSize(immediate);
+    }
+    if (mnemonic == "test") {
+      return prefixes() + (operands[0].accumulator ? 1 : 1 + modrm) + immediateSize(immediate);
+    }
+    static constexpr std::array<std::string_view, 6> shifts = {"shl", "sal", "shr", "sar", "rol", "ror"};
+    if (std::ranges::find(shifts, mnemonic) != shifts.end()) {
+      return prefixes() + 1 + modrm + (immediate.value == 1 ? 0 : 1);
+    }
+  }
+
+  if (mnemonic == "imul" && operands.size() == 3) {
+    return prefixes() + 1 + modrm + (isByteImmediate(operands[2]) ? 1 : immediateSize(operands[2]));
+  }
+  if (mnemonic == "imul" && operands.size() == 2) {
+    return prefixes() + 2 + modrm;
+  }
+  if (mnemonic == "xchg" && size > 1 && memory == operands.end() &&
+      std::ranges::any_of(operands, &Operand::accumulator)) {
+    return prefixes() + 1;
+  }
+  return prefixes() + 1 + (operands.empty() ? 0 : modrm);
+}
+
+void Cepheid::Gen::measureFunctions(std::string_view assembly, std::span<FunctionStats> functions) {
+  std::unordered_map<std::string, FunctionStats*> byLabel;
+  for (FunctionStats& function : functions) {
+    byLabel.emplace("cep_" + function.name, &function);
+  }
+
+  FunctionStats* current = nullptr;
+  std::vector<Instruction> instructions;
+  std::unordered_map<std::string_view, size_t> labels;
+  const auto finish = [&] {
+    if (current) {
+      current->bytes = layOut(instructions, labels);
+    }
+    current = nullptr;
+    instructions.clear();
+    labels.clear();
+  };
+
+  while (!assembly.empty()) {
+    const size_t end = std::min(assembly.find('\n'), assembly.size());
+    const std::string_view line = assembly.substr(0, end);
+    assembly.remove_prefix(std::min(end + 1, assembly.size()));
+
+    const size_t start = line.find_first_not_of(' ');
+    // Comments and line directives aren't code
+    if (start == std::string_view::npos || line[start] == ';' || line[start] == '%') {
+      continue;
+    }
+    if (start == 0) {
+      // Local labels belong to the function before them, anything else ends it
+      const std::string_view label = line.substr(0, line.find(':'));
+      if (label.starts_with('.')) {
+        labels[label] = instructions.size();
+        continue;
+      }
+      finish();
+      if (const auto function = byLabel.find(std::string(label)); function != byLabel.end()) {
+        current = function->second;
+      }
+      continue;
+    }
+    if (!current) {
+      continue;
+    }
+
+    const std::string_view text = line.substr(start);
+    const std::vector<std::string_view> parts = splitInstruction(text);
+    current->instructions++;
+    countMemoryAccesses(parts, *current);
+
+    Instruction instruction{.size = encodedSize(text), .target = {}};
+    if (isJump(parts[0])) {
+      current->branches++;
+      // A jump through a table has no label to be short to
+      if (parts.size() > 1 && parts[1].find('[') == std::string_view::npos) {
+        instruction.target = parts[1];
+      }
+      instruction.conditional = parts[0] != "jmp";
+    }
+    instructions.push_back(instruction);
+  }
+  finish();
+}
+
+void Cepheid::Gen::writeStats(std::ostream& out, std::span<const FunctionStats> functions) {
+  static constexpr std::array<std::string_view, 10> columns = {
+      "instructions", "bytes", "loads", "stores", "branches", "frame", "registers", "tables", "bittests", "trees"};
+  size_t nameWidth = std::string_view("function").size();
+  for (const FunctionStats& function : functions) {
+    nameWidth = std::max(nameWidth, function.name.size());
+  }
+
+  const std::ios_base::fmtflags flags = out.flags();
+  out << std::left << std::setw(static_cast<int>(nameWidth)) << "function" << std::right;
+  for (const std::string_view column : columns) {
+    out << "  " << std::setw(std::max<int>(static_cast<int>(column.size()), 6)) << column;
+  }
+  out << "\n";
+  for (const FunctionStats& function : functions) {
+    const std::array<size_t, 10> values = {function.instructions,
+                                           function.bytes,
+                                           function.loads,
+                                           function.stores,
+                                           function.branches,
+                                           function.frameSize,
+                                           function.registerHighWater,
+                                           function.jumpTables,
+                                           function.bitTests,
+                                           function.decisionTrees};
+    out << std::left << std::setw(static_cast<int>(nameWidth)) << function.name << std::right;
+    for (size_t i = 0; i < columns.size(); i++) {
+      out << "  " << std::setw(std::max<int>(static_cast<int>(columns[i].size()), 6)) << values[i];
+    }
+    out << "\n";
+  }
+  out.flags(flags);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Cepheid::Gen {
+/// Code quality metrics of one generated function
+struct FunctionStats {
+  std::string name;
+  size_t instructions = 0;
+  /// Estimated from the instruction encodings, as the code is never assembled to measure it
+  size_t bytes = 0;
+  /// Memory operands read and written, counting pushes as stores and pops as loads
+  size_t loads = 0;
+  size_t stores = 0;
+  /// Conditional and unconditional jumps
+  size_t branches = 0;
+  /// Stack below the frame pointer, holding saved registers, locals and spill slots
+  size_t frameSize = 0;
+  /// Most registers holding values at once
+  size_t registerHighWater = 0;
+  /// Switches lowered to each form, chosen by the generator from how their values are spread
+  size_t jumpTables = 0;
+  size_t bitTests = 0;
+  size_t decisionTrees = 0;
+
+  bool operator==(const FunctionStats& other) const = default;
+};
+
+/**
+ * Fill in the counts measured from the assembly of each function, which the generator doesn't know until it has
+ * written it.
+ *
+ * Branches to labels within the function are taken to be short if they reach, as nasm assembles them.
+ */
+void measureFunctions(std::string_view assembly, std::span<FunctionStats> functions);
+
+/// Bytes an instruction encodes to, taking any branch as its short form
+[[nodiscard]] size_t encodedSize(std::string_view instruction);
+
+/// A row per function, with a header naming the columns
+void writeStats(std::ostream& out, std::span<const FunctionStats> functions);
+}  // namespace Cepheid::Gen
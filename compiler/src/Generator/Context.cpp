@@ -2,16 +2,25 @@
 
 #include <Generator/GenerationException.h>
 #include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/ValueType.h>
 
-#include <ranges>
+#include <algorithm>
+#include <limits>
 
 using namespace Cepheid::Gen;
 
-Context::RegisterContext::RegisterContext(Register reg) : reg(std::move(reg)) {
+std::string Context::VariableContext::address() const {
+  // Labels are addressed relative to rip, as the program is assembled with default rel
+  return symbol.empty() ? "[ rsp + " + std::to_string(offset) + " ]" : "[ " + symbol + " ]";
+}
+
+Context::RegisterContext::RegisterContext(Register reg, bool calleeSaved)
+    : reg(std::move(reg)), calleeSaved(calleeSaved) {
 }
 
 Context::RegisterHandle::RegisterHandle(RegisterContext* context) : m_context(context) {
   m_context->inUse = true;
+  m_context->used = true;
 }
 
 Context::RegisterHandle::~RegisterHandle() {
@@ -26,47 +35,84 @@ std::string Context::RegisterHandle::asAsm(size_t size) const {
   return m_context->reg.asAsm(size);
 }
 
-Context::Context() : m_impl(std::make_unique<ContextImpl>()) {
-  m_primitiveTypes = {{"i8", {1, 1}}, {"i16", {2, 2}}, {"i32", {4, 4}}, {"i64", {8, 8}}};
+Context::SpillHandle::SpillHandle(SpillContext* context)
+    : MemoryLocation("[ rsp + " + std::to_string(context->offset) + " ]"), m_context(context) {
+  m_context->inUse = true;
+}
+
+Context::SpillHandle::~SpillHandle() {
+  m_context->inUse = false;
+}
+
+Context::Context() {
+  // Primitive types live in the outermost scope, below anything a program declares
+  for (const Sema::PrimitiveType& primitive : Sema::primitiveTypes()) {
+    m_types.insert(m_names.intern(primitive.name), {primitive.type.size, primitive.type.size});
+  }
+  // Scratch registers are handed out first, as the callee saved ones cost a push and pop in the prologue
   m_registers = {
-      Register{Register::Kind::Original, "a"},
-      Register{Register::Kind::Original, "b"},
-      Register{Register::Kind::Original, "c"},
-      Register{Register::Kind::Original, "d"},
-      Register{Register::Kind::AMD64, "r8"},
-      Register{Register::Kind::AMD64, "r9"},
-      Register{Register::Kind::AMD64, "r10"},
-      Register{Register::Kind::AMD64, "r11"},
-      Register{Register::Kind::AMD64, "r12"},
-      Register{Register::Kind::AMD64, "r13"},
-      Register{Register::Kind::AMD64, "r14"},
-      Register{Register::Kind::AMD64, "r15"}};
+      {Register{Register::Kind::Original, "a"}},
+      {Register{Register::Kind::Original, "c"}},
+      {Register{Register::Kind::Original, "d"}},
+      {Register{Register::Kind::AMD64, "r8"}},
+      {Register{Register::Kind::AMD64, "r9"}},
+      {Register{Register::Kind::AMD64, "r10"}},
+      {Register{Register::Kind::AMD64, "r11"}},
+      {Register{Register::Kind::Original, "b"}, true},
+      {Register{Register::Kind::AMD64, "r12"}, true},
+      {Register{Register::Kind::AMD64, "r13"}, true},
+      {Register{Register::Kind::AMD64, "r14"}, true},
+      {Register{Register::Kind::AMD64, "r15"}, true}};
 }
 
 void Context::pushScope() {
-  auto newContext = std::make_unique<ContextImpl>();
-  newContext->stackOffset = m_impl->stackOffset;
-  for (const auto& [size, offset] : m_impl->variables | std::views::values) {
-    newContext->stackOffset += size;
-  }
-  newContext->parent = std::move(m_impl);
-  m_impl = std::move(newContext);
+  m_variables.pushScope();
+  m_types.pushScope();
 }
 
-void Context::pushFunction() {
+void Context::pushFunction(FrameLayout frame) {
+  m_frame = std::move(frame);
+  for (RegisterContext& reg : m_registers) {
+    reg.used = false;
+  }
+  m_registerHighWater = 0;
   pushScope();
 }
 
 void Context::popScope() {
-  m_impl = std::move(m_impl->parent);
+  m_variables.popScope();
+  m_types.popScope();
 }
 
 void Context::popFunction() {
   popScope();
+  m_frame = {};
+  m_spillSlots.clear();
   m_localLabels = 0;
 }
 
 void Context::addVariable(const Parser::Nodes::VariableDeclaration* variable) {
+  VariableContext varContext;
+  varContext.offset = m_frame.offset(variable);
+  varContext.size = variableType(variable).size;
+  m_variables.insert(m_names.intern(variable->name()), varContext);
+}
+
+void Context::addModuleVariable(const Parser::Nodes::VariableDeclaration* variable, std::string symbol) {
+  // Counting down from the top leaves the offsets clear of any frame
+  VariableContext varContext;
+  varContext.offset = std::numeric_limits<size_t>::max() - m_moduleVariableOffsets.size();
+  varContext.size = variableType(variable).size;
+  varContext.symbol = std::move(symbol);
+  m_moduleVariableOffsets.push_back(varContext.offset);
+  m_variables.insert(m_names.intern(variable->name()), std::move(varContext));
+}
+
+const std::vector<size_t>& Context::moduleVariableOffsets() const {
+  return m_moduleVariableOffsets;
+}
+
+Context::TypeContext Context::variableType(const Parser::Nodes::VariableDeclaration* variable) const {
   const Parser::Nodes::Node* typeIdent = variable->typeName()->child(Parser::Nodes::NodeType::Identifier);
   if (!typeIdent) {
     throw GenerationException("Missing identifier in type name");
@@ -81,44 +127,29 @@ void Context::addVariable(const Parser::Nodes::VariableDeclaration* variable) {
   if (!typeContext) {
     throw GenerationException("Invalid type specified");
   }
-
-  VariableContext varContext;
-  varContext.offset = m_impl->stackOffset;
-  for (const auto& [size, offset] : m_impl->variables | std::views::values) {
-    varContext.offset += size;
-  }
-  // Align the variable
-  varContext.offset =
-      ((varContext.offset + typeContext->alignment - 1) / typeContext->alignment) * typeContext->alignment;
-
-  varContext.size = typeContext->size;
-  m_impl->variables.try_emplace(variable->name(), varContext);
+  return *typeContext;
 }
 
-std::optional<Context::VariableContext> Context::variable(const std::string& name) const {
-  auto func = [name](const ContextImpl& context) -> std::optional<VariableContext> {
-    if (context.variables.contains(name)) {
-      return context.variables.at(name);
-    }
+std::optional<Context::VariableContext> Context::variable(std::string_view name) const {
+  const std::optional<NameTable::Id> id = m_names.find(name);
+  if (!id) {
     return std::nullopt;
-  };
-
-  return recurseContext<VariableContext>(*m_impl, func);
-}
-
-std::optional<Context::TypeContext> Context::type(const std::string& name) const {
-  if (m_primitiveTypes.contains(name)) {
-    return m_primitiveTypes.at(name);
   }
+  if (const VariableContext* varContext = m_variables.find(*id)) {
+    return *varContext;
+  }
+  return std::nullopt;
+}
 
-  auto func = [name](const ContextImpl& context) -> std::optional<TypeContext> {
-    if (context.types.contains(name)) {
-      return context.types.at(name);
-    }
+std::optional<Context::TypeContext> Context::type(std::string_view name) const {
+  const std::optional<NameTable::Id> id = m_names.find(name);
+  if (!id) {
     return std::nullopt;
-  };
-
-  return recurseContext<TypeContext>(*m_impl, func);
+  }
+  if (const TypeContext* typeContext = m_types.find(*id)) {
+    return *typeContext;
+  }
+  return std::nullopt;
 }
 
 size_t Context::nextLocalLabel() {
@@ -128,20 +159,58 @@ size_t Context::nextLocalLabel() {
 std::unique_ptr<Context::RegisterHandle> Context::nextRegister() {
   for (auto& reg : m_registers) {
     if (!reg.inUse) {
-      return std::make_unique<RegisterHandle>(&reg);
+      auto handle = std::make_unique<RegisterHandle>(&reg);
+      m_registerHighWater = std::max(m_registerHighWater, m_registers.size() - freeRegisters());
+      return handle;
     }
   }
   throw GenerationException("Unable to get next register");
 }
 
-template <typename ReturnT>
-std::optional<ReturnT> Context::recurseContext(
-    const ContextImpl& context, std::function<std::optional<ReturnT>(const Context::ContextImpl&)> findFunc) const {
-  if (auto ret = findFunc(context)) {
-    return ret;
+size_t Context::registerHighWater() const {
+  return m_registerHighWater;
+}
+
+size_t Context::freeRegisters() const {
+  return std::ranges::count_if(m_registers, [](const RegisterContext& reg) { return !reg.inUse; });
+}
+
+std::vector<Register> Context::liveCallerSavedRegisters() const {
+  std::vector<Register> registers;
+  for (const RegisterContext& reg : m_registers) {
+    if (reg.inUse && !reg.calleeSaved) {
+      registers.push_back(reg.reg);
+    }
+  }
+  return registers;
+}
+
+std::vector<Register> Context::usedCalleeSavedRegisters() const {
+  std::vector<Register> registers;
+  for (const RegisterContext& reg : m_registers) {
+    if (reg.used && reg.calleeSaved) {
+      registers.push_back(reg.reg);
+    }
+  }
+  return registers;
+}
+
+std::unique_ptr<Context::SpillHandle> Context::nextSpillSlot() {
+  for (auto& slot : m_spillSlots) {
+    if (!slot.inUse) {
+      return std::make_unique<SpillHandle>(&slot);
+    }
   }
 
-  if (context.parent) return recurseContext(*(context.parent), findFunc);
+  const size_t spillBase = ((m_frame.size() + 7) / 8) * 8;
+  SpillContext& slot = m_spillSlots.emplace_back(SpillContext{spillBase + m_spillSlots.size() * 8});
+  return std::make_unique<SpillHandle>(&slot);
+}
+
+size_t Context::frameSize() const {
+  return m_spillSlots.empty() ? m_frame.size() : m_spillSlots.back().offset + 8;
+}
 
-  return {};
+const FrameLayout& Context::frame() const {
+  return m_frame;
 }
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <Generator/FrameLayout.h>
+#include <Generator/Location/MemoryLocation.h>
 #include <Generator/Location/Register.h>
+#include <Generator/SymbolTable.h>
 
-#include <functional>
-#include <map>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Cepheid::Parser::Nodes {
 class VariableDeclaration;
@@ -17,7 +21,12 @@ class Context {
  public:
   struct VariableContext {
     size_t size;
+    /// Stack offset of a local. A module variable has one no local can have, so the value table can tell them apart.
     size_t offset;
+    /// Label of a module variable, empty for a local
+    std::string symbol;
+
+    [[nodiscard]] std::string address() const;
   };
 
   struct TypeContext {
@@ -26,9 +35,13 @@ class Context {
   };
 
   struct RegisterContext {
-    RegisterContext(Register reg);
+    RegisterContext(Register reg, bool calleeSaved = false);
     Register reg;
+    /// Preserved across calls, so a function has to save it before using it
+    bool calleeSaved;
     bool inUse = false;
+    /// Handed out at some point in the current function
+    bool used = false;
   };
 
   struct RegisterHandle : Location{
@@ -41,6 +54,19 @@ class Context {
     RegisterContext* m_context;
   };
 
+  struct SpillContext {
+    size_t offset;
+    bool inUse = false;
+  };
+
+  struct SpillHandle : MemoryLocation {
+    [[nodiscard]] explicit SpillHandle(SpillContext* context);
+    ~SpillHandle() override;
+
+   private:
+    SpillContext* m_context;
+  };
+
   Context();
   Context(const Context& other) = delete;
   Context(Context&& other) noexcept = delete;
@@ -49,40 +75,55 @@ class Context {
   ~Context() = default;
 
   void pushScope();
-  void pushFunction();
+  void pushFunction(FrameLayout frame);
 
   void popScope();
   void popFunction();
 
   void addVariable(const Parser::Nodes::VariableDeclaration* variable);
-  [[nodiscard]] std::optional<VariableContext> variable(const std::string& name) const;
+  /// Declare a variable that lives at a label for the whole program, visible to every function
+  void addModuleVariable(const Parser::Nodes::VariableDeclaration* variable, std::string symbol);
+  [[nodiscard]] std::optional<VariableContext> variable(std::string_view name) const;
+
+  [[nodiscard]] std::optional<TypeContext> type(std::string_view name) const;
+  [[nodiscard]] TypeContext variableType(const Parser::Nodes::VariableDeclaration* variable) const;
 
-  [[nodiscard]] std::optional<TypeContext> type(const std::string& name) const;
+  /// Offsets of the module variables, which any call might write
+  [[nodiscard]] const std::vector<size_t>& moduleVariableOffsets() const;
 
   [[nodiscard]] size_t nextLocalLabel();
 
   [[nodiscard]] std::unique_ptr<Context::RegisterHandle> nextRegister();
+  [[nodiscard]] size_t freeRegisters() const;
+  /// Most registers the current function has held values in at once
+  [[nodiscard]] size_t registerHighWater() const;
 
- private:
-  struct ContextImpl {
-    std::unique_ptr<ContextImpl> parent;
+  /// Registers a call would clobber that are currently holding something
+  [[nodiscard]] std::vector<Register> liveCallerSavedRegisters() const;
+  /// Callee saved registers the current function has used, which its prologue needs to save
+  [[nodiscard]] std::vector<Register> usedCalleeSavedRegisters() const;
 
-    size_t stackOffset = 0;
+  /// A stack slot above the function's locals for holding a register's value while the register is reused
+  [[nodiscard]] std::unique_ptr<Context::SpillHandle> nextSpillSlot();
 
-    std::map<std::string, VariableContext> variables;
-    std::map<std::string, TypeContext> types;
-  };
+  /// Size of the current function's locals plus any spill slots handed out so far
+  [[nodiscard]] size_t frameSize() const;
 
-  template <typename ReturnT>
-  [[nodiscard]] std::optional<ReturnT> recurseContext(
-      const ContextImpl& context, std::function<std::optional<ReturnT>(const ContextImpl&)>) const;
+  [[nodiscard]] const FrameLayout& frame() const;
 
-  std::unique_ptr<ContextImpl> m_impl;
+ private:
+  NameTable m_names;
+  SymbolTable<VariableContext> m_variables;
+  SymbolTable<TypeContext> m_types;
+  std::vector<size_t> m_moduleVariableOffsets;
+
+  FrameLayout m_frame;
   size_t m_localLabels = 0;
 
   std::vector<RegisterContext> m_registers;
-
-  std::map<std::string, TypeContext> m_primitiveTypes;
+  size_t m_registerHighWater = 0;
+  // Handles point into this, so it can't reallocate as it grows
+  std::deque<SpillContext> m_spillSlots;
 };
 
 }  // namespace Cepheid::Gen
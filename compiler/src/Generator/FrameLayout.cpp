@@ -0,0 +1,215 @@
+#include "FrameLayout.h"
+
+#include <Generator/Context.h>
+#include <Generator/GenerationException.h>
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+using namespace Cepheid::Gen;
+
+using Cepheid::Parser::Nodes::NodeType;
+
+namespace {
+/// Windows x64 callers reserve space for the four register arguments, whether or not they're passed
+constexpr size_t shadowSpace = 32;
+constexpr size_t registerArguments = 4;
+}  // namespace
+
+FrameLayout::FrameLayout(const Parser::Nodes::Function* function, const Context& context) : m_context(&context) {
+  // Parameters are live from the start of the function
+  m_scopes.emplace_back();
+  for (const auto& parameter : function->parameters()) {
+    collectVariable(parameter.get());
+  }
+  if (function->scope()) {
+    collectScope(function->scope());
+  }
+  m_scopes.pop_back();
+
+  if (m_hasCalls) {
+    m_argumentSize = shadowSpace + 8 * (std::max(m_maxArguments, registerArguments) - registerArguments);
+  }
+  m_size = m_argumentSize;
+  assignSlots();
+
+  m_context = nullptr;
+  m_intervals.clear();
+  m_scopes.clear();
+}
+
+size_t FrameLayout::size() const {
+  return m_size;
+}
+
+size_t FrameLayout::argumentSize() const {
+  return m_argumentSize;
+}
+
+size_t FrameLayout::offset(const Parser::Nodes::VariableDeclaration* variable) const {
+  if (const auto it = m_offsets.find(variable); it != m_offsets.end()) {
+    return it->second;
+  }
+  throw GenerationException("Variable missing from frame layout");
+}
+
+void FrameLayout::collectScope(const Parser::Nodes::Scope* scope) {
+  m_scopes.emplace_back();
+  for (const auto& statement : scope->statements()) {
+    collectStatement(statement.get());
+  }
+  m_scopes.pop_back();
+}
+
+void FrameLayout::collectStatement(const Parser::Nodes::Node* node) {
+  m_point++;
+  switch (node->type()) {
+    case NodeType::Scope:
+      collectScope(dynamic_cast<const Parser::Nodes::Scope*>(node));
+      break;
+    case NodeType::VariableDeclaration:
+      collectVariable(dynamic_cast<const Parser::Nodes::VariableDeclaration*>(node));
+      break;
+    case NodeType::ReturnStatement:
+    case NodeType::Expression:
+      collectExpression(node);
+      break;
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      collectExpression(conditional->expression());
+      collectScope(conditional->scope());
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      collectExpression(loop->initExpression());
+
+      const size_t loopBegin = ++m_point;
+      collectExpression(loop->conditionExpression());
+      collectScope(loop->scope());
+      collectExpression(loop->updateExpression());
+      const size_t loopEnd = ++m_point;
+
+      // Anything declared outside the loop and used inside it has to survive the back edge
+      for (Interval& interval : m_intervals) {
+        if (interval.begin < loopBegin && interval.end >= loopBegin) {
+          interval.end = std::max(interval.end, loopEnd);
+        }
+      }
+      break;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      collectExpression(switchNode->expression());
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        collectScope(switchCase.scope.get());
+      }
+      break;
+    }
+    default:
+      // Nested functions get a frame of their own
+      break;
+  }
+}
+
+void FrameLayout::collectExpression(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier: {
+      const std::string& name = node->token()->value.value();
+      for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope) {
+        if (const auto it = scope->find(name); it != scope->end()) {
+          m_intervals[it->second].end = std::max(m_intervals[it->second].end, ++m_point);
+          break;
+        }
+      }
+      break;
+    }
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      collectExpression(binaryNode->lhs());
+      collectExpression(binaryNode->rhs());
+      break;
+    }
+    case NodeType::UnaryOperation:
+      collectExpression(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand());
+      break;
+    case NodeType::Call:
+      m_hasCalls = true;
+      m_maxArguments = std::max(m_maxArguments, node->children().size());
+      [[fallthrough]];
+    default:
+      for (const auto& child : node->children()) {
+        collectExpression(child.get());
+      }
+      break;
+  }
+}
+
+void FrameLayout::collectVariable(const Parser::Nodes::VariableDeclaration* variable) {
+  // The initialiser is read before the variable is written, so a local whose last use is here can share the slot
+  collectExpression(variable->expression());
+
+  const Context::TypeContext type = m_context->variableType(variable);
+  const size_t point = ++m_point;
+  m_scopes.back().insert_or_assign(variable->name(), m_intervals.size());
+  m_intervals.push_back({variable, type.size, type.alignment, point, point});
+}
+
+void FrameLayout::assignSlots() {
+  std::vector<size_t> order(m_intervals.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, [this](size_t lhs, size_t rhs) {
+    return m_intervals[lhs].begin < m_intervals[rhs].begin;
+  });
+
+  // Slots no longer in use, keyed by their size
+  std::multimap<size_t, size_t> freeSlots;
+  // Slots in use as (end of live range, offset, slot size), soonest to expire on top
+  using ActiveSlot = std::tuple<size_t, size_t, size_t>;
+  std::priority_queue<ActiveSlot, std::vector<ActiveSlot>, std::greater<>> activeSlots;
+
+  for (const size_t index : order) {
+    const Interval& interval = m_intervals[index];
+
+    while (!activeSlots.empty() && std::get<0>(activeSlots.top()) < interval.begin) {
+      const auto [end, offset, size] = activeSlots.top();
+      freeSlots.emplace(size, offset);
+      activeSlots.pop();
+    }
+
+    // Reuse the smallest free slot that fits, otherwise grow the frame
+    auto slot = freeSlots.lower_bound(interval.size);
+    while (slot != freeSlots.end() && slot->second % interval.alignment != 0) {
+      ++slot;
+    }
+
+    size_t offset;
+    size_t slotSize;
+    if (slot != freeSlots.end()) {
+      slotSize = slot->first;
+      offset = slot->second;
+      freeSlots.erase(slot);
+    } else {
+      slotSize = interval.size;
+      offset = ((m_size + interval.alignment - 1) / interval.alignment) * interval.alignment;
+      m_size = offset + slotSize;
+    }
+
+    m_offsets.insert_or_assign(interval.variable, offset);
+    activeSlots.emplace(interval.end, offset, slotSize);
+  }
+}
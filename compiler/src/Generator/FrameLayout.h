@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+class Function;
+class Scope;
+class VariableDeclaration;
+}  // namespace Cepheid::Parser::Nodes
+
+namespace Cepheid::Gen {
+class Context;
+
+/**
+ * Stack frame layout for a single function.
+ *
+ * Every local gets a slot sized and aligned by its type. Locals whose live ranges don't overlap share a slot, so the
+ * frame only needs to be as large as the set of locals that are alive at the same time. Parameters are stored to a
+ * slot of their own on entry. Functions that make calls keep the bottom of the frame free for their callees' shadow
+ * space and stack arguments.
+ */
+class FrameLayout {
+ public:
+  FrameLayout() = default;
+  FrameLayout(const Parser::Nodes::Function* function, const Context& context);
+
+  /// Size in bytes of the outgoing argument and locals areas, not including any alignment padding the caller adds
+  [[nodiscard]] size_t size() const;
+
+  /// Offset of a local from the bottom of the frame
+  [[nodiscard]] size_t offset(const Parser::Nodes::VariableDeclaration* variable) const;
+
+  /// Size of the area at the bottom of the frame for arguments to calls
+  [[nodiscard]] size_t argumentSize() const;
+
+ private:
+  struct Interval {
+    const Parser::Nodes::VariableDeclaration* variable;
+    size_t size;
+    size_t alignment;
+    size_t begin;
+    size_t end;
+  };
+
+  void collectScope(const Parser::Nodes::Scope* scope);
+  void collectStatement(const Parser::Nodes::Node* node);
+  void collectExpression(const Parser::Nodes::Node* node);
+  void collectVariable(const Parser::Nodes::VariableDeclaration* variable);
+
+  void assignSlots();
+
+  const Context* m_context = nullptr;
+
+  // Liveness collection state
+  size_t m_maxArguments = 0;
+  bool m_hasCalls = false;
+  size_t m_point = 0;
+  std::vector<Interval> m_intervals;
+  std::vector<std::map<std::string, size_t, std::less<>>> m_scopes;
+
+  std::unordered_map<const Parser::Nodes::VariableDeclaration*, size_t> m_offsets;
+  size_t m_argumentSize = 0;
+  size_t m_size = 0;
+};
+
+}  // namespace Cepheid::Gen
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <exception>
+#include <string>
 
 namespace Cepheid::Gen {
 
 class GenerationException : public std::exception {
  public:
-  using std::exception::exception;
+  GenerationException() = default;
+  explicit GenerationException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
 };
 
 }  // namespace Cepheid::Gen
@@ -1,45 +1,268 @@
 #include "Generator.h"
 
 #include <Generator/Context.h>
+#include <Generator/FrameLayout.h>
 #include <Generator/GenerationException.h>
 #include <Generator/Location/Location.h>
 #include <Generator/Location/MemoryLocation.h>
 #include <Generator/Location/Register.h>
+#include <Generator/OutputSink.h>
+#include <Generator/Profile.h>
+#include <Generator/ValueTable.h>
+#include <Optimiser/SideEffects.h>
 #include <Parser/Node/BinaryOperation.h>
 #include <Parser/Node/Conditional.h>
 #include <Parser/Node/Function.h>
+#include <Parser/Node/Intrinsic.h>
 #include <Parser/Node/Loop.h>
 #include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
 #include <Parser/Node/UnaryOperation.h>
 #include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/ValueType.h>
+#include <Tokeniser/LineTable.h>
 #include <Tokeniser/Token.h>
+#include <Trace/Trace.h>
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <limits>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <Generator/Location/Comparison.h>
 #include <Generator/Location/IntegerLiteral.h>
 
 using namespace Cepheid::Gen;
 
+using Cepheid::Parser::Nodes::IntrinsicType;
 using Cepheid::Parser::Nodes::NodeType;
 
-Generator::Generator(Parser::Nodes::NodePtr root) : m_root(std::move(root)) {
+namespace Cepheid::Gen {
+namespace {
+/// Registers never given to held values, so there is always room to evaluate an expression
+constexpr size_t reservedRegisters = 4;
+
+/// Windows x64 passes the first four integer arguments in registers, and the rest above the callee's shadow space
+const std::array<Register, 4> argumentRegisters = {Register{Register::Kind::Original, "c"},
+                                                  Register{Register::Kind::Original, "d"},
+                                                  Register{Register::Kind::AMD64, "r8"},
+                                                  Register{Register::Kind::AMD64, "r9"}};
+constexpr size_t shadowSpace = 32;
+
+/// A conditional whose body is entered less often than this is laid out with the skip as the fall through
+constexpr double coldBodyRatio = 0.5;
+/// Loops running at least this many trips per entry are rotated so each trip takes a single branch
+constexpr double rotateTrips = 2.0;
+/// Loops running at least this many trips per entry, with bodies no bigger than unrollStatements, are unrolled once
+constexpr double unrollTrips = 8.0;
+constexpr size_t unrollStatements = 8;
+/// A conditional taken or skipped more often than this is predicted well enough to keep its branch
+constexpr double predictableRatio = 0.9;
+
+std::optional<Comparison::Type> comparisonType(Parser::Nodes::BinaryOperationType operation) {
+  switch (operation) {
+    case Parser::Nodes::BinaryOperationType::Equal:
+      return Comparison::Type::Equal;
+    case Parser::Nodes::BinaryOperationType::NotEqual:
+      return Comparison::Type::NotEqual;
+    case Parser::Nodes::BinaryOperationType::GreaterEqual:
+      return Comparison::Type::GreaterEqual;
+    case Parser::Nodes::BinaryOperationType::GreaterThan:
+      return Comparison::Type::Greater;
+    case Parser::Nodes::BinaryOperationType::LessEqual:
+      return Comparison::Type::LessEqual;
+    case Parser::Nodes::BinaryOperationType::LessThan:
+      return Comparison::Type::Less;
+    default:
+      return std::nullopt;
+  }
+}
+
+size_t statementCount(const Parser::Nodes::Node* node) {
+  size_t count = 0;
+  if (const auto* scope = dynamic_cast<const Parser::Nodes::Scope*>(node)) {
+    for (const auto& statement : scope->statements()) {
+      count += 1 + statementCount(statement.get());
+    }
+  } else if (const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node)) {
+    count += statementCount(conditional->scope());
+  } else if (const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node)) {
+    count += statementCount(loop->scope());
+  } else if (const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node)) {
+    for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+      count += statementCount(switchCase.scope.get());
+    }
+  }
+  return count;
+}
+
+/// Whether an expression is generated without any jumps, so can be evaluated whatever a condition says
+bool isBranchFree(const Parser::Nodes::Node* node) {
+  if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node)) {
+    return binaryNode->operation() != Parser::Nodes::BinaryOperationType::LogicalAnd &&
+           binaryNode->operation() != Parser::Nodes::BinaryOperationType::LogicalOr &&
+           isBranchFree(binaryNode->lhs()) && isBranchFree(binaryNode->rhs());
+  }
+  if (const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)) {
+    return isBranchFree(unaryNode->operand());
+  }
+  return std::ranges::all_of(node->children(), [](const auto& child) { return isBranchFree(child.get()); });
+}
+
+/// The assignment to a variable that is the whole of a conditional's body, if that's all the body is
+const Parser::Nodes::BinaryOperation* soleAssignment(const Parser::Nodes::Conditional* conditional) {
+  const std::vector<Parser::Nodes::NodePtr>& statements = conditional->scope()->statements();
+  if (statements.size() != 1 || statements.front()->type() != NodeType::Expression) {
+    return nullptr;
+  }
+  const auto* assignment =
+      dynamic_cast<const Parser::Nodes::BinaryOperation*>(statements.front()->children().front().get());
+  if (!assignment || assignment->operation() != Parser::Nodes::BinaryOperationType::Assign ||
+      assignment->lhs()->type() != NodeType::Identifier) {
+    return nullptr;
+  }
+  return assignment;
+}
+
+/// Letter NASM's data and reserve directives take for a value of this many bytes
+char dataSuffix(size_t size) {
+  switch (size) {
+    case 1:
+      return 'b';
+    case 2:
+      return 'w';
+    case 4:
+      return 'd';
+    default:
+      return 'q';
+  }
+}
+}  // namespace
+}  // namespace Cepheid::Gen
+
+size_t Cepheid::Gen::instructionCount(std::string_view assembly) {
+  size_t count = 0;
+  while (!assembly.empty()) {
+    const size_t end = std::min(assembly.find('\n'), assembly.size());
+    const std::string_view line = assembly.substr(0, end);
+    const size_t start = line.find_first_not_of(' ');
+    count += start != 0 && start != std::string_view::npos && line[start] != ';';
+    assembly.remove_prefix(std::min(end + 1, assembly.size()));
+  }
+  return count;
+}
+
+Generator::Generator(Parser::Nodes::NodePtr root, Sema::ExpressionTypes types, GeneratorOptions options)
+    : m_root(std::move(root)), m_types(std::move(types)), m_options(options) {
 }
 
 std::string Generator::generate() {
+  StringSink sink;
+  generate(sink);
+  return sink.take();
+}
+
+void Generator::generate(OutputSink& sink) {
+  m_sink = &sink;
   Context context;
   genProgram(m_root.get(), context);
 
-  return m_program.str();
+  if (m_options.instrument) {
+    writeProfileDump();
+  }
+  flushProgram();
+  sink.flush();
+  m_sink = nullptr;
+}
+
+const std::vector<FunctionStats>& Generator::functionStats() const {
+  return m_functionStats;
 }
 
 void Generator::genProgram(const Parser::Nodes::Node* node, Context& context) {
   m_program << R"(bits 64
 default rel
 
-segment .text
-global _entry
+)";
+  genModuleVariables(node, context);
+  m_program << "segment .text\n";
+
+  // Functions are linked across modules by name
+  bool hasMain = false;
+  for (const auto& child : node->children()) {
+    if (const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get())) {
+      hasMain = hasMain || function->name() == "main";
+      if (function->isExported()) {
+        m_program << "global cep_" << function->name() << "\n";
+      }
+    }
+  }
+  for (const std::string& function : m_types.externalFunctions()) {
+    m_program << "extern cep_" << function << "\n";
+  }
+  m_program << "\n";
+
+  if (hasMain) {
+    genEntry();
+  }
+  flushProgram();
+
+  for (const auto& child : node->children()) {
+    if (child->type() != NodeType::VariableDeclaration) {
+      genStatement(child.get(), context);
+      flushProgram();
+    }
+  }
+}
+
+void Generator::genModuleVariables(const Parser::Nodes::Node* node, Context& context) {
+  std::vector<const Parser::Nodes::VariableDeclaration*> constants;
+  std::vector<const Parser::Nodes::VariableDeclaration*> initialised;
+  std::vector<const Parser::Nodes::VariableDeclaration*> zeroed;
+  for (const auto& child : node->children()) {
+    if (const auto* variable = dynamic_cast<const Parser::Nodes::VariableDeclaration*>(child.get())) {
+      context.addModuleVariable(variable, "cepv_" + variable->name());
+      if (variable->isConstant()) {
+        constants.push_back(variable);
+      } else if (m_types.constant(variable)->value != 0) {
+        initialised.push_back(variable);
+      } else {
+        zeroed.push_back(variable);
+      }
+    }
+  }
+
+  // .bss takes no space in the image, only reserving what's zeroed when the program is loaded
+  const auto writeSection = [&](std::string_view section, auto& variables, bool reserve) {
+    if (variables.empty()) {
+      return;
+    }
+    // Widest first, so every variable is naturally aligned without any padding between them
+    std::ranges::stable_sort(variables, [this](const auto* lhs, const auto* rhs) {
+      return m_types.type(lhs).size > m_types.type(rhs).size;
+    });
+
+    m_program << "segment " << section << "\n" << (reserve ? "alignb" : "align") << " 8\n";
+    for (const Parser::Nodes::VariableDeclaration* variable : variables) {
+      const char suffix = dataSuffix(m_types.type(variable).size);
+      m_program << context.variable(variable->name())->symbol << ": ";
+      if (reserve) {
+        m_program << "res" << suffix << " 1\n";
+      } else {
+        m_program << "d" << suffix << " " << m_types.constant(variable)->value << "\n";
+      }
+    }
+    m_program << "\n";
+  };
+  writeSection(".rdata", constants, false);
+  writeSection(".data", initialised, false);
+  writeSection(".bss", zeroed, true);
+}
+
+void Generator::genEntry() {
+  m_program << R"(global _entry
 extern _CRT_INIT
 extern ExitProcess
 
@@ -52,14 +275,19 @@ _entry:
 
   call cep_main
   
-  mov rcx, rax
-  call ExitProcess
-
 )";
 
-  for (const auto& child : node->children()) {
-    genStatement(child.get(), context);
+  if (m_options.instrument) {
+    // rbx is preserved across the calls made while writing the profile
+    writeInstruction("mov", {"rbx", "rax"});
+    writeInstruction("call", {"cep_profile_dump"});
+    writeInstruction("mov", {"rax", "rbx"});
   }
+
+  m_program << R"(  mov rcx, rax
+  call ExitProcess
+
+)";
 }
 
 void Generator::genScope(const Parser::Nodes::Scope* scope, Context& context) {
@@ -77,6 +305,11 @@ void Generator::genScope(const Parser::Nodes::Scope* scope, Context& context) {
 }
 
 void Generator::genStatement(const Parser::Nodes::Node* node, Context& context) {
+  // A function's body is generated before its prologue, so it marks its own line
+  if (node->type() != NodeType::Function) {
+    writeSourceLine(node);
+  }
+
   switch (node->type()) {
     case NodeType::Function:
       genFunction(node, context);
@@ -93,6 +326,9 @@ void Generator::genStatement(const Parser::Nodes::Node* node, Context& context)
     case NodeType::Loop:
       genLoop(node, context);
       break;
+    case NodeType::Switch:
+      genSwitch(node, context);
+      break;
     case NodeType::Expression:
       genExpression(node, context);
       break;
@@ -102,42 +338,128 @@ void Generator::genStatement(const Parser::Nodes::Node* node, Context& context)
 }
 
 void Generator::genFunction(const Parser::Nodes::Node* node, Context& context) {
-  std::string body;
-
   const auto function = dynamic_cast<const Parser::Nodes::Function*>(node);
   if (!function) {
     throw GenerationException("Expected function!");
   }
+  const Trace::Span span(function->name(), Trace::Recorder::Category::Function);
+
+  context.pushFunction(FrameLayout(function, context));
+  m_switchLowerings = {};
+  m_sites.clear();
+  numberSites(function->scope(), function->name());
+  m_values.reset(function, &m_types, [this](const Parser::Nodes::Conditional* conditional) {
+    return isIfConvertible(conditional);
+  });
+  for (const auto& parameter : function->parameters()) {
+    context.addVariable(parameter.get());
+  }
 
-  const size_t stackSpace = 32 + ((function->requiredStackSpace() + 15) / 16) * 16;
-  context.pushFunction();
-  // TODO update context for function parameters
+  const auto& statements = function->scope()->statements();
+  m_finalReturn = !statements.empty() && statements.back()->type() == NodeType::ReturnStatement
+                      ? statements.back().get()
+                      : nullptr;
+
+  // The body is generated first, as spilling can grow the frame and decides which registers need saving
+  std::stringstream body;
+  m_program.swap(body);
+  genScope(function->scope(), context);
+  m_program.swap(body);
+
+  // rsp is 16 byte aligned after pushing rbp, and has to be again at every call the body makes
+  const std::vector<Register> savedRegisters = context.usedCalleeSavedRegisters();
+  const size_t stackSpace = ((context.frameSize() + 15) / 16) * 16 + (savedRegisters.size() % 2) * 8;
+  if (m_options.stats) {
+    m_functionStats.push_back(
+        {.name = function->name(),
+         .frameSize = 8 * savedRegisters.size() + stackSpace,
+         .registerHighWater = context.registerHighWater(),
+         .jumpTables = m_switchLowerings[static_cast<size_t>(SwitchLowering::JumpTable)],
+         .bitTests = m_switchLowerings[static_cast<size_t>(SwitchLowering::BitTest)],
+         .decisionTrees = m_switchLowerings[static_cast<size_t>(SwitchLowering::DecisionTree)]});
+  }
 
   // Label and prologue
-  const std::string name = "cep_" + function->name();
-  writeLabel(name);
+  writeSourceLine(function);
+  writeLabel("cep_" + function->name());
   writeInstruction("push", {"rbp"});
   writeInstruction("mov", {"rbp", "rsp"});
+  for (const Register& reg : savedRegisters) {
+    writeInstruction("push", {reg.asAsm(8)});
+  }
+  if (stackSpace > 0) {
+    writeInstruction("sub", {"rsp", std::to_string(stackSpace)});
+  }
+
+  // Parameters are stored to their slots, so they can be used like any other local, apart from those every caller
+  // passes the same literal, whose reads are all replaced by it
+  const auto& parameters = function->parameters();
+  for (size_t i = 0; i < parameters.size(); i++) {
+    if (m_types.constant(parameters[i].get())) {
+      continue;
+    }
+    const size_t size = m_types.type(parameters[i].get()).size;
+    const MemoryLocation location{"[ rsp + " + std::to_string(context.frame().offset(parameters[i].get())) + " ]"};
+    if (i < argumentRegisters.size()) {
+      writeInstruction("mov", {location.asAsm(size), argumentRegisters[i].asAsm(size)});
+    } else {
+      // rax is free until the body starts
+      const Register scratch{Register::Kind::Original, "a"};
+      const MemoryLocation argument{"[ rbp + " + std::to_string(16 + 8 * i) + " ]"};
+      writeInstruction("mov", {scratch.asAsm(size), argument.asAsm(size)});
+      writeInstruction("mov", {location.asAsm(size), scratch.asAsm(size)});
+    }
+  }
 
-  writeInstruction("sub", {"rsp", std::to_string(stackSpace)});
+  m_program << body.str();
 
-  // Scope
-  genScope(function->scope(), context);
+  // Epilogue, which falling off the end also runs into rather than the out of line blocks
+  writeLabel(".return");
+  if (savedRegisters.empty()) {
+    writeInstruction("leave", {});
+  } else {
+    writeInstruction("lea", {"rsp", "[ rbp - " + std::to_string(8 * savedRegisters.size()) + " ]"});
+    for (auto reg = savedRegisters.rbegin(); reg != savedRegisters.rend(); ++reg) {
+      writeInstruction("pop", {reg->asAsm(8)});
+    }
+    writeInstruction("pop", {"rbp"});
+  }
+  writeInstruction("ret", {});
+  m_program << m_coldBlocks.str();
+  m_coldBlocks = {};
+  if (m_jumpTables.tellp() > 0) {
+    // Local labels in the tables still belong to the function, as no other label comes between
+    m_program << "\nsegment .rdata\nalign 8\n" << m_jumpTables.str() << "\nsegment .text\n";
+    m_jumpTables = {};
+  }
 
+  // Everything from the label on is this function's, as the program is flushed after each one
+  if (m_options.stats) {
+    measureFunctions(m_program.view(), std::span(&m_functionStats.back(), 1));
+  }
+
+  m_values.clear();
+  m_registerNeeds.clear();
+  m_selections = {};
   context.popFunction();
 }
 
 void Generator::genReturn(const Parser::Nodes::Node* node, Context& context) {
-  std::string ret;
-  // Compute expression
   if (!node->children().empty()) {
-    const std::unique_ptr<Location> resultLocation = genExpression(node->children()[0].get(), context);
-    writeInstruction("mov", {"rax", resultLocation->asAsm(8)});
+    const Parser::Nodes::Node* expression = node->children()[0].get();
+    const Sema::ValueType returnType = m_types.type(node);
+    std::unique_ptr<Location> resultLocation = genExpression(expression, context);
+    resultLocation = convert(std::move(resultLocation), m_types.type(expression), returnType, context);
+
+    // Narrow values are returned extended to 32 bits
+    const Sema::ValueType extendedType{Sema::operationSize(returnType), returnType.isSigned};
+    resultLocation = convert(std::move(resultLocation), returnType, extendedType, context);
+    writeMove(Register(Register::Kind::Original, "a"), *resultLocation, extendedType.size);
   }
 
-  // Do the return
-  writeInstruction("leave", {});
-  writeInstruction("ret", {});
+  if (node != m_finalReturn) {
+    writeInstruction("jmp", {".return"});
+  }
 }
 
 void Generator::genVariableDeclaration(const Parser::Nodes::Node* node, Context& context) {
@@ -146,18 +468,27 @@ void Generator::genVariableDeclaration(const Parser::Nodes::Node* node, Context&
     throw GenerationException("Expected variable declaration");
   }
 
+  // The initialiser is evaluated before the variable comes into scope
+  const Sema::ValueType type = m_types.type(node);
+  std::unique_ptr<Location> resultLocation;
+  if (const Parser::Nodes::Node* expression = variableDeclaration->expression()) {
+    resultLocation = genExpression(expression, context);
+    resultLocation = convert(std::move(resultLocation), m_types.type(expression), type, context);
+    resultLocation = writeWideImmediateToReg(std::move(resultLocation), type.size, context);
+    resultLocation = writeMemoryToReg(std::move(resultLocation), type, context);
+  }
+
   context.addVariable(variableDeclaration);
 
   const std::optional<Context::VariableContext> varContext = context.variable(variableDeclaration->name());
   if (!varContext) {
     throw GenerationException("Somehow failed to add variable to context");
   }
+  m_values.store(varContext->offset);
 
-  if (variableDeclaration->expression()) {
-    const MemoryLocation location{"[ rsp + " + std::to_string(varContext->offset) + " ]"};
-    std::unique_ptr<Location> resultLocation = genExpression(variableDeclaration->expression(), context);
-    resultLocation = writeImmediateToReg(std::move(resultLocation), context);
-    writeInstruction("mov", {location.asAsm(varContext->size), resultLocation->asAsm(varContext->size)});
+  if (resultLocation) {
+    const MemoryLocation location{varContext->address()};
+    writeInstruction("mov", {location.asAsm(type.size), resultLocation->asAsm(type.size)});
   }
 }
 
@@ -168,52 +499,434 @@ void Generator::genConditional(const Parser::Nodes::Node* node, Context& context
   }
   const size_t labelIndex = context.nextLocalLabel();
   const std::string label = ".L" + std::to_string(labelIndex);
+  const std::string& site = m_sites.at(node);
 
-  const std::unique_ptr<Location> resultLocation = genExpression(conditional->expression(), context);
-  std::unique_ptr<Comparison> comparison;
-  if (const auto resultComparison = dynamic_cast<Comparison*>(resultLocation.get())) {
-    comparison = std::make_unique<Comparison>(*resultComparison);
-  } else {
-    writeInstruction("cmp", {resultLocation->asAsm(8), "0"});
-    comparison = std::make_unique<Comparison>(Comparison::Type::Equal);
+  writeCounter(site, "count");
+
+  if (genIfConversion(conditional, context)) {
+    return;
+  }
+
+  const std::optional<double> taken = m_options.profile ? m_options.profile->takenRatio(site) : std::nullopt;
+
+  if (taken && *taken < coldBodyRatio) {
+    // The body is usually skipped, so it's moved after the function and skipping it falls through
+    const std::string coldLabel = ".L" + std::to_string(context.nextLocalLabel());
+    genBranch(conditional->expression(), true, coldLabel, context);
+
+    std::stringstream cold;
+    m_program.swap(cold);
+    writeLabel(coldLabel);
+    writeCounter(site, "taken");
+    const size_t valueMark = m_values.enterBlock();
+    genScope(conditional->scope(), context);
+    m_values.leaveBlock(valueMark);
+    writeInstruction("jmp", {label});
+    m_program.swap(cold);
+    m_coldBlocks << cold.str();
+
+    writeLabel(label);
+    return;
   }
-  writeInstruction(comparison->jmpInstruction(true), {label});
+
+  genBranch(conditional->expression(), false, label, context);
+
+  writeCounter(site, "taken");
+  const size_t valueMark = m_values.enterBlock();
   genScope(conditional->scope(), context);
+  m_values.leaveBlock(valueMark);
+
   writeLabel(label);
 }
 
+bool Generator::isIfConvertible(const Parser::Nodes::Conditional* conditional) {
+  // Counting how often the body runs needs the branch
+  const Parser::Nodes::BinaryOperation* assignment = soleAssignment(conditional);
+  if (!assignment || m_options.instrument) {
+    return false;
+  }
+  const std::optional<double> taken =
+      m_options.profile ? m_options.profile->takenRatio(m_sites.at(conditional)) : std::nullopt;
+  if (taken && (*taken < 1 - predictableRatio || *taken > predictableRatio)) {
+    return false;
+  }
+
+  // The value is computed before the condition is tested, so neither may do anything but produce a value
+  const Parser::Nodes::Node* condition = conditional->expression();
+  const Parser::Nodes::Node* valueNode = assignment->rhs();
+  return !Opt::hasSideEffects(condition, m_selections.sideEffects) &&
+         !Opt::hasSideEffects(valueNode, m_selections.sideEffects) && isBranchFree(condition) &&
+         isBranchFree(valueNode) &&
+         genericCost(valueNode, true, m_selections) <= static_cast<int>(m_options.ifConversionCost);
+}
+
+bool Generator::genIfConversion(const Parser::Nodes::Conditional* conditional, Context& context) {
+  if (!isIfConvertible(conditional)) {
+    return false;
+  }
+  const Parser::Nodes::BinaryOperation* assignment = soleAssignment(conditional);
+  const Parser::Nodes::Node* condition = conditional->expression();
+  const Parser::Nodes::Node* valueNode = assignment->rhs();
+
+  const std::string& name = assignment->lhs()->token()->value.value();
+  const std::optional<Context::VariableContext> varContext = context.variable(name);
+  if (!varContext) {
+    throw GenerationException("Unknown identifier in assignment");
+  }
+  const Sema::ValueType type = m_types.type(assignment);
+  const size_t size = Sema::operationSize(type);
+
+  std::unique_ptr<Location> valueLocation = genExpression(valueNode, context);
+  valueLocation = convert(std::move(valueLocation), m_types.type(valueNode), type, context);
+  valueLocation = writeImmediateToReg(std::move(valueLocation), size, context);
+  valueLocation = writeMemoryToReg(std::move(valueLocation), type, context);
+
+  // A conditional move can't read fewer than 32 bits from memory
+  const std::string address = varContext->address();
+  const MemoryLocation location{address};
+  std::unique_ptr<Location> current = std::make_unique<MemoryLocation>(address);
+  if (type.size < size) {
+    current = writeMemoryToReg(std::move(current), type, context);
+  }
+
+  // The new value is kept unless the condition fails, when the variable's own value is put back
+  const std::unique_ptr<Comparison> comparison = genCondition(condition, context);
+  writeInstruction(comparison->cmovInstruction(true), {valueLocation->asAsm(size), current->asAsm(size)});
+  writeInstruction("mov", {location.asAsm(type.size), valueLocation->asAsm(type.size)});
+  m_values.store(varContext->offset);
+  return true;
+}
+
 void Generator::genLoop(const Parser::Nodes::Node* node, Context& context) {
   const auto loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
   if (!loop) {
     throw GenerationException("Expected loop");
   }
+  const std::string& site = m_sites.at(node);
 
   if (const Parser::Nodes::Node* initExpression = loop->initExpression()) {
     genExpression(initExpression, context);
   }
 
+  // The condition is reached again from the back edge, so values read from anything the loop writes are stale, and a
+  // register held from before the loop may have been reused by the time it gets back there. Nothing is held past
+  // here, so every variable is treated as written rather than walking the body for the ones that are.
+  m_values.storeAll();
+
+  writeCounter(site, "entries");
+
+  const std::optional<double> trips = m_options.profile ? m_options.profile->averageTrips(site) : std::nullopt;
+  if (trips && *trips >= rotateTrips) {
+    genRotatedLoop(loop, site, *trips >= unrollTrips && statementCount(loop->scope()) <= unrollStatements, context);
+    return;
+  }
+
   const std::string conditionLabel = ".L" + std::to_string(context.nextLocalLabel());
   const std::string endLabel = ".L" + std::to_string(context.nextLocalLabel());
+  const size_t valueMark = m_values.enterBlock();
 
   writeLabel(conditionLabel);
-  const std::unique_ptr<Location> conditionLocation = genExpression(loop->conditionExpression(), context);
-  std::unique_ptr<Comparison> comparison;
-  if (const auto resultComparison = dynamic_cast<Comparison*>(conditionLocation.get())) {
-    comparison = std::make_unique<Comparison>(*resultComparison);
-  } else {
-    writeInstruction("cmp", {conditionLocation->asAsm(8), "0"});
-    comparison = std::make_unique<Comparison>(Comparison::Type::Equal);
-  }
-  writeInstruction(comparison->jmpInstruction(true), {endLabel});
+  genBranch(loop->conditionExpression(), false, endLabel, context);
 
+  writeCounter(site, "trips");
   genScope(loop->scope(), context);
 
+  writeSourceLine(loop);
   if (const Parser::Nodes::Node* updateExpression = loop->updateExpression()) {
     genExpression(updateExpression, context);
   }
 
   writeInstruction("jmp", {conditionLabel});
   writeLabel(endLabel);
+
+  m_values.leaveBlock(valueMark);
+}
+
+void Generator::genRotatedLoop(
+    const Parser::Nodes::Loop* loop, const std::string& site, bool unroll, Context& context) {
+  const std::string bodyLabel = ".L" + std::to_string(context.nextLocalLabel());
+  const std::string conditionLabel = ".L" + std::to_string(context.nextLocalLabel());
+  const std::string endLabel = ".L" + std::to_string(context.nextLocalLabel());
+
+  // The condition is tested at the bottom, so each trip takes one branch rather than two
+  writeInstruction("jmp", {conditionLabel});
+  const size_t valueMark = m_values.enterBlock();
+  writeLabel(bodyLabel);
+
+  for (size_t copy = 0; copy < (unroll ? 2 : 1); copy++) {
+    if (copy > 0) {
+      writeSourceLine(loop);
+      genBranch(loop->conditionExpression(), false, endLabel, context);
+    }
+
+    writeCounter(site, "trips");
+    genScope(loop->scope(), context);
+    writeSourceLine(loop);
+    if (const Parser::Nodes::Node* updateExpression = loop->updateExpression()) {
+      genExpression(updateExpression, context);
+    }
+  }
+
+  // The condition runs first on entry, so nothing computed in the body can be reused by it
+  m_values.leaveBlock(valueMark);
+
+  writeLabel(conditionLabel);
+  genBranch(loop->conditionExpression(), true, bodyLabel, context);
+  writeLabel(endLabel);
+
+  m_values.leaveBlock(valueMark);
+}
+
+std::unique_ptr<Comparison> Generator::genCondition(const Parser::Nodes::Node* node, Context& context) {
+  std::unique_ptr<Location> resultLocation = genExpression(node, context);
+  if (const auto resultComparison = dynamic_cast<Comparison*>(resultLocation.get())) {
+    return std::make_unique<Comparison>(*resultComparison);
+  }
+
+  // Any other value is true when its own bytes aren't zero
+  const Sema::ValueType type = m_types.type(node);
+  resultLocation = writeImmediateToReg(std::move(resultLocation), Sema::operationSize(type), context);
+  if (dynamic_cast<MemoryLocation*>(resultLocation.get())) {
+    writeInstruction("cmp", {resultLocation->asAsm(type.size), "0"});
+  } else {
+    writeInstruction("test", {resultLocation->asAsm(type.size), resultLocation->asAsm(type.size)});
+  }
+  return std::make_unique<Comparison>(Comparison::Type::NotEqual);
+}
+
+void Generator::genBranch(const Parser::Nodes::Node* node, bool when, const std::string& label, Context& context) {
+  if (node->type() == NodeType::Expression) {
+    genBranch(node->children().front().get(), when, label, context);
+    return;
+  }
+
+  if (const std::optional<int64_t> constant = m_types.folded(node)) {
+    if ((*constant != 0) == when) {
+      writeInstruction("jmp", {label});
+    }
+    return;
+  }
+
+  if (const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      unaryNode && unaryNode->operation() == Parser::Nodes::UnaryOperationType::Not) {
+    genBranch(unaryNode->operand(), !when, label, context);
+    return;
+  }
+
+  const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+  const bool isAnd = binaryNode && binaryNode->operation() == Parser::Nodes::BinaryOperationType::LogicalAnd;
+  const bool isOr = binaryNode && binaryNode->operation() == Parser::Nodes::BinaryOperationType::LogicalOr;
+  if (!isAnd && !isOr) {
+    const std::unique_ptr<Comparison> comparison = genCondition(node, context);
+    writeInstruction(comparison->jmpInstruction(!when), {label});
+    return;
+  }
+
+  // The left side alone decides a false && or a true ||, so can jump straight to the label when that's the outcome
+  // wanted, and otherwise skips the right side
+  std::string skipLabel;
+  if (isAnd != when) {
+    genBranch(binaryNode->lhs(), when, label, context);
+  } else {
+    skipLabel = ".L" + std::to_string(context.nextLocalLabel());
+    genBranch(binaryNode->lhs(), !when, skipLabel, context);
+  }
+
+  // The right side isn't always evaluated, so nothing it computes can be reused after it
+  const size_t valueMark = m_values.enterBlock();
+  genBranch(binaryNode->rhs(), when, label, context);
+  m_values.leaveBlock(valueMark);
+
+  if (!skipLabel.empty()) {
+    writeLabel(skipLabel);
+  }
+}
+
+void Generator::genSwitch(const Parser::Nodes::Node* node, Context& context) {
+  const auto switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+  if (!switchNode) {
+    throw GenerationException("Expected switch");
+  }
+  const auto& cases = switchNode->cases();
+  const Sema::ValueType type = m_types.type(switchNode->expression());
+
+  // The default case is laid out last, so it falls through to the end rather than jumping there
+  std::vector<size_t> order;
+  std::vector<SwitchValue> values;
+  std::optional<size_t> defaultCase;
+  for (size_t i = 0; i < cases.size(); i++) {
+    if (cases[i].isDefault) {
+      defaultCase = i;
+      continue;
+    }
+    order.push_back(i);
+    for (const int64_t value : cases[i].values) {
+      values.push_back({value, i});
+    }
+  }
+  if (defaultCase) {
+    order.push_back(*defaultCase);
+  }
+  std::ranges::sort(values, {}, &SwitchValue::value);
+
+  const std::optional<int64_t> constant = m_types.folded(switchNode->expression());
+  if (constant) {
+    // Only the case that matches is generated, with nothing to dispatch
+    const auto match = std::ranges::find(values, *constant, &SwitchValue::value);
+    const std::optional<size_t> target = match != values.end() ? std::optional(match->target) : defaultCase;
+    if (target) {
+      const size_t valueMark = m_values.enterBlock();
+      genScope(cases[*target].scope.get(), context);
+      m_values.leaveBlock(valueMark);
+    }
+    return;
+  }
+
+  std::vector<std::string> labels(cases.size());
+  for (std::string& label : labels) {
+    label = ".L" + std::to_string(context.nextLocalLabel());
+  }
+  const std::string endLabel = ".L" + std::to_string(context.nextLocalLabel());
+  const std::string& defaultLabel = defaultCase ? labels[*defaultCase] : endLabel;
+
+  std::unique_ptr<Location> value = genExpression(switchNode->expression(), context);
+  if (values.empty()) {
+    // Only the default case, which is run whatever the value
+    value.reset();
+  } else {
+    // Dispatch works on the value extended to 64 bits, in a register of its own as it may be rebased
+    value = writeComparisonToReg(std::move(value), context);
+    value = writeImmediateToReg(std::move(value), 8, context);
+    if (!dynamic_cast<Context::RegisterHandle*>(value.get())) {
+      std::unique_ptr<Location> extended = nextRegister(context);
+      writeExtension(*extended, *value, type, 8);
+      value = std::move(extended);
+    } else if (type.size < 8) {
+      writeExtension(*value, *value, type, 8);
+    }
+
+    size_t targets = 0;
+    for (const Parser::Nodes::SwitchCase& switchCase : cases) {
+      targets += !switchCase.values.empty();
+    }
+    const SwitchLowering lowering = chooseSwitchLowering(values, targets);
+    m_switchLowerings[static_cast<size_t>(lowering)]++;
+    switch (lowering) {
+      case SwitchLowering::JumpTable:
+        genJumpTable(std::move(value), values, labels, defaultLabel, context);
+        break;
+      case SwitchLowering::BitTest:
+        genBitTests(std::move(value), values, labels, defaultLabel, context);
+        break;
+      case SwitchLowering::DecisionTree:
+        genDecisionTree(*value, values, labels, defaultLabel, type.isSigned, context);
+        value.reset();
+        break;
+    }
+  }
+
+  for (size_t i = 0; i < order.size(); i++) {
+    const Parser::Nodes::Scope* scope = cases[order[i]].scope.get();
+    writeLabel(labels[order[i]]);
+    const size_t valueMark = m_values.enterBlock();
+    genScope(scope, context);
+    m_values.leaveBlock(valueMark);
+
+    const bool returns = !scope->statements().empty() &&
+                         scope->statements().back()->type() == NodeType::ReturnStatement;
+    if (i + 1 < order.size() && !returns) {
+      writeInstruction("jmp", {endLabel});
+    }
+  }
+  writeLabel(endLabel);
+}
+
+void Generator::genJumpTable(std::unique_ptr<Location> value,
+                             std::span<const SwitchValue> values,
+                             const std::vector<std::string>& labels,
+                             const std::string& defaultLabel,
+                             Context& context) {
+  const uint64_t span = switchSpan(values);
+  if (values.front().value != 0) {
+    writeImmediateOperation("sub", *value, values.front().value, context);
+  }
+  // Values below the smallest wrap around to above the largest, so one unsigned comparison rules out both
+  writeInstruction("cmp", {value->asAsm(8), std::to_string(span)});
+  writeInstruction("ja", {defaultLabel});
+
+  const std::string table = ".L" + std::to_string(context.nextLocalLabel());
+  const std::unique_ptr<Location> base = nextRegister(context);
+  writeInstruction("lea", {base->asAsm(8), "[ " + table + " ]"});
+  writeInstruction("jmp", {"[ " + base->asAsm(8) + " + " + value->asAsm(8) + " * 8 ]"});
+
+  // Every value in the range has an entry, those matching no case going to the default
+  m_jumpTables << table << ":\n";
+  auto next = values.begin();
+  for (uint64_t offset = 0; offset <= span; offset++) {
+    const int64_t entry = static_cast<int64_t>(static_cast<uint64_t>(values.front().value) + offset);
+    const std::string& label = next != values.end() && next->value == entry ? labels[(next++)->target] : defaultLabel;
+    m_jumpTables << (offset % 8 == 0 ? "  dq " : ", ") << label << (offset % 8 == 7 || offset == span ? "\n" : "");
+  }
+}
+
+void Generator::genBitTests(std::unique_ptr<Location> value,
+                            std::span<const SwitchValue> values,
+                            const std::vector<std::string>& labels,
+                            const std::string& defaultLabel,
+                            Context& context) {
+  if (values.front().value != 0) {
+    writeImmediateOperation("sub", *value, values.front().value, context);
+  }
+  writeInstruction("cmp", {value->asAsm(8), std::to_string(switchSpan(values))});
+  writeInstruction("ja", {defaultLabel});
+
+  // A bit for each value a case matches, set at its distance from the smallest value
+  std::vector<std::pair<size_t, uint64_t>> masks;
+  for (const SwitchValue& switchValue : values) {
+    auto mask = std::ranges::find(masks, switchValue.target, &std::pair<size_t, uint64_t>::first);
+    if (mask == masks.end()) {
+      mask = masks.insert(mask, {switchValue.target, 0});
+    }
+    const uint64_t bit = static_cast<uint64_t>(switchValue.value) - static_cast<uint64_t>(values.front().value);
+    mask->second |= uint64_t{1} << bit;
+  }
+
+  const std::unique_ptr<Location> maskRegister = nextRegister(context);
+  for (const auto& [target, mask] : masks) {
+    // Writing the low half of a register clears the rest, so a mask that fits takes the shorter encoding
+    const size_t size = mask <= std::numeric_limits<uint32_t>::max() ? 4 : 8;
+    writeInstruction("mov", {maskRegister->asAsm(size), std::to_string(mask)});
+    writeInstruction("bt", {maskRegister->asAsm(8), value->asAsm(8)});
+    writeInstruction("jc", {labels[target]});
+  }
+  writeInstruction("jmp", {defaultLabel});
+}
+
+void Generator::genDecisionTree(const Location& value,
+                                std::span<const SwitchValue> values,
+                                const std::vector<std::string>& labels,
+                                const std::string& defaultLabel,
+                                bool isSigned,
+                                Context& context) {
+  // A few values are quicker to compare against in turn than to split
+  if (values.size() <= 3) {
+    for (const SwitchValue& switchValue : values) {
+      writeImmediateOperation("cmp", value, switchValue.value, context);
+      writeInstruction("je", {labels[switchValue.target]});
+    }
+    writeInstruction("jmp", {defaultLabel});
+    return;
+  }
+
+  // One comparison against the middle value both finds its case and picks the half to search
+  const size_t middle = values.size() / 2;
+  const std::string lowerLabel = ".L" + std::to_string(context.nextLocalLabel());
+  writeImmediateOperation("cmp", value, values[middle].value, context);
+  writeInstruction("je", {labels[values[middle].target]});
+  writeInstruction(isSigned ? "jl" : "jb", {lowerLabel});
+  genDecisionTree(value, values.subspan(middle + 1), labels, defaultLabel, isSigned, context);
+  writeLabel(lowerLabel);
+  genDecisionTree(value, values.first(middle), labels, defaultLabel, isSigned, context);
 }
 
 std::unique_ptr<Location> Generator::genExpression(const Parser::Nodes::Node* node, Context& context) {
@@ -225,6 +938,8 @@ std::unique_ptr<Location> Generator::genExpression(const Parser::Nodes::Node* no
       return genBinaryOperation(node, context);
     case NodeType::UnaryOperation:
       return genUnaryOperation(node, context);
+    case NodeType::Intrinsic:
+      return genIntrinsic(node, context);
     default:
       return genBaseOperation(node, context);
   }
@@ -232,82 +947,427 @@ std::unique_ptr<Location> Generator::genExpression(const Parser::Nodes::Node* no
 
 std::unique_ptr<Location> Generator::genBinaryOperation(const Parser::Nodes::Node* node, Context& context) {
   const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
-  std::unique_ptr<Location> lhsLoc = genExpression(binaryNode->lhs(), context);
-  std::unique_ptr<Location> rhsLoc = genExpression(binaryNode->rhs(), context);
+  if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign) {
+    return genAssignment(binaryNode, context);
+  }
+
+  std::optional<ValueTable::Value> value;
+  if (m_values.isRepeated(node)) {
+    value = m_values.number(node, context);
+    if (std::unique_ptr<Location> reused = reuseValue(node, value, context)) {
+      return reused;
+    }
+  }
+
+  if (const std::optional<int64_t> folded = m_types.folded(node)) {
+    return std::make_unique<IntegerLiteral>(std::to_string(*folded));
+  }
+
+  if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::LogicalAnd ||
+      binaryNode->operation() == Parser::Nodes::BinaryOperationType::LogicalOr) {
+    // Only needed as a value, so the result is set on the way out of the same jumps a branch would take
+    std::unique_ptr<Location> resultLocation = nextRegister(context);
+    const std::string falseLabel = ".L" + std::to_string(context.nextLocalLabel());
+    writeInstruction("xor", {resultLocation->asAsm(4), resultLocation->asAsm(4)});
+    genBranch(node, false, falseLabel, context);
+    writeInstruction("mov", {resultLocation->asAsm(4), "1"});
+    writeLabel(falseLabel);
+    return resultLocation;
+  }
+
+  const Sema::ValueType operandType = m_types.operandType(node);
+  const size_t size = Sema::operationSize(operandType);
+  const Parser::Nodes::Node* lhsNode = binaryNode->lhs();
+  const Parser::Nodes::Node* rhsNode = binaryNode->rhs();
+
+  bool sameOperands = false;
+  if (m_values.hasSameOperands(node)) {
+    const std::optional<ValueTable::Value> lhsValue = m_values.number(lhsNode, context);
+    const std::optional<ValueTable::Value> rhsValue = m_values.number(rhsNode, context);
+    sameOperands = lhsValue && rhsValue && lhsValue->number == rhsValue->number;
+  }
 
-  lhsLoc = writeComparisonToReg(std::move(lhsLoc), context);
-  lhsLoc = writeImmediateToReg(std::move(lhsLoc), context);
-  rhsLoc = writeComparisonToReg(std::move(rhsLoc), context);
+  if (const std::optional<Selection> selection =
+          sameOperands ? std::nullopt : selectPattern(binaryNode, m_types, m_selections)) {
+    std::unique_ptr<Location> resultLocation = genPattern(*selection, operandType, context);
+    rememberValue(node, value, *resultLocation, context);
+    return resultLocation;
+  }
+
+  const std::optional<Comparison::Type> comparison = comparisonType(binaryNode->operation());
+  std::unique_ptr<Location> lhsLoc;
+  std::unique_ptr<Location> rhsLoc;
+  if (sameOperands) {
+    // Both sides are the same computation, so it's done once and its register read as the right hand side
+    lhsLoc = convert(genExpression(lhsNode, context), m_types.type(lhsNode), operandType, context);
+    lhsLoc = writeImmediateToReg(std::move(lhsLoc), size, context);
+    lhsLoc = writeMemoryToReg(std::move(lhsLoc), operandType, context);
+    rhsLoc = std::make_unique<Register>(dynamic_cast<const Context::RegisterHandle&>(*lhsLoc).reg());
+  } else {
+    const size_t lhsNeed = registerNeed(lhsNode, true);
+    const size_t rhsNeed = registerNeed(rhsNode, false);
+
+    // Evaluate whichever side needs more registers first (Sethi-Ullman), unless the order could be observed
+    const bool rhsFirst = rhsNeed > lhsNeed && !Opt::hasSideEffects(lhsNode, m_selections.sideEffects) &&
+                          !Opt::hasSideEffects(rhsNode, m_selections.sideEffects);
+    if (rhsFirst) {
+      rhsLoc = genOperand(rhsNode, lhsNode, lhsNeed, context);
+      lhsLoc = genExpression(lhsNode, context);
+    } else {
+      lhsLoc = genOperand(lhsNode, rhsNode, rhsNeed, context);
+      rhsLoc = genExpression(rhsNode, context);
+    }
+
+    // Narrow values are only valid in their own bytes, so are compared at their own width. That lets a variable at
+    // least as wide as the comparison be compared where it is
+    const auto convertOperand = [&](std::unique_ptr<Location> loc, const Parser::Nodes::Node* operand) {
+      if (comparison && dynamic_cast<MemoryLocation*>(loc.get()) && m_types.type(operand).size >= operandType.size) {
+        return loc;
+      }
+      return convert(std::move(loc), m_types.type(operand), operandType, context);
+    };
+
+    // Both sides are converted before either is loaded, as a comparison on the right still needs its flags
+    lhsLoc = convertOperand(std::move(lhsLoc), lhsNode);
+    rhsLoc = convertOperand(std::move(rhsLoc), rhsNode);
+
+    // The result is written over the left hand side, so it has to be a register we own
+    lhsLoc = writeImmediateToReg(std::move(lhsLoc), size, context);
+    if (!comparison || dynamic_cast<MemoryLocation*>(rhsLoc.get())) {
+      lhsLoc = writeMemoryToReg(std::move(lhsLoc), operandType, context);
+    }
+    rhsLoc = writeWideImmediateToReg(std::move(rhsLoc), size, context);
+  }
+
+  if (comparison) {
+    writeInstruction("cmp", {lhsLoc->asAsm(operandType.size), rhsLoc->asAsm(operandType.size)});
+    return std::make_unique<Comparison>(*comparison, operandType.isSigned);
+  }
 
   switch (binaryNode->operation()) {
     case Parser::Nodes::BinaryOperationType::Add:
-      writeInstruction("add", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
+      writeInstruction("add", {lhsLoc->asAsm(size), rhsLoc->asAsm(size)});
       break;
     case Parser::Nodes::BinaryOperationType::Subtract:
-      writeInstruction("sub", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
+      writeInstruction("sub", {lhsLoc->asAsm(size), rhsLoc->asAsm(size)});
       break;
     case Parser::Nodes::BinaryOperationType::Multiply:
-      writeInstruction("imul", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      break;
-    case Parser::Nodes::BinaryOperationType::Divide:
-      // TODO: IDIV needs its LHS in RDX:RAX first and stores the Quotient in RAX and remainder in RDX
-      // instruction("idiv", {resultReg, rhsReg});
-      break;
-    case Parser::Nodes::BinaryOperationType::Equal:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::Equal);
-    case Parser::Nodes::BinaryOperationType::NotEqual:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::NotEqual);
-    case Parser::Nodes::BinaryOperationType::GreaterEqual:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::GreaterEqual);
-    case Parser::Nodes::BinaryOperationType::GreaterThan:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::Greater);
-    case Parser::Nodes::BinaryOperationType::LessEqual:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::LessEqual);
-    case Parser::Nodes::BinaryOperationType::LessThan:
-      rhsLoc = writeImmediateToReg(std::move(rhsLoc), context);
-      writeInstruction("cmp", {lhsLoc->asAsm(8), rhsLoc->asAsm(8)});
-      return std::make_unique<Comparison>(Comparison::Type::Less);
-    case Parser::Nodes::BinaryOperationType::Assign:
-      // TODO: Assignment
+      writeInstruction("imul", {lhsLoc->asAsm(size), rhsLoc->asAsm(size)});
       break;
     default:
       throw GenerationException("Unhandled binary operation");
   }
+
+  rememberValue(node, value, *lhsLoc, context);
   return lhsLoc;
 }
 
+std::unique_ptr<Location> Generator::genOperand(
+    const Parser::Nodes::Node* node, const Parser::Nodes::Node* other, size_t otherNeed, Context& context) {
+  std::unique_ptr<Location> location = genExpression(node, context);
+
+  // Flags won't survive evaluating the other side
+  location = writeComparisonToReg(std::move(location), context);
+
+  // Nor will a variable's value if the other side writes to it
+  if (Opt::hasSideEffects(other, m_selections.sideEffects)) {
+    location = writeMemoryToReg(std::move(location), m_types.type(node), context);
+  }
+
+  // Out of registers for the other side, so park this one on the stack until it's needed
+  if (dynamic_cast<Context::RegisterHandle*>(location.get()) &&
+      otherNeed > context.freeRegisters() + m_values.heldCount()) {
+    std::unique_ptr<Location> spillLocation = context.nextSpillSlot();
+    writeInstruction("mov", {spillLocation->asAsm(8), location->asAsm(8)});
+    return spillLocation;
+  }
+
+  return location;
+}
+
+size_t Generator::registerNeed(const Parser::Nodes::Node* node, bool isLeft) {
+  switch (node->type()) {
+    case NodeType::Expression:
+      return node->children().empty() ? 0 : registerNeed(node->children().front().get(), isLeft);
+    case NodeType::Identifier:
+    case NodeType::IntegerLiteral:
+      // A right hand leaf can be used directly as a memory or immediate operand
+      return isLeft ? 1 : 0;
+    default:
+      break;
+  }
+
+  if (const auto it = m_registerNeeds.find(node); it != m_registerNeeds.end()) {
+    return it->second;
+  }
+
+  size_t need = 1;
+  if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node)) {
+    if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign) {
+      need = registerNeed(binaryNode->rhs(), true);
+    } else if (const std::optional<Selection> selection = selectPattern(binaryNode, m_types, m_selections);
+               selection && selection->pattern->kind == PatternKind::Address) {
+      // An address holds its base while the index is evaluated, and the sum while each remaining term is
+      const PatternMatch& match = selection->match;
+      if (match.base) {
+        need = std::max(need, registerNeed(match.base, true));
+      }
+      if (match.index) {
+        need = std::max(need, registerNeed(match.index, true) + (match.base ? 1 : 0));
+      }
+      for (const Parser::Nodes::Node* term : match.rest) {
+        need = std::max(need, registerNeed(term, true) + 1);
+      }
+    } else {
+      const size_t lhsNeed = registerNeed(binaryNode->lhs(), true);
+      const size_t rhsNeed = registerNeed(binaryNode->rhs(), false);
+      need = lhsNeed == rhsNeed ? lhsNeed + 1 : std::max(lhsNeed, rhsNeed);
+    }
+  } else if (const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)) {
+    need = std::max<size_t>(1, registerNeed(unaryNode->operand(), true));
+  } else if (node->type() == NodeType::Intrinsic) {
+    // The value is held while a count is evaluated, and the sequences standing in for a missing instruction need a
+    // scratch register besides
+    need = 2;
+    const auto& arguments = node->children();
+    for (size_t i = 0; i < arguments.size(); i++) {
+      need = std::max(need, registerNeed(arguments[i].get(), true) + i);
+    }
+  } else if (node->type() == NodeType::Call) {
+    // Every earlier argument may still be held while an argument is evaluated, and the call writes all the argument
+    // registers, so it's best evaluated before values that would have to be saved around it
+    need = argumentRegisters.size();
+    const auto& arguments = node->children();
+    for (size_t i = 0; i < arguments.size(); i++) {
+      need = std::max(need, registerNeed(arguments[i].get(), true) + i);
+    }
+  }
+
+  m_registerNeeds.try_emplace(node, need);
+  return need;
+}
+
+std::unique_ptr<Location> Generator::genPattern(const Selection& selection, Sema::ValueType type, Context& context) {
+  const PatternMatch& match = selection.match;
+  const size_t size = Sema::operationSize(type);
+  switch (selection.pattern->kind) {
+    case PatternKind::Address:
+      return genAddress(match, type, context);
+    case PatternKind::MultiplyByShift: {
+      std::unique_ptr<Location> resultLocation = genRegisterOperand(match.base, type, context);
+      writeInstruction("shl", {resultLocation->asAsm(size), std::to_string(match.immediate)});
+      return resultLocation;
+    }
+    case PatternKind::MultiplyByAddress: {
+      std::unique_ptr<Location> resultLocation = genRegisterOperand(match.base, type, context);
+      const std::string reg = resultLocation->asAsm(8);
+      writeInstruction(
+          "lea", {resultLocation->asAsm(size), "[ " + reg + " + " + reg + "*" + std::to_string(match.scale) + " ]"});
+      return resultLocation;
+    }
+    case PatternKind::MultiplyByImmediate: {
+      std::unique_ptr<Location> sourceLocation = genExpression(match.base, context);
+      sourceLocation = convert(std::move(sourceLocation), m_types.type(match.base), type, context);
+      sourceLocation = writeImmediateToReg(std::move(sourceLocation), size, context);
+      // A variable is read straight from memory into a new register, otherwise the register is reused
+      std::unique_ptr<Location> resultLocation =
+          dynamic_cast<MemoryLocation*>(sourceLocation.get()) ? nextRegister(context) : std::move(sourceLocation);
+      const Location& source = sourceLocation ? *sourceLocation : *resultLocation;
+      writeInstruction("imul", {resultLocation->asAsm(size), source.asAsm(size), std::to_string(match.immediate)});
+      return resultLocation;
+    }
+    case PatternKind::IncrementMemory:
+    case PatternKind::ArithmeticToMemory:
+    case PatternKind::ShiftMemory:
+      return genReadModifyWrite(selection, type, context);
+  }
+  throw GenerationException("Unhandled instruction pattern");
+}
+
+std::unique_ptr<Location> Generator::genAddress(const PatternMatch& match, Sema::ValueType type, Context& context) {
+  const size_t size = Sema::operationSize(type);
+  std::unique_ptr<Location> baseLocation;
+  std::unique_ptr<Location> indexLocation;
+  if (match.base && match.index) {
+    baseLocation = genOperand(match.base, match.index, registerNeed(match.index, true), context);
+    indexLocation = genRegisterOperand(match.index, type, context);
+    baseLocation = convert(std::move(baseLocation), m_types.type(match.base), type, context);
+    baseLocation = writeImmediateToReg(std::move(baseLocation), size, context);
+    baseLocation = writeMemoryToReg(std::move(baseLocation), type, context);
+  } else if (match.base) {
+    baseLocation = genRegisterOperand(match.base, type, context);
+  } else {
+    indexLocation = genRegisterOperand(match.index, type, context);
+  }
+
+  std::string address = "[ ";
+  if (baseLocation) {
+    address += baseLocation->asAsm(8);
+  }
+  if (indexLocation) {
+    address += (baseLocation ? " + " : "") + indexLocation->asAsm(8);
+    if (match.scale != 1) {
+      address += "*" + std::to_string(match.scale);
+    }
+  }
+  if (match.immediate != 0) {
+    address += (match.immediate < 0 ? " - " : " + ") + std::to_string(std::abs(match.immediate));
+  }
+  address += " ]";
+
+  // Only the low bytes of the address are kept, so operands narrower than a pointer can be added at full width
+  std::unique_ptr<Location> resultLocation = baseLocation ? std::move(baseLocation) : std::move(indexLocation);
+  writeInstruction("lea", {resultLocation->asAsm(size), address});
+  indexLocation.reset();
+
+  for (const Parser::Nodes::Node* term : match.rest) {
+    // The sum is held while each term is evaluated, so is parked on the stack if a term needs every register
+    if (dynamic_cast<Context::RegisterHandle*>(resultLocation.get()) &&
+        registerNeed(term, true) > context.freeRegisters() + m_values.heldCount()) {
+      std::unique_ptr<Location> spillLocation = context.nextSpillSlot();
+      writeInstruction("mov", {spillLocation->asAsm(8), resultLocation->asAsm(8)});
+      resultLocation = std::move(spillLocation);
+    }
+
+    std::unique_ptr<Location> termLocation = genExpression(term, context);
+    termLocation = convert(std::move(termLocation), m_types.type(term), type, context);
+    if (dynamic_cast<Context::RegisterHandle*>(resultLocation.get())) {
+      termLocation = writeWideImmediateToReg(std::move(termLocation), size, context);
+      writeInstruction("add", {resultLocation->asAsm(size), termLocation->asAsm(size)});
+      continue;
+    }
+    // A parked sum is added to the term instead, which then holds the result
+    termLocation = writeImmediateToReg(std::move(termLocation), size, context);
+    termLocation = writeMemoryToReg(std::move(termLocation), type, context);
+    writeInstruction("add", {termLocation->asAsm(size), resultLocation->asAsm(size)});
+    resultLocation = std::move(termLocation);
+  }
+  return resultLocation;
+}
+
+std::unique_ptr<Location> Generator::genReadModifyWrite(
+    const Selection& selection, Sema::ValueType type, Context& context) {
+  const PatternMatch& match = selection.match;
+  const std::optional<Context::VariableContext> varContext = context.variable(match.target->token()->value.value());
+  if (!varContext) {
+    throw GenerationException("Unknown identifier in assignment");
+  }
+  auto location = std::make_unique<MemoryLocation>(varContext->address());
+
+  switch (selection.pattern->kind) {
+    case PatternKind::IncrementMemory:
+      writeInstruction(match.immediate > 0 ? "inc" : "dec", {location->asAsm(type.size)});
+      break;
+    case PatternKind::ArithmeticToMemory: {
+      std::unique_ptr<Location> valueLocation = genExpression(match.base, context);
+      valueLocation = convert(std::move(valueLocation), m_types.type(match.base), type, context);
+      valueLocation = writeWideImmediateToReg(std::move(valueLocation), type.size, context);
+      valueLocation = writeMemoryToReg(std::move(valueLocation), type, context);
+      writeInstruction(match.operation == Parser::Nodes::BinaryOperationType::Add ? "add" : "sub",
+                       {location->asAsm(type.size), valueLocation->asAsm(type.size)});
+      break;
+    }
+    case PatternKind::ShiftMemory:
+      writeInstruction("shl", {location->asAsm(type.size), std::to_string(match.immediate)});
+      break;
+    default:
+      throw GenerationException("Unhandled instruction pattern");
+  }
+
+  m_values.store(varContext->offset);
+  return location;
+}
+
+std::unique_ptr<Location> Generator::genRegisterOperand(
+    const Parser::Nodes::Node* node, Sema::ValueType type, Context& context) {
+  std::unique_ptr<Location> location = genExpression(node, context);
+  location = convert(std::move(location), m_types.type(node), type, context);
+  location = writeImmediateToReg(std::move(location), Sema::operationSize(type), context);
+  return writeMemoryToReg(std::move(location), type, context);
+}
+
+std::unique_ptr<Location> Generator::genAssignment(const Parser::Nodes::BinaryOperation* node, Context& context) {
+  if (node->lhs()->type() != NodeType::Identifier) {
+    throw GenerationException("Left hand side of assignment must be a variable");
+  }
+
+  const Sema::ValueType type = m_types.type(node);
+  if (const std::optional<Selection> selection = selectPattern(node, m_types, m_selections)) {
+    return genPattern(*selection, type, context);
+  }
+
+  const std::optional<Context::VariableContext> varContext = context.variable(node->lhs()->token()->value.value());
+  if (!varContext) {
+    throw GenerationException("Unknown identifier in assignment");
+  }
+
+  std::unique_ptr<Location> valueLocation = genExpression(node->rhs(), context);
+  valueLocation = convert(std::move(valueLocation), m_types.type(node->rhs()), type, context);
+  valueLocation = writeWideImmediateToReg(std::move(valueLocation), type.size, context);
+  valueLocation = writeMemoryToReg(std::move(valueLocation), type, context);
+
+  auto location = std::make_unique<MemoryLocation>(varContext->address());
+  writeInstruction("mov", {location->asAsm(type.size), valueLocation->asAsm(type.size)});
+  m_values.store(varContext->offset);
+  return location;
+}
+
 std::unique_ptr<Location> Generator::genUnaryOperation(const Parser::Nodes::Node* node, Context& context) {
   const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+  const bool modifiesOperand = unaryNode->operation() == Parser::Nodes::UnaryOperationType::Increment ||
+                               unaryNode->operation() == Parser::Nodes::UnaryOperationType::Decrement;
+
+  std::optional<ValueTable::Value> value;
+  if (!modifiesOperand && m_values.isRepeated(node)) {
+    value = m_values.number(node, context);
+    if (std::unique_ptr<Location> reused = reuseValue(node, value, context)) {
+      return reused;
+    }
+  }
+
+  // Logical not is the operand's own test the other way round, left in the flags
+  if (unaryNode->operation() == Parser::Nodes::UnaryOperationType::Not) {
+    if (const std::optional<int64_t> folded = m_types.folded(node)) {
+      return std::make_unique<IntegerLiteral>(std::to_string(*folded));
+    }
+    return std::make_unique<Comparison>(genCondition(unaryNode->operand(), context)->inverse());
+  }
+
+  const Sema::ValueType type = m_types.type(node);
+  const size_t size = Sema::operationSize(type);
   std::unique_ptr<Location> resultLocation = genExpression(unaryNode->operand(), context);
-  resultLocation = writeComparisonToReg(std::move(resultLocation), context);
-  resultLocation = writeImmediateToReg(std::move(resultLocation), context);
+  if (!modifiesOperand) {
+    // Incrementing a variable updates it in place, anything else works on a copy
+    resultLocation = convert(std::move(resultLocation), m_types.type(unaryNode->operand()), type, context);
+    resultLocation = writeImmediateToReg(std::move(resultLocation), size, context);
+    resultLocation = writeMemoryToReg(std::move(resultLocation), type, context);
+  }
+
+  std::optional<Context::VariableContext> varContext;
+  if (modifiesOperand && unaryNode->operand()->type() == NodeType::Identifier) {
+    varContext = context.variable(unaryNode->operand()->token()->value.value());
+  }
 
   switch (unaryNode->operation()) {
     case Parser::Nodes::UnaryOperationType::Negate:
-      writeInstruction("neg", {resultLocation->asAsm(8)});
-      break;
-    case Parser::Nodes::UnaryOperationType::Not:
-      writeInstruction("not", {resultLocation->asAsm(8)});
+      writeInstruction("neg", {resultLocation->asAsm(size)});
       break;
     case Parser::Nodes::UnaryOperationType::Decrement:
-      writeInstruction("dec", {resultLocation->asAsm(8)});
+      // Only the variable's own bytes are touched when it's updated in memory
+      writeInstruction("dec", {resultLocation->asAsm(type.size)});
       break;
     case Parser::Nodes::UnaryOperationType::Increment:
-      writeInstruction("inc", {resultLocation->asAsm(8)});
+      writeInstruction("inc", {resultLocation->asAsm(type.size)});
       break;
     default:
       throw GenerationException("Unhandled unary operation");
   }
+
+  if (varContext) {
+    m_values.store(varContext->offset);
+  }
+
+  rememberValue(node, value, *resultLocation, context);
   return resultLocation;
 }
 
@@ -317,19 +1377,464 @@ std::unique_ptr<Location> Generator::genBaseOperation(const Parser::Nodes::Node*
       return std::make_unique<IntegerLiteral>(node->token()->value.value());
       break;
     case NodeType::Identifier: {
+      if (const std::optional<Sema::ExpressionTypes::Constant> constant = m_types.constant(node)) {
+        return std::make_unique<IntegerLiteral>(std::to_string(constant->value));
+      }
       const std::string identName = node->token()->value.value();
       const std::optional<Context::VariableContext> varContext = context.variable(identName);
 
       if (!varContext) {
         throw GenerationException("Unknown identifier in expression");
       }
-      return std::make_unique<MemoryLocation>("[ rsp + " + std::to_string(varContext->offset) + " ]");
+      return std::make_unique<MemoryLocation>(varContext->address());
     }
+    case NodeType::Call:
+      if (const std::optional<Sema::ExpressionTypes::Constant> constant = m_types.constant(node)) {
+        // The result is known, so the call is only made for whatever else the callee does
+        if (constant->evaluate) {
+          genCall(node, context);
+        }
+        return std::make_unique<IntegerLiteral>(std::to_string(constant->value));
+      }
+      return genCall(node, context);
     default:
       throw GenerationException("Unhandled expression");
   }
 }
 
+std::unique_ptr<Location> Generator::genCall(const Parser::Nodes::Node* node, Context& context) {
+  const Sema::FunctionSignature& signature = m_types.call(node).signature;
+  const auto& argumentNodes = node->children();
+
+  // Held values would only have to be saved and restored around the call
+  while (m_values.evict()) {
+  }
+
+  // Arguments are evaluated left to right, and all of them before any are put in place, as a call in a later
+  // argument would overwrite the argument registers and the outgoing stack area
+  std::vector<std::unique_ptr<Location>> arguments;
+  for (size_t i = 0; i < argumentNodes.size(); i++) {
+    const Parser::Nodes::Node* argumentNode = argumentNodes[i].get();
+    const Sema::ValueType type = signature.parameters[i];
+    std::unique_ptr<Location> argument = genExpression(argumentNode, context);
+    argument = convert(std::move(argument), m_types.type(argumentNode), type, context);
+
+    size_t laterNeed = 0;
+    bool laterSideEffects = false;
+    for (size_t j = i + 1; j < argumentNodes.size(); j++) {
+      laterNeed = std::max(laterNeed, registerNeed(argumentNodes[j].get(), true));
+      laterSideEffects =
+          laterSideEffects || Opt::hasSideEffects(argumentNodes[j].get(), m_selections.sideEffects);
+    }
+    // A later argument might write to the variable this one reads
+    if (laterSideEffects) {
+      argument = writeMemoryToReg(std::move(argument), type, context);
+    }
+    // Out of registers for the later arguments, so park this one on the stack until the call
+    if (dynamic_cast<Context::RegisterHandle*>(argument.get()) && laterNeed > context.freeRegisters()) {
+      std::unique_ptr<Location> spillLocation = context.nextSpillSlot();
+      writeInstruction("mov", {spillLocation->asAsm(8), argument->asAsm(8)});
+      argument = std::move(spillLocation);
+    }
+    arguments.push_back(std::move(argument));
+  }
+
+  // Stack arguments go above the callee's shadow space
+  for (size_t i = argumentRegisters.size(); i < arguments.size(); i++) {
+    const size_t size = signature.parameters[i].size;
+    std::unique_ptr<Location> argument = writeWideImmediateToReg(std::move(arguments[i]), size, context);
+    argument = writeMemoryToReg(std::move(argument), signature.parameters[i], context);
+    const MemoryLocation location{
+        "[ rsp + " + std::to_string(shadowSpace + 8 * (i - argumentRegisters.size())) + " ]"};
+    writeInstruction("mov", {location.asAsm(size), argument->asAsm(size)});
+  }
+  arguments.resize(std::min(arguments.size(), argumentRegisters.size()));
+
+  // Anything else held in a register the call clobbers is saved around it
+  std::vector<Register> savedRegisters = context.liveCallerSavedRegisters();
+  std::erase_if(savedRegisters, [&arguments](const Register& reg) {
+    return std::ranges::any_of(arguments, [&reg](const std::unique_ptr<Location>& argument) {
+      const auto* handle = dynamic_cast<const Context::RegisterHandle*>(argument.get());
+      return handle && handle->reg() == reg;
+    });
+  });
+  std::vector<std::unique_ptr<Location>> saveSlots;
+  for (const Register& reg : savedRegisters) {
+    std::unique_ptr<Location>& slot = saveSlots.emplace_back(context.nextSpillSlot());
+    writeInstruction("mov", {slot->asAsm(8), reg.asAsm(8)});
+  }
+
+  // Register arguments are moved into place first, as loading the others could overwrite them
+  std::vector<std::pair<Register, Register>> moves;
+  for (size_t i = 0; i < arguments.size(); i++) {
+    if (const auto* handle = dynamic_cast<const Context::RegisterHandle*>(arguments[i].get())) {
+      moves.emplace_back(argumentRegisters[i], handle->reg());
+    }
+  }
+  writeArgumentMoves(std::move(moves));
+  for (size_t i = 0; i < arguments.size(); i++) {
+    if (!dynamic_cast<const Context::RegisterHandle*>(arguments[i].get())) {
+      writeMove(argumentRegisters[i], *arguments[i], Sema::operationSize(signature.parameters[i]));
+    }
+  }
+  arguments.clear();
+
+  writeInstruction("call", {"cep_" + signature.name});
+  // The callee may have written any of the module variables
+  for (const size_t offset : context.moduleVariableOffsets()) {
+    m_values.store(offset);
+  }
+
+  // The result comes back in rax, extended to at least 32 bits
+  std::unique_ptr<Location> resultLocation = nextRegister(context);
+  writeMove(*resultLocation, Register(Register::Kind::Original, "a"), Sema::operationSize(signature.returnType));
+
+  for (size_t i = 0; i < savedRegisters.size(); i++) {
+    writeInstruction("mov", {savedRegisters[i].asAsm(8), saveSlots[i]->asAsm(8)});
+  }
+  return resultLocation;
+}
+
+std::unique_ptr<Location> Generator::genIntrinsic(const Parser::Nodes::Node* node, Context& context) {
+  if (const std::optional<int64_t> folded = m_types.folded(node)) {
+    return std::make_unique<IntegerLiteral>(std::to_string(*folded));
+  }
+
+  const auto* intrinsic = dynamic_cast<const Parser::Nodes::Intrinsic*>(node);
+  const Parser::Nodes::Node* argument = node->children().empty() ? nullptr : node->children().front().get();
+  const Sema::ValueType type = m_types.type(node);
+  const size_t size = Sema::operationSize(type);
+  const size_t width = type.size * 8;
+  switch (intrinsic->intrinsic()) {
+    case IntrinsicType::PopCount:
+      return genPopCount(genZeroExtended(argument, type, context), type, context);
+    case IntrinsicType::LeadingZeros: {
+      std::unique_ptr<Location> value = genZeroExtended(argument, type, context);
+      if (m_options.target.bitCounts) {
+        writeInstruction("lzcnt", {value->asAsm(size), value->asAsm(size)});
+        // A narrow value is counted in 32 bits
+        if (width < 32) {
+          writeInstruction("sub", {value->asAsm(size), std::to_string(32 - width)});
+        }
+        return value;
+      }
+
+      // bsr finds the highest set bit, whose index an xor turns into the bits above it. It sets the zero flag instead
+      // for zero, which is replaced by a value the xor turns into the width.
+      const std::unique_ptr<Location> zero = nextRegister(context);
+      writeInstruction("mov", {zero->asAsm(4), std::to_string(2 * width - 1)});
+      writeInstruction("bsr", {value->asAsm(size), value->asAsm(size)});
+      writeInstruction("cmovz", {value->asAsm(size), zero->asAsm(size)});
+      writeInstruction("xor", {value->asAsm(size), std::to_string(width - 1)});
+      return value;
+    }
+    case IntrinsicType::TrailingZeros: {
+      std::unique_ptr<Location> value = genRegisterOperand(argument, type, context);
+      const std::string_view count = m_options.target.bitCounts ? "tzcnt" : "bsf";
+      if (width < 32) {
+        // Setting the bit above a narrow value stops the count there, so there's never a zero for bsf to miss
+        writeInstruction("or", {value->asAsm(4), std::to_string(1 << width)});
+        writeInstruction(count, {value->asAsm(4), value->asAsm(4)});
+        return value;
+      }
+      if (m_options.target.bitCounts) {
+        writeInstruction(count, {value->asAsm(size), value->asAsm(size)});
+        return value;
+      }
+      const std::unique_ptr<Location> zero = nextRegister(context);
+      writeInstruction("mov", {zero->asAsm(4), std::to_string(width)});
+      writeInstruction(count, {value->asAsm(size), value->asAsm(size)});
+      writeInstruction("cmovz", {value->asAsm(size), zero->asAsm(size)});
+      return value;
+    }
+    case IntrinsicType::ByteSwap: {
+      std::unique_ptr<Location> value = genRegisterOperand(argument, type, context);
+      // bswap is undefined on 16 bit registers, where swapping the two bytes is a rotate
+      if (width == 16) {
+        writeInstruction("rol", {value->asAsm(2), "8"});
+      } else if (width >= 32) {
+        writeInstruction("bswap", {value->asAsm(size)});
+      }
+      return value;
+    }
+    case IntrinsicType::RotateLeft:
+    case IntrinsicType::RotateRight:
+      return genRotate(intrinsic, type, context);
+    case IntrinsicType::ReadTimestamp:
+      return genReadTimestamp(context);
+    case IntrinsicType::PrefetchT0:
+    case IntrinsicType::PrefetchNta: {
+      const std::unique_ptr<Location> address = genRegisterOperand(argument, type, context);
+      const std::string operand = "[ " + address->asAsm(8) + " ]";
+      writeInstruction(intrinsic->intrinsic() == IntrinsicType::PrefetchT0 ? "prefetcht0" : "prefetchnta", {operand});
+      return nullptr;
+    }
+    case IntrinsicType::Pause:
+      writeInstruction("pause", {});
+      return nullptr;
+  }
+  throw GenerationException("Unhandled intrinsic");
+}
+
+std::unique_ptr<Location> Generator::genZeroExtended(
+    const Parser::Nodes::Node* node, Sema::ValueType type, Context& context) {
+  std::unique_ptr<Location> location = genExpression(node, context);
+  location = convert(std::move(location), m_types.type(node), type, context);
+  location = writeImmediateToReg(std::move(location), Sema::operationSize(type), context);
+
+  const Sema::ValueType bits{type.size, false};
+  if (dynamic_cast<MemoryLocation*>(location.get())) {
+    return writeMemoryToReg(std::move(location), bits, context);
+  }
+  if (type.size < 4) {
+    writeExtension(*location, *location, bits, 4);
+  }
+  return location;
+}
+
+std::unique_ptr<Location> Generator::genPopCount(
+    std::unique_ptr<Location> value, Sema::ValueType type, Context& context) {
+  const size_t size = Sema::operationSize(type);
+  if (m_options.target.popcnt) {
+    writeInstruction("popcnt", {value->asAsm(size), value->asAsm(size)});
+    return value;
+  }
+
+  // Without popcnt the bits are summed in pairs, then nibbles, then bytes, and the bytes added up by a multiply into
+  // the top one. Masks wider than an immediate are loaded into a register first.
+  const std::unique_ptr<Location> scratch = nextRegister(context);
+  const std::unique_ptr<Location> wideMask = size == 8 ? nextRegister(context) : nullptr;
+  const auto mask = [&](uint64_t pattern) -> std::string {
+    if (!wideMask) {
+      return std::to_string(pattern & 0xffffffff);
+    }
+    writeInstruction("mov", {wideMask->asAsm(8), std::to_string(pattern)});
+    return wideMask->asAsm(8);
+  };
+  const std::string bits = value->asAsm(size);
+  const std::string temp = scratch->asAsm(size);
+
+  writeInstruction("mov", {temp, bits});
+  writeInstruction("shr", {temp, "1"});
+  writeInstruction("and", {temp, mask(0x5555555555555555)});
+  writeInstruction("sub", {bits, temp});
+
+  const std::string pairs = mask(0x3333333333333333);
+  writeInstruction("mov", {temp, bits});
+  writeInstruction("shr", {bits, "2"});
+  writeInstruction("and", {temp, pairs});
+  writeInstruction("and", {bits, pairs});
+  writeInstruction("add", {bits, temp});
+
+  writeInstruction("mov", {temp, bits});
+  writeInstruction("shr", {temp, "4"});
+  writeInstruction("add", {bits, temp});
+  writeInstruction("and", {bits, mask(0x0f0f0f0f0f0f0f0f)});
+
+  if (wideMask) {
+    writeInstruction("imul", {bits, mask(0x0101010101010101)});
+  } else {
+    writeInstruction("imul", {bits, bits, mask(0x01010101)});
+  }
+  writeInstruction("shr", {bits, std::to_string(size * 8 - 8)});
+  return value;
+}
+
+std::unique_ptr<Location> Generator::genRotate(
+    const Parser::Nodes::Intrinsic* intrinsic, Sema::ValueType type, Context& context) {
+  const std::string_view rotate = intrinsic->intrinsic() == IntrinsicType::RotateLeft ? "rol" : "ror";
+  const Parser::Nodes::Node* countNode = intrinsic->children()[1].get();
+  std::unique_ptr<Location> value = genRegisterOperand(intrinsic->children()[0].get(), type, context);
+
+  // Rotating by the width leaves the value as it was
+  if (const std::optional<int64_t> count = m_types.folded(countNode)) {
+    const uint64_t bits = static_cast<uint64_t>(*count) & (type.size * 8 - 1);
+    if (bits != 0) {
+      writeInstruction(rotate, {value->asAsm(type.size), std::to_string(bits)});
+    }
+    return value;
+  }
+
+  // A variable count has to be in cl, so it's swapped into rcx for the rotate and back out after, keeping whatever
+  // else rcx holds. If that's the value itself, it's rotated where the swap put it.
+  const std::unique_ptr<Location> count = genRegisterOperand(countNode, m_types.type(countNode), context);
+  const Register& countReg = dynamic_cast<const Context::RegisterHandle&>(*count).reg();
+  const Register& valueReg = dynamic_cast<const Context::RegisterHandle&>(*value).reg();
+  const Register rcx{Register::Kind::Original, "c"};
+  if (countReg == rcx) {
+    writeInstruction(rotate, {valueReg.asAsm(type.size), rcx.asAsm(1)});
+    return value;
+  }
+  writeInstruction("xchg", {rcx.asAsm(8), countReg.asAsm(8)});
+  writeInstruction(rotate, {(valueReg == rcx ? countReg : valueReg).asAsm(type.size), rcx.asAsm(1)});
+  writeInstruction("xchg", {rcx.asAsm(8), countReg.asAsm(8)});
+  return value;
+}
+
+std::unique_ptr<Location> Generator::genReadTimestamp(Context& context) {
+  std::unique_ptr<Location> resultLocation = nextRegister(context);
+  const Register& result = dynamic_cast<const Context::RegisterHandle&>(*resultLocation).reg();
+
+  // rdtsc writes the counter's halves to edx and eax, so anything else held in them is saved around it
+  const Register rax{Register::Kind::Original, "a"};
+  const Register rdx{Register::Kind::Original, "d"};
+  std::vector<Register> savedRegisters = context.liveCallerSavedRegisters();
+  std::erase_if(savedRegisters,
+                [&](const Register& reg) { return reg == result || (reg != rax && reg != rdx); });
+  std::vector<std::unique_ptr<Location>> saveSlots;
+  for (const Register& reg : savedRegisters) {
+    std::unique_ptr<Location>& slot = saveSlots.emplace_back(context.nextSpillSlot());
+    writeInstruction("mov", {slot->asAsm(8), reg.asAsm(8)});
+  }
+
+  writeInstruction("rdtsc", {});
+  writeInstruction("shl", {rdx.asAsm(8), "32"});
+  writeInstruction("or", {rax.asAsm(8), rdx.asAsm(8)});
+  if (result != rax) {
+    writeInstruction("mov", {result.asAsm(8), rax.asAsm(8)});
+  }
+
+  for (size_t i = 0; i < savedRegisters.size(); i++) {
+    writeInstruction("mov", {savedRegisters[i].asAsm(8), saveSlots[i]->asAsm(8)});
+  }
+  return resultLocation;
+}
+
+void Generator::writeArgumentMoves(std::vector<std::pair<Register, Register>> moves) {
+  std::erase_if(moves, [](const auto& move) { return move.first == move.second; });
+
+  while (!moves.empty()) {
+    // A move whose destination nothing else still reads can be made straight away
+    const auto ready = std::ranges::find_if(moves, [&moves](const auto& move) {
+      return std::ranges::none_of(moves, [&move](const auto& other) { return other.second == move.first; });
+    });
+    if (ready != moves.end()) {
+      writeInstruction("mov", {ready->first.asAsm(8), ready->second.asAsm(8)});
+      moves.erase(ready);
+      continue;
+    }
+
+    // Everything left is part of a cycle, so swap one pair and read the swapped out value from its new register
+    const auto [destination, source] = moves.back();
+    moves.pop_back();
+    writeInstruction("xchg", {destination.asAsm(8), source.asAsm(8)});
+    for (auto& move : moves) {
+      if (move.second == destination) {
+        move.second = source;
+      }
+    }
+    std::erase_if(moves, [](const auto& move) { return move.first == move.second; });
+  }
+}
+
+void Generator::numberSites(const Parser::Nodes::Node* node, const std::string& function) {
+  if (const auto* scope = dynamic_cast<const Parser::Nodes::Scope*>(node)) {
+    for (const auto& statement : scope->statements()) {
+      numberSites(statement.get(), function);
+    }
+  } else if (const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node)) {
+    m_sites.try_emplace(node, Profile::siteName(function, m_sites.size()));
+    numberSites(conditional->scope(), function);
+  } else if (const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node)) {
+    m_sites.try_emplace(node, Profile::siteName(function, m_sites.size()));
+    numberSites(loop->scope(), function);
+  } else if (const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node)) {
+    // Switches aren't counted themselves, only what's inside their cases
+    for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+      numberSites(switchCase.scope.get(), function);
+    }
+  }
+}
+
+void Generator::writeCounter(const std::string& site, std::string_view counter) {
+  if (!m_options.instrument) {
+    return;
+  }
+
+  std::string name = site + "." + std::string(counter);
+  const auto [index, inserted] = m_counterIndices.try_emplace(name, m_counters.size());
+  if (inserted) {
+    m_counters.push_back(std::move(name));
+  }
+  // inc clobbers the flags, so counters are only placed where none are live
+  writeInstruction("inc", {"QWORD [ cep_profile_counters + " + std::to_string(index->second * 8) + " ]"});
+}
+
+void Generator::writeProfileDump() {
+  // Writes "<name> <count>" for every counter with the C runtime, as a plain loop over the name and counter tables
+  m_program << R"(extern fopen
+extern fprintf
+extern fclose
+
+cep_profile_dump:
+  push rbp
+  mov rbp, rsp
+  push rbx
+  push rsi
+  sub rsp, 32
+  lea rcx, [ cep_profile_path ]
+  lea rdx, [ cep_profile_mode ]
+  call fopen
+  test rax, rax
+  jz .done
+  mov rbx, rax
+  xor esi, esi
+.next:
+  cmp rsi, cep_profile_count
+  jae .close
+  mov rcx, rbx
+  lea rdx, [ cep_profile_format ]
+  lea rax, [ cep_profile_names ]
+  mov r8, QWORD [ rax + rsi*8 ]
+  lea rax, [ cep_profile_counters ]
+  mov r9, QWORD [ rax + rsi*8 ]
+  call fprintf
+  inc rsi
+  jmp .next
+.close:
+  mov rcx, rbx
+  call fclose
+.done:
+  lea rsp, [ rbp - 16 ]
+  pop rsi
+  pop rbx
+  pop rbp
+  ret
+
+)";
+
+  m_program << "cep_profile_count equ " << m_counters.size() << "\n\n";
+  m_program << "segment .rdata\n";
+  m_program << "cep_profile_path: db \"" << Profile::defaultPath << "\", 0\n";
+  m_program << "cep_profile_mode: db \"w\", 0\n";
+  m_program << "cep_profile_format: db \"%s %llu\", 10, 0\n";
+  for (size_t i = 0; i < m_counters.size(); i++) {
+    m_program << "cep_profile_name" << i << ": db \"" << m_counters[i] << "\", 0\n";
+  }
+  m_program << "align 8\n";
+  m_program << "cep_profile_names:\n";
+  for (size_t i = 0; i < m_counters.size(); i++) {
+    m_program << "  dq cep_profile_name" << i << "\n";
+  }
+
+  m_program << "\nsegment .bss\n";
+  m_program << "align 8\n";
+  m_program << "cep_profile_counters: resq " << std::max<size_t>(m_counters.size(), 1) << "\n";
+}
+
+void Generator::flushProgram() {
+  m_sink->write(m_program.view());
+  m_program.str({});
+}
+
+void Generator::writeSourceLine(const Parser::Nodes::Node* node) {
+  if (!m_options.lines) {
+    return;
+  }
+  // With no increment, every line of assembly up to the next directive comes from the same source line
+  m_program << "%line " << m_options.lines->locate(node->offset()).line + 1 << "+0 " << m_options.sourceName << "\n";
+}
+
 void Generator::writeInstruction(std::string_view inst, const std::vector<std::string_view>& args) {
   m_program << "  " << inst;
   if (!args.empty()) {
@@ -345,24 +1850,167 @@ void Generator::writeLabel(std::string_view label) {
   m_program << label << ":\n";
 }
 
+void Generator::writeMove(const Location& destination, const Location& source, size_t size) {
+  if (const auto literal = dynamic_cast<const IntegerLiteral*>(&source)) {
+    const std::optional<int64_t> value = literal->value();
+    if (value == 0) {
+      // Shorter than a mov and breaks the dependency on the old value, but clobbers the flags
+      writeInstruction("xor", {destination.asAsm(4), destination.asAsm(4)});
+    } else if (size == 8 && value && *value > 0 && *value <= std::numeric_limits<uint32_t>::max()) {
+      // Writing the low half clears the upper half, without needing a 64 bit immediate
+      writeInstruction("mov", {destination.asAsm(4), literal->asAsm(4)});
+    } else {
+      writeInstruction("mov", {destination.asAsm(size), literal->asAsm(size)});
+    }
+    return;
+  }
+
+  if (destination.asAsm(size) != source.asAsm(size)) {
+    writeInstruction("mov", {destination.asAsm(size), source.asAsm(size)});
+  }
+}
+
+void Generator::writeImmediateOperation(
+    std::string_view inst, const Location& destination, int64_t value, Context& context) {
+  if (value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max()) {
+    writeInstruction(inst, {destination.asAsm(8), std::to_string(value)});
+    return;
+  }
+  const std::unique_ptr<Location> immediate = nextRegister(context);
+  writeInstruction("mov", {immediate->asAsm(8), std::to_string(value)});
+  writeInstruction(inst, {destination.asAsm(8), immediate->asAsm(8)});
+}
+
+void Generator::writeExtension(
+    const Location& destination, const Location& source, Sema::ValueType from, size_t size) {
+  if (from.size >= size) {
+    writeInstruction("mov", {destination.asAsm(size), source.asAsm(size)});
+  } else if (from.size == 4 && from.isSigned) {
+    writeInstruction("movsxd", {destination.asAsm(8), source.asAsm(4)});
+  } else if (from.size == 4) {
+    writeInstruction("mov", {destination.asAsm(4), source.asAsm(4)});
+  } else if (from.isSigned) {
+    writeInstruction("movsx", {destination.asAsm(size), source.asAsm(from.size)});
+  } else {
+    writeInstruction("movzx", {destination.asAsm(4), source.asAsm(from.size)});
+  }
+}
+
+std::unique_ptr<Location> Generator::convert(
+    std::unique_ptr<Location> loc, Sema::ValueType from, Sema::ValueType to, Context& context) {
+  if (const auto literal = dynamic_cast<IntegerLiteral*>(loc.get())) {
+    return std::make_unique<IntegerLiteral>(literal->truncate(to.size));
+  }
+
+  // A comparison is set as 0 or 1 zero extended to 64 bits, which is valid as any type
+  if (dynamic_cast<Comparison*>(loc.get())) {
+    return writeComparisonToReg(std::move(loc), context);
+  }
+
+  // A variable at least as wide as the operation can be read where it is, wider ones from their low bytes
+  const size_t size = Sema::operationSize(to);
+  if (dynamic_cast<MemoryLocation*>(loc.get())) {
+    if (from.size >= size) {
+      return loc;
+    }
+    std::unique_ptr<Location> resultLocation = nextRegister(context);
+    writeExtension(*resultLocation, *loc, from, size);
+    return resultLocation;
+  }
+
+  // Registers hold a value in their low bytes, so only need extending to a wider type
+  if (from.size < to.size) {
+    writeExtension(*loc, *loc, from, size);
+  }
+  return loc;
+}
+
+std::unique_ptr<Location> Generator::nextRegister(Context& context) {
+  // Values held for reuse give their registers back before we run out
+  while (context.freeRegisters() == 0 && m_values.evict()) {
+  }
+  return context.nextRegister();
+}
+
+std::unique_ptr<Location> Generator::reuseValue(
+    const Parser::Nodes::Node* node, const std::optional<ValueTable::Value>& value, Context& context) {
+  if (!value) {
+    return nullptr;
+  }
+  // The last use takes the register over, any other copies the value so it stays held
+  if (!m_values.isUsedAgain(node)) {
+    return m_values.take(value->number);
+  }
+  // The value is taken out of the table while a register is found for the copy, as that may evict held values. If
+  // nothing else can give one back, this use takes the register over after all.
+  std::unique_ptr<Location> heldLocation = m_values.take(value->number);
+  if (!heldLocation) {
+    return nullptr;
+  }
+  while (context.freeRegisters() == 0 && m_values.evict()) {
+  }
+  if (context.freeRegisters() == 0) {
+    return heldLocation;
+  }
+
+  std::unique_ptr<Location> resultLocation = context.nextRegister();
+  writeInstruction("mov", {resultLocation->asAsm(8), heldLocation->asAsm(8)});
+  m_values.insert(*value, std::move(heldLocation));
+  return resultLocation;
+}
+
+void Generator::rememberValue(const Parser::Nodes::Node* node,
+                              const std::optional<ValueTable::Value>& value,
+                              const Location& location,
+                              Context& context) {
+  // Leave enough registers free to evaluate the rest of the expression, and don't hold a value nothing uses again
+  if (!value || !m_values.isUsedAgain(node) || context.freeRegisters() <= reservedRegisters) {
+    return;
+  }
+
+  std::unique_ptr<Location> heldLocation = context.nextRegister();
+  writeInstruction("mov", {heldLocation->asAsm(8), location.asAsm(8)});
+  m_values.insert(*value, std::move(heldLocation));
+}
+
 std::unique_ptr<Location> Generator::writeComparisonToReg(std::unique_ptr<Location> loc, Context& context) {
   if (const auto comparison = dynamic_cast<Comparison*>(loc.get())) {
-    std::unique_ptr<Location> resultLocation = context.nextRegister();
+    std::unique_ptr<Location> resultLocation = nextRegister(context);
 
-    writeInstruction("mov", {resultLocation->asAsm(8), "0"});
+    // The flags are already set, so the register can't be cleared with an xor first. The set byte is zero extended
+    // instead, which leaves the full register free of whatever it held before.
     writeInstruction(comparison->setInstruction(), {resultLocation->asAsm(1)});
+    writeInstruction("movzx", {resultLocation->asAsm(4), resultLocation->asAsm(1)});
 
     return resultLocation;
   }
   return loc;
 }
 
-std::unique_ptr<Location> Generator::writeImmediateToReg(std::unique_ptr<Location> loc, Context& context) {
-  if (const auto literal = dynamic_cast<IntegerLiteral*>(loc.get())) {
-    std::unique_ptr<Location> resultLocation = context.nextRegister();
+std::unique_ptr<Location> Generator::writeImmediateToReg(
+    std::unique_ptr<Location> loc, size_t size, Context& context) {
+  if (dynamic_cast<IntegerLiteral*>(loc.get())) {
+    std::unique_ptr<Location> resultLocation = nextRegister(context);
+    writeMove(*resultLocation, *loc, size);
+    return resultLocation;
+  }
+  return loc;
+}
 
-    writeInstruction("mov", {resultLocation->asAsm(8), literal->asAsm(8)});
+std::unique_ptr<Location> Generator::writeWideImmediateToReg(
+    std::unique_ptr<Location> loc, size_t size, Context& context) {
+  if (const auto literal = dynamic_cast<IntegerLiteral*>(loc.get());
+      literal && size == 8 && !literal->fitsImmediate()) {
+    return writeImmediateToReg(std::move(loc), size, context);
+  }
+  return loc;
+}
 
+std::unique_ptr<Location> Generator::writeMemoryToReg(
+    std::unique_ptr<Location> loc, Sema::ValueType type, Context& context) {
+  if (const auto memory = dynamic_cast<MemoryLocation*>(loc.get())) {
+    std::unique_ptr<Location> resultLocation = nextRegister(context);
+    writeExtension(*resultLocation, *memory, type, Sema::operationSize(type));
     return resultLocation;
   }
   return loc;
@@ -1,51 +1,202 @@
 #pragma once
 
+#include <Generator/CodeStats.h>
+#include <Generator/InstructionSelection.h>
+#include <Generator/SwitchLowering.h>
+#include <Generator/Target.h>
+#include <Generator/ValueTable.h>
 #include <Parser/Node/ParseNode.h>
+#include <Semantic/TypeChecker.h>
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Cepheid::Parser::Nodes {
+class BinaryOperation;
+class Conditional;
+class Intrinsic;
+class Loop;
 class Scope;
 }
 
+namespace Cepheid::Tokens {
+class LineTable;
+}
+
 namespace Cepheid::Gen {
+class Comparison;
 class Context;
 class Location;
+class OutputSink;
+class Profile;
 class Register;
 
+struct GeneratorOptions {
+  /// Count how often each branch and loop runs, writing the counts to a profile when the program exits
+  bool instrument = false;
+  /// Counts from an instrumented run, used to lay out branches and to rotate and unroll hot loops
+  const Profile* profile = nullptr;
+  /// Measure each function's code, for functionStats
+  bool stats = false;
+  /// Lines of the source being compiled, to mark each statement's code with the line it came from so the assembler
+  /// can write line information for debuggers and profilers
+  const Tokens::LineTable* lines = nullptr;
+  /// Name of the source in the line information
+  std::string_view sourceName;
+  /// Most an if body's assigned value may cost, in InstructionSelection's units, to be computed whether or not the
+  /// condition holds and stored with a conditional move instead of branching around it. Zero always branches
+  size_t ifConversionCost = defaultIfConversionCost;
+  /// Instructions the intrinsics can be generated with
+  Target target;
+};
+
+/// Instructions in generated assembly, which are its indented lines apart from comments
+[[nodiscard]] size_t instructionCount(std::string_view assembly);
+
 class Generator {
  public:
-  explicit Generator(Parser::Nodes::NodePtr root);
+  Generator(Parser::Nodes::NodePtr root, Sema::ExpressionTypes types, GeneratorOptions options = {});
 
   [[nodiscard]] std::string generate();
 
+  /// Write the program to a sink as it goes, a function at a time, so it's never held in memory as a whole
+  void generate(OutputSink& sink);
+
+  /// Metrics of each function generated, in order, when asked for in the options
+  [[nodiscard]] const std::vector<FunctionStats>& functionStats() const;
+
  private:
   void genProgram(const Parser::Nodes::Node* node, Context& context);
   void genScope(const Parser::Nodes::Scope* scope, Context& context);
   void genStatement(const Parser::Nodes::Node* node, Context& context);
 
+  void genEntry();
+  /// Lay out the module variables, constants read only, others initialised or zeroed by the loader
+  void genModuleVariables(const Parser::Nodes::Node* node, Context& context);
   void genFunction(const Parser::Nodes::Node* node, Context& context);
   void genReturn(const Parser::Nodes::Node* node, Context& context);
   void genVariableDeclaration(const Parser::Nodes::Node* node, Context& context);
   void genConditional(const Parser::Nodes::Node* node, Context& context);
+  /// Whether a conditional's body is a single cheap assignment worth replacing with a conditional move
+  [[nodiscard]] bool isIfConvertible(const Parser::Nodes::Conditional* conditional);
+  /// Replace a conditional with a conditional move if it's worth it, returning false if it isn't
+  bool genIfConversion(const Parser::Nodes::Conditional* conditional, Context& context);
   void genLoop(const Parser::Nodes::Node* node, Context& context);
+  void genRotatedLoop(const Parser::Nodes::Loop* loop, const std::string& site, bool unroll, Context& context);
+  std::unique_ptr<Comparison> genCondition(const Parser::Nodes::Node* node, Context& context);
+  /// Jump to the label when the condition is `when` and fall through otherwise, as a chain of jumps through any !, &&
+  /// and || so no boolean is ever materialised
+  void genBranch(const Parser::Nodes::Node* node, bool when, const std::string& label, Context& context);
+  void genSwitch(const Parser::Nodes::Node* node, Context& context);
+  // Each jumps from the value, extended to 64 bits in a register of its own, to the label of the case it matches
+  void genJumpTable(std::unique_ptr<Location> value,
+                    std::span<const SwitchValue> values,
+                    const std::vector<std::string>& labels,
+                    const std::string& defaultLabel,
+                    Context& context);
+  void genBitTests(std::unique_ptr<Location> value,
+                   std::span<const SwitchValue> values,
+                   const std::vector<std::string>& labels,
+                   const std::string& defaultLabel,
+                   Context& context);
+  void genDecisionTree(const Location& value,
+                       std::span<const SwitchValue> values,
+                       const std::vector<std::string>& labels,
+                       const std::string& defaultLabel,
+                       bool isSigned,
+                       Context& context);
 
   std::unique_ptr<Location> genExpression(const Parser::Nodes::Node* node, Context& context);
   std::unique_ptr<Location> genBinaryOperation(const Parser::Nodes::Node* node, Context& context);
+  std::unique_ptr<Location> genOperand(
+      const Parser::Nodes::Node* node, const Parser::Nodes::Node* other, size_t otherNeed, Context& context);
+  size_t registerNeed(const Parser::Nodes::Node* node, bool isLeft);
+  std::unique_ptr<Location> genPattern(const Selection& selection, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genAddress(const PatternMatch& match, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genReadModifyWrite(const Selection& selection, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genRegisterOperand(const Parser::Nodes::Node* node, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genAssignment(const Parser::Nodes::BinaryOperation* node, Context& context);
   std::unique_ptr<Location> genUnaryOperation(
       const Parser::Nodes::Node* node,
       Context& context);
   std::unique_ptr<Location> genBaseOperation(
       const Parser::Nodes::Node* node,
       Context& context);
+  std::unique_ptr<Location> genCall(const Parser::Nodes::Node* node, Context& context);
+  /// Generate an intrinsic in place, returning nothing for those without a value
+  std::unique_ptr<Location> genIntrinsic(const Parser::Nodes::Node* node, Context& context);
+  /// Evaluate into a register of our own with the bits above a narrow type cleared, whatever its sign
+  std::unique_ptr<Location> genZeroExtended(const Parser::Nodes::Node* node, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genPopCount(std::unique_ptr<Location> value, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genRotate(
+      const Parser::Nodes::Intrinsic* intrinsic, Sema::ValueType type, Context& context);
+  std::unique_ptr<Location> genReadTimestamp(Context& context);
+  void writeArgumentMoves(std::vector<std::pair<Register, Register>> moves);
 
+  /// Convert a value to another type, leaving it anywhere an operation on that type can read it from
+  std::unique_ptr<Location> convert(
+      std::unique_ptr<Location> loc, Sema::ValueType from, Sema::ValueType to, Context& context);
+
+  std::unique_ptr<Location> nextRegister(Context& context);
+  std::unique_ptr<Location> reuseValue(
+      const Parser::Nodes::Node* node, const std::optional<ValueTable::Value>& value, Context& context);
+  void rememberValue(const Parser::Nodes::Node* node,
+                     const std::optional<ValueTable::Value>& value,
+                     const Location& location,
+                     Context& context);
+
+  void numberSites(const Parser::Nodes::Node* node, const std::string& function);
+  void writeCounter(const std::string& site, std::string_view counter);
+  void writeProfileDump();
+
+  /// Pass everything written since the last flush on to the sink
+  void flushProgram();
+  /// Mark the code that follows as coming from the line a node starts on, when writing line information
+  void writeSourceLine(const Parser::Nodes::Node* node);
   void writeInstruction(std::string_view inst, const std::vector<std::string_view>& args);
   void writeLabel(std::string_view label);
+  void writeMove(const Location& destination, const Location& source, size_t size);
+  void writeExtension(const Location& destination, const Location& source, Sema::ValueType from, size_t size);
+  /// An instruction on a 64 bit register and a constant, moved to a register first if it's too wide for an immediate
+  void writeImmediateOperation(std::string_view inst, const Location& destination, int64_t value, Context& context);
   std::unique_ptr<Location> writeComparisonToReg(std::unique_ptr<Location> loc, Context& context);
-  std::unique_ptr<Location> writeImmediateToReg(std::unique_ptr<Location> loc, Context& context);
+  std::unique_ptr<Location> writeImmediateToReg(std::unique_ptr<Location> loc, size_t size, Context& context);
+  std::unique_ptr<Location> writeWideImmediateToReg(std::unique_ptr<Location> loc, size_t size, Context& context);
+  std::unique_ptr<Location> writeMemoryToReg(std::unique_ptr<Location> loc, Sema::ValueType type, Context& context);
 
   Parser::Nodes::NodePtr m_root;
-  Parser::Nodes::Node* m_main = nullptr;
+  Sema::ExpressionTypes m_types;
+  GeneratorOptions m_options;
+  OutputSink* m_sink = nullptr;
+  // The part of the program not yet passed on to the sink
   std::stringstream m_program;
+  // Code moved out of line by profile feedback, written after the current function
+  std::stringstream m_coldBlocks;
+  // Jump tables of the current function's switches, written to read only data after it
+  std::stringstream m_jumpTables;
+  // How many of the current function's switches were lowered each way
+  std::array<size_t, 3> m_switchLowerings{};
+
+  // A return that ends the function falls through to the epilogue, any other jumps to it
+  const Parser::Nodes::Node* m_finalReturn = nullptr;
+
+  // Profile site of each conditional and loop in the current function
+  std::unordered_map<const Parser::Nodes::Node*, std::string> m_sites;
+  std::unordered_map<std::string, size_t> m_counterIndices;
+  std::vector<std::string> m_counters;
+
+  std::vector<FunctionStats> m_functionStats;
+
+  ValueTable m_values;
+  std::unordered_map<const Parser::Nodes::Node*, size_t> m_registerNeeds;
+  SelectionCache m_selections;
 };
 }  // namespace Cepheid::Gen
\ No newline at end of file
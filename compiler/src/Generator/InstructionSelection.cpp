@@ -0,0 +1,392 @@
+#include "InstructionSelection.h"
+
+#include <Optimiser/SideEffects.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Semantic/TypeChecker.h>
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <limits>
+
+using namespace Cepheid::Gen;
+
+using Cepheid::Parser::Nodes::BinaryOperation;
+using Cepheid::Parser::Nodes::BinaryOperationType;
+using Cepheid::Parser::Nodes::Node;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Sema::ExpressionTypes;
+
+namespace {
+// Costs are roughly cycles of latency: a load, add or lea is 1, an imul is 3
+constexpr int loadCost = 1;
+constexpr int addCost = 1;
+constexpr int multiplyCost = 3;
+constexpr int storeCost = 1;
+
+const Node* unwrap(const Node* node) {
+  while (node && node->type() == NodeType::Expression && !node->children().empty()) {
+    node = node->children().front().get();
+  }
+  return node;
+}
+
+bool isIdentifier(const Node* node) {
+  node = unwrap(node);
+  return node && node->type() == NodeType::Identifier;
+}
+
+bool sameVariable(const Node* lhs, const Node* rhs) {
+  return isIdentifier(lhs) && isIdentifier(rhs) &&
+         unwrap(lhs)->token()->value.value() == unwrap(rhs)->token()->value.value();
+}
+
+const BinaryOperation* asBinary(const Node* node, BinaryOperationType operation) {
+  const auto* binaryNode = dynamic_cast<const BinaryOperation*>(unwrap(node));
+  return binaryNode && binaryNode->operation() == operation ? binaryNode : nullptr;
+}
+
+/// An operation that can be folded into a pattern working at type, as it works at the same type
+const BinaryOperation* asBinary(
+    const Node* node, BinaryOperationType operation, const ExpressionTypes& types, Cepheid::Sema::ValueType type) {
+  const BinaryOperation* binaryNode = asBinary(node, operation);
+  return binaryNode && types.operandType(binaryNode) == type ? binaryNode : nullptr;
+}
+
+/// Split a multiply by a constant into its other operand and the constant
+std::optional<std::pair<const Node*, int64_t>> constantFactor(const BinaryOperation* node) {
+  if (const std::optional<int64_t> value = literalValue(node->rhs())) {
+    return std::make_pair(node->lhs(), *value);
+  }
+  if (const std::optional<int64_t> value = literalValue(node->lhs())) {
+    return std::make_pair(node->rhs(), *value);
+  }
+  return std::nullopt;
+}
+
+/// Cost of an operand that has to end up in a register
+int registerCost(const Node* node, SelectionCache& cache) {
+  return genericCost(node, true, cache);
+}
+
+/// Cost of an operand that can be a register, memory or immediate
+int sourceCost(const Node* node, SelectionCache& cache) {
+  if (const std::optional<int64_t> value = literalValue(node)) {
+    return fitsImmediate(*value) ? 0 : loadCost;
+  }
+  return genericCost(node, false, cache);
+}
+
+struct ScaledTerm {
+  const Node* multiply;
+  const Node* operand;
+  int64_t scale;
+};
+
+struct AddressTerms {
+  std::vector<const Node*> plain;
+  std::vector<ScaledTerm> scaled;
+  int64_t displacement = 0;
+};
+
+bool collectTerms(
+    const Node* node, bool negate, const ExpressionTypes& types, Cepheid::Sema::ValueType type, AddressTerms& terms) {
+  node = unwrap(node);
+  if (const std::optional<int64_t> value = literalValue(node)) {
+    terms.displacement += negate ? -*value : *value;
+    return true;
+  }
+  if (const BinaryOperation* add = asBinary(node, BinaryOperationType::Add, types, type)) {
+    return collectTerms(add->lhs(), negate, types, type, terms) && collectTerms(add->rhs(), negate, types, type, terms);
+  }
+  // Only a constant can be subtracted, an address has no negative terms
+  if (const BinaryOperation* subtract = asBinary(node, BinaryOperationType::Subtract, types, type);
+      subtract && literalValue(subtract->rhs())) {
+    return collectTerms(subtract->lhs(), negate, types, type, terms) &&
+           collectTerms(subtract->rhs(), !negate, types, type, terms);
+  }
+  if (negate) {
+    return false;
+  }
+  if (const BinaryOperation* multiply = asBinary(node, BinaryOperationType::Multiply, types, type)) {
+    if (const auto factor = constantFactor(multiply); factor && (factor->second == 1 || factor->second == 2 ||
+                                                                 factor->second == 4 || factor->second == 8)) {
+      terms.scaled.push_back({multiply, factor->first, factor->second});
+      return true;
+    }
+  }
+  terms.plain.push_back(node);
+  return true;
+}
+
+std::optional<PatternMatch> matchAddress(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& cache) {
+  if (node->operation() != BinaryOperationType::Add && node->operation() != BinaryOperationType::Subtract) {
+    return std::nullopt;
+  }
+
+  AddressTerms terms;
+  if (!collectTerms(node, false, types, types.operandType(node), terms) || !fitsImmediate(terms.displacement)) {
+    return std::nullopt;
+  }
+
+  PatternMatch match;
+  match.immediate = terms.displacement;
+  if (!terms.scaled.empty()) {
+    match.index = terms.scaled.front().operand;
+    match.scale = terms.scaled.front().scale;
+  }
+  // Only one term can be scaled, any others are added afterwards as they were written
+  for (auto term = std::next(terms.scaled.begin()); term < terms.scaled.end(); ++term) {
+    match.rest.push_back(term->multiply);
+  }
+
+  auto plain = terms.plain.begin();
+  if (plain != terms.plain.end()) {
+    match.base = *plain++;
+  }
+  if (!match.index && plain != terms.plain.end()) {
+    match.index = *plain++;
+  }
+  match.rest.insert(match.rest.end(), plain, terms.plain.end());
+
+  if (!match.base && !match.index) {
+    return std::nullopt;
+  }
+
+  match.operandCost = registerCost(match.base, cache) + registerCost(match.index, cache);
+  for (const Node* term : match.rest) {
+    match.operandCost += sourceCost(term, cache) + addCost;
+  }
+  // A three component lea is slower on most cores
+  if (match.base && match.index && match.immediate != 0) {
+    match.operandCost += 1;
+  }
+  return match;
+}
+
+std::optional<PatternMatch> matchMultiplyByShift(
+    const BinaryOperation* node, const ExpressionTypes& /*types*/, SelectionCache& cache) {
+  if (node->operation() != BinaryOperationType::Multiply) {
+    return std::nullopt;
+  }
+  const auto factor = constantFactor(node);
+  if (!factor || factor->second <= 1 || !std::has_single_bit(static_cast<uint64_t>(factor->second))) {
+    return std::nullopt;
+  }
+
+  PatternMatch match;
+  match.base = factor->first;
+  match.immediate = std::countr_zero(static_cast<uint64_t>(factor->second));
+  match.operandCost = registerCost(match.base, cache);
+  return match;
+}
+
+std::optional<PatternMatch> matchMultiplyByAddress(
+    const BinaryOperation* node, const ExpressionTypes& /*types*/, SelectionCache& cache) {
+  if (node->operation() != BinaryOperationType::Multiply) {
+    return std::nullopt;
+  }
+  const auto factor = constantFactor(node);
+  if (!factor || (factor->second != 3 && factor->second != 5 && factor->second != 9)) {
+    return std::nullopt;
+  }
+
+  PatternMatch match;
+  match.base = factor->first;
+  match.scale = factor->second - 1;
+  match.operandCost = registerCost(match.base, cache);
+  return match;
+}
+
+std::optional<PatternMatch> matchMultiplyByImmediate(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& cache) {
+  if (node->operation() != BinaryOperationType::Multiply) {
+    return std::nullopt;
+  }
+  const auto factor = constantFactor(node);
+  if (!factor || !fitsImmediate(factor->second)) {
+    return std::nullopt;
+  }
+
+  PatternMatch match;
+  match.base = factor->first;
+  match.immediate = factor->second;
+  // The three operand form takes its source from memory, so a variable as wide as the multiply doesn't need loading
+  const bool fromMemory = isIdentifier(match.base) &&
+                          types.type(match.base).size >= Cepheid::Sema::operationSize(types.operandType(node));
+  match.operandCost = fromMemory ? 0 : registerCost(match.base, cache);
+  return match;
+}
+
+/// Split x = x op e into e, only taking e + x when op commutes and is done at the type of x
+const Node* readModifyWriteOperand(
+    const BinaryOperation* node, BinaryOperationType operation, const ExpressionTypes& types) {
+  if (node->operation() != BinaryOperationType::Assign || !isIdentifier(node->lhs())) {
+    return nullptr;
+  }
+  const BinaryOperation* value = asBinary(node->rhs(), operation, types, types.type(node->lhs()));
+  if (!value) {
+    return nullptr;
+  }
+  if (sameVariable(node->lhs(), value->lhs())) {
+    return value->rhs();
+  }
+  if (operation != BinaryOperationType::Subtract && sameVariable(node->lhs(), value->rhs())) {
+    return value->lhs();
+  }
+  return nullptr;
+}
+
+std::optional<PatternMatch> matchIncrementMemory(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& /*cache*/) {
+  for (const BinaryOperationType operation : {BinaryOperationType::Add, BinaryOperationType::Subtract}) {
+    const Node* operand = readModifyWriteOperand(node, operation, types);
+    const std::optional<int64_t> value = literalValue(operand);
+    if (value && (*value == 1 || *value == -1)) {
+      PatternMatch match;
+      match.target = node->lhs();
+      match.operation = operation;
+      match.immediate = operation == BinaryOperationType::Add ? *value : -*value;
+      return match;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<PatternMatch> matchArithmeticToMemory(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& cache) {
+  for (const BinaryOperationType operation : {BinaryOperationType::Add, BinaryOperationType::Subtract}) {
+    if (const Node* operand = readModifyWriteOperand(node, operation, types)) {
+      PatternMatch match;
+      match.target = node->lhs();
+      match.base = operand;
+      match.operation = operation;
+      // Memory can't be both source and destination
+      match.operandCost = isIdentifier(operand) ? loadCost : sourceCost(operand, cache);
+      return match;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<PatternMatch> matchShiftMemory(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& /*cache*/) {
+  const Node* operand = readModifyWriteOperand(node, BinaryOperationType::Multiply, types);
+  const std::optional<int64_t> value = literalValue(operand);
+  if (!value || *value <= 1 || !std::has_single_bit(static_cast<uint64_t>(*value))) {
+    return std::nullopt;
+  }
+
+  PatternMatch match;
+  match.target = node->lhs();
+  match.immediate = std::countr_zero(static_cast<uint64_t>(*value));
+  return match;
+}
+
+// clang-format off
+constexpr std::array patternTable{
+    //      kind                             cost  match
+    Pattern{PatternKind::Address,             1,   matchAddress},
+    Pattern{PatternKind::MultiplyByShift,     1,   matchMultiplyByShift},
+    Pattern{PatternKind::MultiplyByAddress,   1,   matchMultiplyByAddress},
+    Pattern{PatternKind::MultiplyByImmediate, 3,   matchMultiplyByImmediate},
+    Pattern{PatternKind::IncrementMemory,     1,   matchIncrementMemory},
+    Pattern{PatternKind::ArithmeticToMemory,  2,   matchArithmeticToMemory},
+    Pattern{PatternKind::ShiftMemory,         2,   matchShiftMemory},
+};
+// clang-format on
+}  // namespace
+
+std::span<const Pattern> Cepheid::Gen::patterns() {
+  return patternTable;
+}
+
+std::optional<Selection> Cepheid::Gen::selectPattern(
+    const BinaryOperation* node, const ExpressionTypes& types, SelectionCache& cache) {
+  if (Opt::hasSideEffects(node->operation() == BinaryOperationType::Assign ? node->rhs() : node, cache.sideEffects)) {
+    return std::nullopt;
+  }
+
+  std::optional<Selection> best;
+  int bestCost = node->operation() == BinaryOperationType::Assign ? genericCost(node->rhs(), true, cache) + storeCost
+                                                                   : genericCost(node, true, cache);
+  for (const Pattern& pattern : patterns()) {
+    if (std::optional<PatternMatch> match = pattern.match(node, types, cache)) {
+      const int cost = pattern.cost + match->operandCost;
+      if (cost < bestCost) {
+        bestCost = cost;
+        best = Selection{&pattern, std::move(*match)};
+      }
+    }
+  }
+  return best;
+}
+
+int Cepheid::Gen::genericCost(const Node* node, bool isLeft, SelectionCache& cache) {
+  node = unwrap(node);
+  if (!node) {
+    return 0;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier:
+    case NodeType::IntegerLiteral:
+      // A right hand leaf is used directly as a memory or immediate operand
+      return isLeft ? loadCost : 0;
+    default:
+      break;
+  }
+
+  if (const auto it = cache.costs.find(node); it != cache.costs.end()) {
+    return it->second;
+  }
+
+  int cost = 0;
+  switch (node->type()) {
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const BinaryOperation*>(node);
+      if (binaryNode->operation() == BinaryOperationType::Assign) {
+        cost = genericCost(binaryNode->rhs(), true, cache) + storeCost;
+        break;
+      }
+      const int operation = binaryNode->operation() == BinaryOperationType::Multiply ? multiplyCost : addCost;
+      cost = genericCost(binaryNode->lhs(), true, cache) + genericCost(binaryNode->rhs(), false, cache) + operation;
+      break;
+    }
+    case NodeType::UnaryOperation:
+      cost = genericCost(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand(), true, cache) + addCost;
+      break;
+    case NodeType::Intrinsic:
+      // Mostly single instructions with a multiply's latency, though a sequence where the target lacks one
+      cost = multiplyCost;
+      for (const auto& argument : node->children()) {
+        cost += genericCost(argument.get(), true, cache);
+      }
+      break;
+    default:
+      break;
+  }
+
+  cache.costs.try_emplace(node, cost);
+  return cost;
+}
+
+std::optional<int64_t> Cepheid::Gen::literalValue(const Node* node) {
+  node = unwrap(node);
+  if (!node || node->type() != NodeType::IntegerLiteral) {
+    return std::nullopt;
+  }
+
+  const std::string& text = node->token()->value.value();
+  int64_t value = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool Cepheid::Gen::fitsImmediate(int64_t value) {
+  return value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Optimiser/SideEffects.h>
+#include <Parser/Node/BinaryOperation.h>
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Cepheid::Sema {
+class ExpressionTypes;
+}
+
+namespace Cepheid::Gen {
+
+enum class PatternKind {
+  /// lea r, [ base + index*scale + disp ], followed by an add for each remaining term
+  Address,
+  /// shl r, k for a multiply by 2^k
+  MultiplyByShift,
+  /// lea r, [ r + r*(c-1) ] for a multiply by 3, 5 or 9
+  MultiplyByAddress,
+  /// imul r, r/m, imm for a multiply by any other constant
+  MultiplyByImmediate,
+  /// inc/dec [ x ] for x = x + 1 and x = x - 1
+  IncrementMemory,
+  /// add/sub [ x ], r/imm for x = x + e and x = x - e
+  ArithmeticToMemory,
+  /// shl [ x ], k for x = x * 2^k
+  ShiftMemory,
+};
+
+/// The operands of a tree fragment covered by a pattern, left for the generator to evaluate
+struct PatternMatch {
+  /// Variable written by a read-modify-write pattern
+  const Parser::Nodes::Node* target = nullptr;
+  const Parser::Nodes::Node* base = nullptr;
+  const Parser::Nodes::Node* index = nullptr;
+  int64_t scale = 1;
+  /// Displacement of an address, or the constant operand of anything else
+  int64_t immediate = 0;
+  /// Terms of an address that didn't fit into the lea
+  std::vector<const Parser::Nodes::Node*> rest;
+  Parser::Nodes::BinaryOperationType operation = Parser::Nodes::BinaryOperationType::Add;
+  /// Cost of getting the operands where the pattern wants them
+  int operandCost = 0;
+};
+
+/**
+ * What the selector has worked out about whole trees, by node. Selection runs on every operation of a tree and looks
+ * at everything below it, so without this a tree would take time quadratic in its size.
+ */
+struct SelectionCache {
+  Opt::SideEffectCache sideEffects;
+  /// Generic costs of operations, which unlike those of leaves don't depend on the side they're on
+  std::unordered_map<const Parser::Nodes::Node*, int> costs;
+};
+
+struct Pattern {
+  PatternKind kind;
+  /// Cost of the instructions the pattern emits, in the same units as genericCost
+  int cost;
+  std::optional<PatternMatch> (*match)(
+      const Parser::Nodes::BinaryOperation* node, const Sema::ExpressionTypes& types, SelectionCache& cache);
+};
+
+struct Selection {
+  const Pattern* pattern;
+  PatternMatch match;
+};
+
+/// Every pattern the selector knows about
+[[nodiscard]] std::span<const Pattern> patterns();
+
+/**
+ * Cheapest pattern covering a tree rooted at node, if there is one cheaper than generating each operation on its own.
+ * Only pure trees are covered, as patterns are free to reorder their operands, and every operation a pattern covers
+ * works at the same type, so its operands only need converting once.
+ */
+[[nodiscard]] std::optional<Selection> selectPattern(
+    const Parser::Nodes::BinaryOperation* node, const Sema::ExpressionTypes& types, SelectionCache& cache);
+
+/// Cost of generating a tree one operation at a time, with the result in a register if isLeft
+[[nodiscard]] int genericCost(const Parser::Nodes::Node* node, bool isLeft, SelectionCache& cache);
+
+/// Most an if body's value may cost to be computed unconditionally, which is about a multiply
+constexpr size_t defaultIfConversionCost = 4;
+
+/// Value of an integer literal, looking through any expression wrappers
+[[nodiscard]] std::optional<int64_t> literalValue(const Parser::Nodes::Node* node);
+
+/// Whether a value can be encoded as a sign extended 32 bit immediate
+[[nodiscard]] bool fitsImmediate(int64_t value);
+
+}  // namespace Cepheid::Gen
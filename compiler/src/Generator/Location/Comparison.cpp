@@ -2,7 +2,7 @@
 
 #include <Generator/GenerationException.h>
 
-Cepheid::Gen::Comparison::Comparison(Type type) : m_type(type) {
+Cepheid::Gen::Comparison::Comparison(Type type, bool isSigned) : m_type(type), m_isSigned(isSigned) {
 }
 
 std::string Cepheid::Gen::Comparison::asAsm(size_t size) const {
@@ -12,17 +12,17 @@ std::string Cepheid::Gen::Comparison::asAsm(size_t size) const {
 std::string Cepheid::Gen::Comparison::setInstruction() const {
   switch (m_type) {
     case Type::Less:
-      return "setl";
+      return m_isSigned ? "setl" : "setb";
     case Type::LessEqual:
-      return "setle";
+      return m_isSigned ? "setle" : "setbe";
     case Type::Equal:
       return "sete";
     case Type::NotEqual:
       return "setne";
     case Type::Greater:
-      return "setg";
+      return m_isSigned ? "setg" : "seta";
     case Type::GreaterEqual:
-      return "setge";
+      return m_isSigned ? "setge" : "setae";
   }
   throw GenerationException("Unhandled comparison type in set");
 }
@@ -30,17 +30,52 @@ std::string Cepheid::Gen::Comparison::setInstruction() const {
 std::string Cepheid::Gen::Comparison::jmpInstruction(bool inverse) const {
   switch (m_type) {
     case Type::Less:
+      if (!m_isSigned) {
+        return inverse ? "jnb" : "jb";
+      }
       return inverse ? "jnl" : "jl";
     case Type::LessEqual:
+      if (!m_isSigned) {
+        return inverse ? "jnbe" : "jbe";
+      }
       return inverse ? "jnle" : "jle";
     case Type::Equal:
       return inverse ? "jne" : "je";
     case Type::NotEqual:
       return inverse ? "je" : "jne";
     case Type::Greater:
+      if (!m_isSigned) {
+        return inverse ? "jna" : "ja";
+      }
       return inverse ? "jng" : "jg";
     case Type::GreaterEqual:
+      if (!m_isSigned) {
+        return inverse ? "jnae" : "jae";
+      }
       return inverse ? "jnge" : "jge";
   }
   throw GenerationException("Unhandled comparison type in jump");
 }
+
+std::string Cepheid::Gen::Comparison::cmovInstruction(bool inverse) const {
+  // Conditional moves take the same condition codes as jumps
+  return "cmov" + jmpInstruction(inverse).substr(1);
+}
+
+Cepheid::Gen::Comparison Cepheid::Gen::Comparison::inverse() const {
+  switch (m_type) {
+    case Type::Less:
+      return Comparison(Type::GreaterEqual, m_isSigned);
+    case Type::LessEqual:
+      return Comparison(Type::Greater, m_isSigned);
+    case Type::Equal:
+      return Comparison(Type::NotEqual, m_isSigned);
+    case Type::NotEqual:
+      return Comparison(Type::Equal, m_isSigned);
+    case Type::Greater:
+      return Comparison(Type::LessEqual, m_isSigned);
+    case Type::GreaterEqual:
+      return Comparison(Type::Less, m_isSigned);
+  }
+  throw GenerationException("Unhandled comparison type in inverse");
+}
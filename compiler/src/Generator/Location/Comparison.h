@@ -14,14 +14,20 @@ public:
     GreaterEqual
   };
 
-  explicit Comparison(Type type);
+  /// Unsigned comparisons test the carry flag rather than the sign and overflow flags
+  explicit Comparison(Type type, bool isSigned = true);
 
   [[nodiscard]] std::string asAsm(size_t size) const override;
   [[nodiscard]] std::string setInstruction() const;
   [[nodiscard]] std::string jmpInstruction(bool inverse) const;
+  [[nodiscard]] std::string cmovInstruction(bool inverse) const;
+
+  /// The comparison that holds whenever this one doesn't, read from the same flags
+  [[nodiscard]] Comparison inverse() const;
 
 private:
   Type m_type;
+  bool m_isSigned;
 };
 
 }
@@ -1,8 +1,42 @@
 #include "IntegerLiteral.h"
 
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+
 Cepheid::Gen::IntegerLiteral::IntegerLiteral(std::string_view value) : m_value(value){
 }
 
 std::string Cepheid::Gen::IntegerLiteral::asAsm(size_t size) const {
   return m_value;
 }
+
+bool Cepheid::Gen::IntegerLiteral::fitsImmediate() const {
+  const std::optional<int64_t> literal = value();
+  return literal && *literal >= std::numeric_limits<int32_t>::min() && *literal <= std::numeric_limits<int32_t>::max();
+}
+
+std::optional<int64_t> Cepheid::Gen::IntegerLiteral::value() const {
+  int64_t value = 0;
+  const auto [end, error] = std::from_chars(m_value.data(), m_value.data() + m_value.size(), value);
+  if (error != std::errc{} || end != m_value.data() + m_value.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+Cepheid::Gen::IntegerLiteral Cepheid::Gen::IntegerLiteral::truncate(size_t size) const {
+  const std::optional<int64_t> literal = value();
+  if (!literal || size >= 8) {
+    return *this;
+  }
+
+  const size_t bits = size * 8;
+  const uint64_t mask = (uint64_t{1} << bits) - 1;
+  uint64_t truncated = static_cast<uint64_t>(*literal) & mask;
+  if (truncated >> (bits - 1)) {
+    truncated |= ~mask;
+  }
+  return IntegerLiteral(std::to_string(static_cast<int64_t>(truncated)));
+}
@@ -2,6 +2,9 @@
 
 #include <Generator/Location/Location.h>
 
+#include <cstdint>
+#include <optional>
+
 namespace Cepheid::Gen {
 
 class IntegerLiteral : public Location {
@@ -10,6 +13,14 @@ class IntegerLiteral : public Location {
 
   [[nodiscard]] std::string asAsm(size_t size) const override;
 
+  /// Whether the value can be encoded as a sign extended 32 bit immediate operand
+  [[nodiscard]] bool fitsImmediate() const;
+
+  [[nodiscard]] std::optional<int64_t> value() const;
+
+  /// The same bits as a value of the given size, as a signed immediate
+  [[nodiscard]] IntegerLiteral truncate(size_t size) const;
+
  private:
   std::string m_value;
 };
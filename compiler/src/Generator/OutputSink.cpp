@@ -0,0 +1,50 @@
+#include "OutputSink.h"
+
+#include <Generator/GenerationException.h>
+
+#include <cstring>
+#include <utility>
+
+using namespace Cepheid::Gen;
+
+void StringSink::write(std::string_view text) {
+  m_text += text;
+}
+
+std::string StringSink::take() {
+  return std::move(m_text);
+}
+
+FileSink::FileSink(const std::filesystem::path& path, size_t bufferSize)
+    : m_path(path), m_file(path, std::ios::binary), m_buffer(bufferSize) {
+  if (!m_file) {
+    throw GenerationException(("Unable to open " + path.string()).c_str());
+  }
+}
+
+FileSink::~FileSink() {
+  // Errors can't be thrown from here, callers that need to know flush first
+  m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_used));
+}
+
+void FileSink::write(std::string_view text) {
+  if (m_used + text.size() > m_buffer.size()) {
+    flush();
+    if (text.size() > m_buffer.size()) {
+      // Too big to be worth copying into the buffer first
+      m_file.write(text.data(), static_cast<std::streamsize>(text.size()));
+      return;
+    }
+  }
+  std::memcpy(m_buffer.data() + m_used, text.data(), text.size());
+  m_used += text.size();
+}
+
+void FileSink::flush() {
+  m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_used));
+  m_used = 0;
+  m_file.flush();
+  if (!m_file) {
+    throw GenerationException(("Unable to write " + m_path.string()).c_str());
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Cepheid::Gen {
+/// Where generated assembly goes, written a function at a time as each one is finished
+class OutputSink {
+ public:
+  OutputSink() = default;
+  OutputSink(const OutputSink& other) = delete;
+  OutputSink& operator=(const OutputSink& other) = delete;
+  virtual ~OutputSink() = default;
+
+  virtual void write(std::string_view text) = 0;
+
+  /// Push out anything buffered, throwing a GenerationException if it can't be written
+  virtual void flush() {}
+};
+
+/// Keeps the whole program in memory
+class StringSink : public OutputSink {
+ public:
+  void write(std::string_view text) override;
+
+  [[nodiscard]] std::string take();
+
+ private:
+  std::string m_text;
+};
+
+/// Writes to a file through a large buffer, so the file sees a few big writes
+class FileSink : public OutputSink {
+ public:
+  explicit FileSink(const std::filesystem::path& path, size_t bufferSize = 1 << 20);
+  ~FileSink() override;
+
+  void write(std::string_view text) override;
+  void flush() override;
+
+ private:
+  std::filesystem::path m_path;
+  std::ofstream m_file;
+  std::vector<char> m_buffer;
+  size_t m_used = 0;
+};
+}  // namespace Cepheid::Gen
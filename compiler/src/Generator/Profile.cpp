@@ -0,0 +1,59 @@
+#include "Profile.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using namespace Cepheid::Gen;
+
+Profile Profile::read(std::istream& input) {
+  Profile profile;
+  std::string line;
+  while (std::getline(input, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    uint64_t count = 0;
+    if (fields >> name >> count) {
+      profile.m_counters.insert_or_assign(std::move(name), count);
+    }
+  }
+  return profile;
+}
+
+void Profile::write(std::ostream& output) const {
+  std::vector<std::pair<std::string_view, uint64_t>> counters(m_counters.begin(), m_counters.end());
+  std::ranges::sort(counters);
+  for (const auto& [name, count] : counters) {
+    output << name << " " << count << "\n";
+  }
+}
+
+std::string Profile::siteName(std::string_view function, size_t site) {
+  return std::string(function) + "." + std::to_string(site);
+}
+
+std::optional<uint64_t> Profile::counter(std::string_view site, std::string_view counter) const {
+  const std::string name = std::string(site) + "." + std::string(counter);
+  if (const auto it = m_counters.find(name); it != m_counters.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+std::optional<double> Profile::takenRatio(std::string_view site) const {
+  const std::optional<uint64_t> reached = counter(site, "count");
+  const std::optional<uint64_t> taken = counter(site, "taken");
+  if (!reached || !taken || *reached == 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(*taken) / static_cast<double>(*reached);
+}
+
+std::optional<double> Profile::averageTrips(std::string_view site) const {
+  const std::optional<uint64_t> entries = counter(site, "entries");
+  const std::optional<uint64_t> trips = counter(site, "trips");
+  if (!entries || !trips || *entries == 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(*trips) / static_cast<double>(*entries);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Cepheid::Gen {
+
+/**
+ * Execution counts gathered by an instrumented build.
+ *
+ * Every conditional and loop in a function is a site, numbered in source order. A conditional counts how often it was
+ * reached and how often its body was entered, a loop counts how often it was entered and how many times its body ran.
+ * The instrumented program writes one "<site>.<counter> <count>" line per counter when it exits.
+ */
+class Profile {
+ public:
+  /// File the instrumented program writes its counts to, relative to its working directory
+  static constexpr std::string_view defaultPath = "cepheid.profile";
+
+  /// Parse a profile written by an instrumented program, lines that can't be parsed are skipped
+  [[nodiscard]] static Profile read(std::istream& input);
+
+  /// Write the counters in the format read parses, sorted by name so equal profiles are written identically
+  void write(std::ostream& output) const;
+
+  [[nodiscard]] static std::string siteName(std::string_view function, size_t site);
+
+  [[nodiscard]] std::optional<uint64_t> counter(std::string_view site, std::string_view counter) const;
+
+  /// Fraction of the times a conditional was reached that its body was entered, if it was ever reached
+  [[nodiscard]] std::optional<double> takenRatio(std::string_view site) const;
+
+  /// Average number of times a loop's body ran each time the loop was entered, if it was ever entered
+  [[nodiscard]] std::optional<double> averageTrips(std::string_view site) const;
+
+ private:
+  std::unordered_map<std::string, uint64_t> m_counters;
+};
+
+}  // namespace Cepheid::Gen
@@ -0,0 +1,38 @@
+#include "SwitchLowering.h"
+
+#include <array>
+
+using namespace Cepheid::Gen;
+
+namespace {
+/// Fewer values are found at least as quickly by comparing against each
+constexpr size_t minJumpTableValues = 4;
+/// Tables that would be mostly the default case cost more memory than the comparisons they save
+constexpr size_t minJumpTableDensityPercent = 40;
+constexpr uint64_t maxJumpTableEntries = 4096;
+
+/// Values needed for testing masks to beat comparing against each value, by how many cases there are to test for
+constexpr std::array<size_t, 4> minBitTestValues = {0, 3, 5, 6};
+/// Bits in the register holding a mask
+constexpr uint64_t bitTestWidth = 64;
+}  // namespace
+
+SwitchLowering Cepheid::Gen::chooseSwitchLowering(std::span<const SwitchValue> values, size_t targets) {
+  const uint64_t span = switchSpan(values);
+  if (span < bitTestWidth && targets > 0 && targets < minBitTestValues.size() &&
+      values.size() >= minBitTestValues[targets]) {
+    return SwitchLowering::BitTest;
+  }
+  if (values.size() >= minJumpTableValues && span < maxJumpTableEntries &&
+      values.size() * 100 >= (span + 1) * minJumpTableDensityPercent) {
+    return SwitchLowering::JumpTable;
+  }
+  return SwitchLowering::DecisionTree;
+}
+
+uint64_t Cepheid::Gen::switchSpan(std::span<const SwitchValue> values) {
+  if (values.empty()) {
+    return 0;
+  }
+  return static_cast<uint64_t>(values.back().value) - static_cast<uint64_t>(values.front().value);
+}
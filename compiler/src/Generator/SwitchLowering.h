@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Cepheid::Gen {
+
+enum class SwitchLowering {
+  /// jmp [ table + (v - min)*8 ], for values covering most of the range between the smallest and largest
+  JumpTable,
+  /// bt mask, v - min for each case, for a few cases between them matching many values in a range of 64 or less
+  BitTest,
+  /// A binary search comparing against the middle value, for anything sparse
+  DecisionTree,
+};
+
+/// A value a switch matches, with the index of the case it runs
+struct SwitchValue {
+  int64_t value;
+  size_t target;
+};
+
+/// How to find the case for a switch's values, sorted in order, which go to the given number of cases
+[[nodiscard]] SwitchLowering chooseSwitchLowering(std::span<const SwitchValue> values, size_t targets);
+
+/// Largest value less the smallest, as a switch over a whole 64 bit type can span more than int64_t can hold
+[[nodiscard]] uint64_t switchSpan(std::span<const SwitchValue> values);
+
+}  // namespace Cepheid::Gen
@@ -0,0 +1,27 @@
+#include "SymbolTable.h"
+
+using namespace Cepheid::Gen;
+
+size_t NameTable::NameHash::operator()(std::string_view name) const {
+  return std::hash<std::string_view>{}(name);
+}
+
+NameTable::Id NameTable::intern(std::string_view name) {
+  if (const auto it = m_ids.find(name); it != m_ids.end()) {
+    return it->second;
+  }
+  const auto id = static_cast<Id>(m_ids.size());
+  m_ids.emplace(name, id);
+  return id;
+}
+
+std::optional<NameTable::Id> NameTable::find(std::string_view name) const {
+  if (const auto it = m_ids.find(name); it != m_ids.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+size_t NameTable::size() const {
+  return m_ids.size();
+}
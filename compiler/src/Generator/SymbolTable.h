@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Cepheid::Gen {
+
+/// Maps names to small dense ids, so symbols can be found without comparing strings
+class NameTable {
+ public:
+  using Id = uint32_t;
+
+  Id intern(std::string_view name);
+  [[nodiscard]] std::optional<Id> find(std::string_view name) const;
+
+  [[nodiscard]] size_t size() const;
+
+ private:
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const;
+  };
+
+  std::unordered_map<std::string, Id, NameHash, std::equal_to<>> m_ids;
+};
+
+/**
+ * Scoped symbols in a single flat table.
+ *
+ * Every binding goes onto one stack. Each name id indexes the innermost binding for that name, and each binding
+ * remembers the one it shadows, so a lookup is a single index. Popping a scope unwinds just the bindings made since
+ * it was pushed.
+ */
+template <typename ValueT>
+class SymbolTable {
+ public:
+  void pushScope() {
+    m_scopeMarks.push_back(m_bindings.size());
+  }
+
+  void popScope() {
+    const size_t mark = m_scopeMarks.back();
+    m_scopeMarks.pop_back();
+    while (m_bindings.size() > mark) {
+      const Binding& binding = m_bindings.back();
+      m_innermost[binding.name] = binding.shadowed;
+      m_bindings.pop_back();
+    }
+  }
+
+  void insert(NameTable::Id name, ValueT value) {
+    if (name >= m_innermost.size()) {
+      m_innermost.resize(name + 1, none);
+    }
+    m_bindings.push_back(Binding{name, m_innermost[name], std::move(value)});
+    m_innermost[name] = static_cast<uint32_t>(m_bindings.size() - 1);
+  }
+
+  [[nodiscard]] const ValueT* find(NameTable::Id name) const {
+    if (name >= m_innermost.size() || m_innermost[name] == none) {
+      return nullptr;
+    }
+    return &m_bindings[m_innermost[name]].value;
+  }
+
+  [[nodiscard]] size_t depth() const {
+    return m_scopeMarks.size();
+  }
+
+ private:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  struct Binding {
+    NameTable::Id name;
+    uint32_t shadowed;
+    ValueT value;
+  };
+
+  std::vector<Binding> m_bindings;
+  std::vector<uint32_t> m_innermost;
+  std::vector<size_t> m_scopeMarks;
+};
+
+}  // namespace Cepheid::Gen
@@ -0,0 +1,16 @@
+#include "Target.h"
+
+using namespace Cepheid::Gen;
+
+std::optional<Target> Target::level(std::string_view name) {
+  if (name == "x86-64") {
+    return Target{.popcnt = false, .bitCounts = false};
+  }
+  if (name == "x86-64-v2") {
+    return Target{.popcnt = true, .bitCounts = false};
+  }
+  if (name == "x86-64-v3" || name == "x86-64-v4") {
+    return Target{.popcnt = true, .bitCounts = true};
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace Cepheid::Gen {
+
+/**
+ * Instructions the generated code may use beyond those every x86-64 processor has, picked by the microarchitecture
+ * levels other compilers name: x86-64 for the original instruction set, x86-64-v2 adding popcnt and x86-64-v3 adding
+ * lzcnt and tzcnt. Intrinsics whose instruction the target lacks are generated as sequences every processor can run.
+ *
+ * The defaults are x86-64-v2, which every processor able to run a current Windows reaches.
+ */
+struct Target {
+  bool popcnt = true;
+  /// lzcnt and tzcnt, which older processors run as bsr and bsf without a fault, giving the wrong answer
+  bool bitCounts = false;
+
+  /// The target for a level's name, or nothing if it isn't a level
+  [[nodiscard]] static std::optional<Target> level(std::string_view name);
+};
+
+}  // namespace Cepheid::Gen
@@ -0,0 +1,471 @@
+#include "ValueTable.h"
+
+#include <Generator/Context.h>
+#include <Generator/Location/Location.h>
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/TypeChecker.h>
+
+#include <algorithm>
+
+using namespace Cepheid::Gen;
+
+using Cepheid::Parser::Nodes::BinaryOperationType;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Parser::Nodes::UnaryOperationType;
+
+namespace {
+enum class KeyKind { Binary, Unary };
+
+size_t combineHash(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+bool isNumberedBinary(BinaryOperationType operation) {
+  return operation == BinaryOperationType::Add || operation == BinaryOperationType::Subtract ||
+         operation == BinaryOperationType::Multiply;
+}
+
+bool isCommutative(BinaryOperationType operation) {
+  return operation == BinaryOperationType::Add || operation == BinaryOperationType::Multiply;
+}
+
+/// Not leaves its result in the flags, which can't be held on to
+bool isNumberedUnary(UnaryOperationType operation) {
+  return operation == UnaryOperationType::Negate;
+}
+
+const Cepheid::Parser::Nodes::Node* unwrap(const Cepheid::Parser::Nodes::Node* node) {
+  while (node && node->type() == NodeType::Expression && !node->children().empty()) {
+    node = node->children().front().get();
+  }
+  return node;
+}
+
+bool isOperation(const Cepheid::Parser::Nodes::Node* node) {
+  return node->type() == NodeType::BinaryOperation || node->type() == NodeType::UnaryOperation;
+}
+
+}  // namespace
+
+size_t ValueTable::KeyHash::operator()(const Key& key) const {
+  size_t hash = std::hash<int>{}(key.kind);
+  hash = combineHash(hash, std::hash<int>{}(key.operation));
+  hash = combineHash(hash, std::hash<ValueNumber>{}(key.lhs));
+  hash = combineHash(hash, std::hash<ValueNumber>{}(key.rhs));
+  return combineHash(hash, key.width * 2 + (key.isSigned ? 1 : 0));
+}
+
+void ValueTable::reset(
+    const Parser::Nodes::Node* function, const Sema::ExpressionTypes* types, const IfConversion& isIfConverted) {
+  clear();
+  m_types = types;
+
+  Available available;
+  findRepeats(function, available, isIfConverted);
+  m_signatures.clear();
+  m_reads.clear();
+}
+
+void ValueTable::clear() {
+  m_values.clear();
+  m_literals.clear();
+  m_slotValues.clear();
+  m_numbered.clear();
+  m_entries.clear();
+  m_signatures.clear();
+  m_reads.clear();
+  m_repeated.clear();
+  m_usedAgain.clear();
+  m_sameOperands.clear();
+}
+
+bool ValueTable::isRepeated(const Parser::Nodes::Node* node) const {
+  return m_repeated.contains(node) || m_usedAgain.contains(node);
+}
+
+bool ValueTable::isUsedAgain(const Parser::Nodes::Node* node) const {
+  return m_usedAgain.contains(node);
+}
+
+bool ValueTable::hasSameOperands(const Parser::Nodes::Node* node) const {
+  return m_sameOperands.contains(node);
+}
+
+std::optional<ValueTable::Value> ValueTable::number(const Parser::Nodes::Node* node, const Context& context) {
+  if (!node) {
+    return std::nullopt;
+  }
+  if (const auto it = m_numbered.find(node); it != m_numbered.end()) {
+    return it->second;
+  }
+
+  std::optional<Value> value;
+  switch (node->type()) {
+    case NodeType::Expression:
+      if (!node->children().empty()) {
+        value = number(node->children().front().get(), context);
+      }
+      break;
+    case NodeType::IntegerLiteral: {
+      auto [literal, inserted] = m_literals.try_emplace(node->token()->value.value(), m_nextValue);
+      if (inserted) {
+        m_nextValue++;
+      }
+      value = Value{literal->second, {}};
+      break;
+    }
+    case NodeType::Identifier: {
+      if (const auto variable = context.variable(node->token()->value.value())) {
+        value = Value{slotValue(variable->offset), {variable->offset}};
+      }
+      break;
+    }
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      if (!isNumberedBinary(binaryNode->operation())) {
+        break;
+      }
+      const std::optional<Value> lhs = number(binaryNode->lhs(), context);
+      const std::optional<Value> rhs = number(binaryNode->rhs(), context);
+      if (!lhs || !rhs) {
+        break;
+      }
+
+      const Sema::ValueType type = m_types->operandType(node);
+      Key key{static_cast<int>(KeyKind::Binary),
+              static_cast<int>(binaryNode->operation()),
+              lhs->number,
+              rhs->number,
+              type.size,
+              type.isSigned};
+      if (isCommutative(binaryNode->operation()) && key.rhs < key.lhs) {
+        std::swap(key.lhs, key.rhs);
+      }
+
+      value = Value{valueFor(key), lhs->slots};
+      value->slots.insert(value->slots.end(), rhs->slots.begin(), rhs->slots.end());
+      break;
+    }
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      if (!isNumberedUnary(unaryNode->operation())) {
+        break;
+      }
+      if (const std::optional<Value> operand = number(unaryNode->operand(), context)) {
+        const Sema::ValueType type = m_types->operandType(node);
+        const Key key{static_cast<int>(KeyKind::Unary),
+                      static_cast<int>(unaryNode->operation()),
+                      operand->number,
+                      0,
+                      type.size,
+                      type.isSigned};
+        value = Value{valueFor(key), operand->slots};
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (value) {
+    m_numbered.try_emplace(node, *value);
+  }
+  return value;
+}
+
+std::unique_ptr<Location> ValueTable::take(ValueNumber number) {
+  const auto it = m_entries.find(number);
+  if (it == m_entries.end()) {
+    return nullptr;
+  }
+  m_reuseCount++;
+  std::unique_ptr<Location> location = std::move(it->second.location);
+  m_entries.erase(it);
+  return location;
+}
+
+void ValueTable::insert(const Value& value, std::unique_ptr<Location> location) {
+  m_entries.insert_or_assign(value.number, Entry{m_nextAge++, value.slots, std::move(location)});
+}
+
+void ValueTable::store(size_t slot) {
+  m_slotValues.insert_or_assign(slot, m_nextValue++);
+  std::erase_if(m_entries, [slot](const auto& entry) {
+    return std::ranges::find(entry.second.slots, slot) != entry.second.slots.end();
+  });
+  m_numbered.clear();
+}
+
+void ValueTable::storeAll() {
+  m_slotValues.clear();
+  m_numbered.clear();
+  m_entries.clear();
+}
+
+bool ValueTable::evict() {
+  const auto oldest = std::ranges::min_element(
+      m_entries, [](const auto& lhs, const auto& rhs) { return lhs.second.age < rhs.second.age; });
+  if (oldest == m_entries.end()) {
+    return false;
+  }
+  m_entries.erase(oldest);
+  return true;
+}
+
+size_t ValueTable::enterBlock() const {
+  return m_nextAge;
+}
+
+void ValueTable::leaveBlock(size_t mark) {
+  std::erase_if(m_entries, [mark](const auto& entry) { return entry.second.age >= mark; });
+}
+
+size_t ValueTable::heldCount() const {
+  return m_entries.size();
+}
+
+size_t ValueTable::reuseCount() const {
+  return m_reuseCount;
+}
+
+ValueTable::ValueNumber ValueTable::valueFor(const Key& key) {
+  auto [value, inserted] = m_values.try_emplace(key, m_nextValue);
+  if (inserted) {
+    m_nextValue++;
+  }
+  return value->second;
+}
+
+ValueTable::ValueNumber ValueTable::slotValue(size_t slot) {
+  auto [value, inserted] = m_slotValues.try_emplace(slot, m_nextValue);
+  if (inserted) {
+    m_nextValue++;
+  }
+  return value->second;
+}
+
+size_t ValueTable::signature(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return 0;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier:
+      return combineHash(1, std::hash<std::string>{}(node->token()->value.value()));
+    case NodeType::IntegerLiteral:
+      return combineHash(2, std::hash<std::string>{}(node->token()->value.value()));
+    case NodeType::Expression:
+      return node->children().empty() ? 0 : signature(node->children().front().get());
+    case NodeType::BinaryOperation:
+    case NodeType::UnaryOperation:
+      break;
+    default:
+      return 0;
+  }
+  if (const auto it = m_signatures.find(node); it != m_signatures.end()) {
+    return it->second;
+  }
+
+  size_t hash = 0;
+  if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node)) {
+    size_t lhs = signature(binaryNode->lhs());
+    size_t rhs = signature(binaryNode->rhs());
+    if (isNumberedBinary(binaryNode->operation()) && lhs != 0 && rhs != 0) {
+      if (isCommutative(binaryNode->operation()) && rhs < lhs) {
+        std::swap(lhs, rhs);
+      }
+      hash = combineHash(combineHash(static_cast<size_t>(binaryNode->operation()) + 3, lhs), rhs);
+    }
+  } else {
+    const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+    const size_t operand = signature(unaryNode->operand());
+    if (isNumberedUnary(unaryNode->operation()) && operand != 0) {
+      hash = combineHash(combineHash(static_cast<size_t>(unaryNode->operation()) + 64, operand), 0);
+    }
+  }
+  m_signatures.try_emplace(node, hash);
+  return hash;
+}
+
+void ValueTable::findRepeats(
+    const Parser::Nodes::Node* node, Available& available, const IfConversion& isIfConverted) {
+  if (!node) {
+    return;
+  }
+
+  // Writing a variable makes everything computed from it stale
+  const auto write = [&available](const std::string& name) {
+    std::erase_if(available, [&name](const auto& entry) {
+      return std::ranges::find(entry.second.variables, name) != entry.second.variables.end();
+    });
+  };
+  const auto writeVariable = [&write](const Parser::Nodes::Node* variable) {
+    variable = unwrap(variable);
+    if (variable->type() == NodeType::Identifier) {
+      write(variable->token()->value.value());
+    }
+  };
+
+  // A computation done already is reused whole, so nothing inside it is computed again
+  if (isOperation(node) && available.contains(signature(node))) {
+    occur(node, available);
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier:
+    case NodeType::IntegerLiteral:
+      return;
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      const BinaryOperationType operation = binaryNode->operation();
+      if (operation == BinaryOperationType::Assign) {
+        findRepeats(binaryNode->rhs(), available, isIfConverted);
+        writeVariable(binaryNode->lhs());
+        return;
+      }
+      findRepeats(binaryNode->lhs(), available, isIfConverted);
+      if (operation == BinaryOperationType::LogicalAnd || operation == BinaryOperationType::LogicalOr) {
+        // The right side isn't always evaluated
+        findRepeatsInBlock(binaryNode->rhs(), available, isIfConverted);
+        return;
+      }
+      const Parser::Nodes::Node* lhs = unwrap(binaryNode->lhs());
+      if (isOperation(lhs) && signature(lhs) != 0 && signature(lhs) == signature(binaryNode->rhs())) {
+        m_sameOperands.insert(node);
+      } else {
+        findRepeats(binaryNode->rhs(), available, isIfConverted);
+      }
+      occur(node, available);
+      return;
+    }
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      findRepeats(unaryNode->operand(), available, isIfConverted);
+      if (unaryNode->operation() == UnaryOperationType::Increment ||
+          unaryNode->operation() == UnaryOperationType::Decrement) {
+        writeVariable(unaryNode->operand());
+      } else {
+        occur(node, available);
+      }
+      return;
+    }
+    case NodeType::Call:
+      // Held values are dropped before a call's arguments, and the call may write module variables
+      available.clear();
+      for (const auto& child : node->children()) {
+        findRepeats(child.get(), available, isIfConverted);
+      }
+      available.clear();
+      return;
+    case NodeType::Function:
+      findRepeats(dynamic_cast<const Parser::Nodes::Function*>(node)->scope(), available, isIfConverted);
+      return;
+    case NodeType::Scope:
+      for (const auto& statement : dynamic_cast<const Parser::Nodes::Scope*>(node)->statements()) {
+        findRepeats(statement.get(), available, isIfConverted);
+      }
+      return;
+    case NodeType::VariableDeclaration: {
+      const auto* declaration = dynamic_cast<const Parser::Nodes::VariableDeclaration*>(node);
+      findRepeats(declaration->expression(), available, isIfConverted);
+      write(declaration->name());
+      return;
+    }
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      if (isIfConverted(conditional)) {
+        // The assigned value is always computed, before the condition, and only the store depends on it
+        const auto* assignment = dynamic_cast<const Parser::Nodes::BinaryOperation*>(
+            unwrap(conditional->scope()->statements().front().get()));
+        findRepeats(assignment->rhs(), available, isIfConverted);
+        findRepeats(conditional->expression(), available, isIfConverted);
+        writeVariable(assignment->lhs());
+        return;
+      }
+      findRepeats(conditional->expression(), available, isIfConverted);
+      findRepeatsInBlock(conditional->scope(), available, isIfConverted);
+      return;
+    }
+    case NodeType::Loop: {
+      // Nothing is held on entering a loop, and whatever it computes is dropped on leaving it
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      findRepeats(loop->initExpression(), available, isIfConverted);
+      available.clear();
+      findRepeats(loop->conditionExpression(), available, isIfConverted);
+      findRepeats(loop->scope(), available, isIfConverted);
+      findRepeats(loop->updateExpression(), available, isIfConverted);
+      available.clear();
+      return;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      findRepeats(switchNode->expression(), available, isIfConverted);
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        findRepeatsInBlock(switchCase.scope.get(), available, isIfConverted);
+      }
+      return;
+    }
+    default:
+      for (const auto& child : node->children()) {
+        findRepeats(child.get(), available, isIfConverted);
+      }
+      return;
+  }
+}
+
+void ValueTable::findRepeatsInBlock(
+    const Parser::Nodes::Node* node, Available& available, const IfConversion& isIfConverted) {
+  Available inside = available;
+  findRepeats(node, inside, isIfConverted);
+  // A value from before the block that it used may have been handed over to that use
+  std::erase_if(available, [&inside](const auto& entry) {
+    const auto it = inside.find(entry.first);
+    return it == inside.end() || it->second.node != entry.second.node;
+  });
+}
+
+void ValueTable::occur(const Parser::Nodes::Node* node, Available& available) {
+  const size_t hash = signature(node);
+  if (hash == 0) {
+    return;
+  }
+  if (const auto it = available.find(hash); it != available.end()) {
+    m_usedAgain.insert(it->second.node);
+    m_repeated.insert(node);
+  }
+  available.insert_or_assign(hash, Occurrence{node, readVariables(node)});
+}
+
+const std::vector<std::string>& ValueTable::readVariables(const Parser::Nodes::Node* node) {
+  node = unwrap(node);
+  if (const auto it = m_reads.find(node); it != m_reads.end()) {
+    return it->second;
+  }
+
+  // Built from the operands' own lists, which every enclosing expression asks for again
+  std::vector<std::string> variables;
+  const auto addOperand = [this, &variables](const Parser::Nodes::Node* operand) {
+    for (const std::string& name : readVariables(operand)) {
+      if (std::ranges::find(variables, name) == variables.end()) {
+        variables.push_back(name);
+      }
+    }
+  };
+  if (node->type() == NodeType::Identifier) {
+    variables.push_back(node->token()->value.value());
+  } else if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node)) {
+    addOperand(binaryNode->lhs());
+    addOperand(binaryNode->rhs());
+  } else if (const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)) {
+    addOperand(unaryNode->operand());
+  }
+  return m_reads.try_emplace(node, std::move(variables)).first->second;
+}
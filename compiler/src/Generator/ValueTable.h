@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Generator/Location/Location.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Conditional;
+class Node;
+}
+
+namespace Cepheid::Sema {
+class ExpressionTypes;
+}
+
+namespace Cepheid::Gen {
+class Context;
+
+/**
+ * Hash based value numbering for the generator.
+ *
+ * Pure expressions are given a value number built from their operation and the value numbers of their operands. A
+ * variable's value number changes every time it's stored to, so two expressions with the same value number compute
+ * the same value. Results that are used again before one of the variables they read is stored to are held in a
+ * register until then, or until control flow leaves the block that computed them. The last use takes the register over
+ * rather than copying it.
+ */
+class ValueTable {
+ public:
+  using ValueNumber = size_t;
+
+  struct Value {
+    ValueNumber number;
+    /// Stack offsets of every variable the value was computed from
+    std::vector<size_t> slots;
+  };
+
+  /// Whether a conditional is generated as a conditional move, computing its value before testing the condition
+  using IfConversion = std::function<bool(const Parser::Nodes::Conditional*)>;
+
+  /// Forget everything and prepare for a new function, whose expressions have the given types
+  void reset(
+      const Parser::Nodes::Node* function, const Sema::ExpressionTypes* types, const IfConversion& isIfConverted);
+
+  /// Forget everything, releasing any held registers
+  void clear();
+
+  /// Whether the computation is done more than once with none of the variables it reads written in between
+  [[nodiscard]] bool isRepeated(const Parser::Nodes::Node* node) const;
+  /// Whether the value computed here is used again later, so is worth holding on to
+  [[nodiscard]] bool isUsedAgain(const Parser::Nodes::Node* node) const;
+  /// Whether a binary operation's two sides are the same computation, so only one needs doing
+  [[nodiscard]] bool hasSameOperands(const Parser::Nodes::Node* node) const;
+
+  /// Value number for a pure expression, or nothing if it has side effects or can't be numbered
+  [[nodiscard]] std::optional<Value> number(const Parser::Nodes::Node* node, const Context& context);
+
+  /// Hand over the register holding a value, which is no longer held
+  [[nodiscard]] std::unique_ptr<Location> take(ValueNumber number);
+  void insert(const Value& value, std::unique_ptr<Location> location);
+
+  /// A variable has been written, so everything computed from it is stale
+  void store(size_t slot);
+  /// Any variable may have been written, as on a loop's back edge, so nothing computed so far is current and no value
+  /// is held
+  void storeAll();
+
+  /// Release the oldest held value, returns false if nothing was held
+  bool evict();
+
+  /// Values computed after entering a block are dropped when leaving it, as they don't dominate what follows
+  [[nodiscard]] size_t enterBlock() const;
+  void leaveBlock(size_t mark);
+
+  /// Number of values currently held in registers
+  [[nodiscard]] size_t heldCount() const;
+
+  [[nodiscard]] size_t reuseCount() const;
+
+ private:
+  struct Key {
+    int kind;
+    int operation;
+    ValueNumber lhs;
+    ValueNumber rhs;
+    /// The same operation at a different width is a different value
+    size_t width;
+    bool isSigned;
+    auto operator<=>(const Key&) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    size_t age;
+    std::vector<size_t> slots;
+    std::unique_ptr<Location> location;
+  };
+
+  struct Occurrence {
+    const Parser::Nodes::Node* node;
+    /// Names of the variables the computation reads
+    std::vector<std::string> variables;
+  };
+  /// The latest occurrence of each computation whose variables haven't been written since, by signature
+  using Available = std::unordered_map<size_t, Occurrence>;
+
+  [[nodiscard]] ValueNumber valueFor(const Key& key);
+  [[nodiscard]] ValueNumber slotValue(size_t slot);
+
+  /// Structural hash of a pure expression by variable name, or 0 if it isn't one worth numbering
+  size_t signature(const Parser::Nodes::Node* node);
+  /// Walk statements and expressions in the order they're generated, noting which computations are done again
+  void findRepeats(const Parser::Nodes::Node* node, Available& available, const IfConversion& isIfConverted);
+  /// Walk a block, after which only the computations it didn't touch are still available
+  void findRepeatsInBlock(const Parser::Nodes::Node* node, Available& available, const IfConversion& isIfConverted);
+  void occur(const Parser::Nodes::Node* node, Available& available);
+  /// Names of the variables a pure expression reads, each once
+  const std::vector<std::string>& readVariables(const Parser::Nodes::Node* node);
+
+  const Sema::ExpressionTypes* m_types = nullptr;
+
+  ValueNumber m_nextValue = 0;
+  std::unordered_map<Key, ValueNumber, KeyHash> m_values;
+  std::unordered_map<std::string, ValueNumber> m_literals;
+  std::unordered_map<size_t, ValueNumber> m_slotValues;
+  std::unordered_map<const Parser::Nodes::Node*, Value> m_numbered;
+
+  size_t m_nextAge = 0;
+  std::map<ValueNumber, Entry> m_entries;
+
+  std::unordered_map<const Parser::Nodes::Node*, size_t> m_signatures;
+  std::unordered_map<const Parser::Nodes::Node*, std::vector<std::string>> m_reads;
+  std::unordered_set<const Parser::Nodes::Node*> m_repeated;
+  std::unordered_set<const Parser::Nodes::Node*> m_usedAgain;
+  std::unordered_set<const Parser::Nodes::Node*> m_sameOperands;
+
+  size_t m_reuseCount = 0;
+};
+
+}  // namespace Cepheid::Gen
@@ -0,0 +1,369 @@
+#include "DeadCodeElimination.h"
+
+#include <Optimiser/SideEffects.h>
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+
+#include <algorithm>
+#include <ranges>
+
+using namespace Cepheid::Opt;
+
+using Cepheid::Parser::Nodes::Node;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Parser::Nodes::VariableDeclaration;
+
+DeadCodeElimination::Report DeadCodeElimination::run(Parser::Nodes::Node* root) {
+  m_report = {};
+  for (const auto& child : root->children()) {
+    if (auto* function = dynamic_cast<Parser::Nodes::Function*>(child.get())) {
+      optimiseFunction(function);
+    }
+  }
+  return m_report;
+}
+
+void DeadCodeElimination::optimiseFunction(Parser::Nodes::Function* function) {
+  Parser::Nodes::Scope* scope = function->scope();
+  if (!scope) {
+    return;
+  }
+
+  removeUnreachable(scope);
+
+  m_bindings.clear();
+  resolveScope(scope);
+
+  m_deadStores.clear();
+  m_loopHeaders.clear();
+  liveScope(scope, {}, true);
+  removeDeadStores(scope);
+
+  // Dropping stores can leave locals with no references at all
+  m_bindings.clear();
+  resolveScope(scope);
+  m_referenced.clear();
+  for (const VariableDeclaration* variable : m_bindings | std::views::values) {
+    m_referenced.insert(variable);
+  }
+  removeUnusedVariables(scope);
+}
+
+void DeadCodeElimination::resolveScope(const Parser::Nodes::Scope* scope) {
+  m_scopes.emplace_back();
+  for (const auto& statement : scope->statements()) {
+    resolveStatement(statement.get());
+  }
+  m_scopes.pop_back();
+}
+
+void DeadCodeElimination::resolveStatement(const Parser::Nodes::Node* node) {
+  switch (node->type()) {
+    case NodeType::VariableDeclaration: {
+      const auto* variable = dynamic_cast<const VariableDeclaration*>(node);
+      resolveExpression(variable->expression());
+      m_scopes.back().insert_or_assign(variable->name(), variable);
+      break;
+    }
+    case NodeType::ReturnStatement:
+    case NodeType::Expression:
+      resolveExpression(node);
+      break;
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      resolveExpression(conditional->expression());
+      resolveScope(conditional->scope());
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      resolveExpression(loop->initExpression());
+      resolveExpression(loop->conditionExpression());
+      resolveScope(loop->scope());
+      resolveExpression(loop->updateExpression());
+      break;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      resolveExpression(switchNode->expression());
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        resolveScope(switchCase.scope.get());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void DeadCodeElimination::resolveExpression(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier: {
+      const std::string& name = node->token()->value.value();
+      for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope) {
+        if (const auto it = scope->find(name); it != scope->end()) {
+          m_bindings.insert_or_assign(node, it->second);
+          break;
+        }
+      }
+      break;
+    }
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      resolveExpression(binaryNode->lhs());
+      resolveExpression(binaryNode->rhs());
+      break;
+    }
+    case NodeType::UnaryOperation:
+      resolveExpression(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand());
+      break;
+    default:
+      for (const auto& child : node->children()) {
+        resolveExpression(child.get());
+      }
+      break;
+  }
+}
+
+void DeadCodeElimination::removeUnreachable(Parser::Nodes::Scope* scope) {
+  bool returned = false;
+  m_report.unreachableStatements += scope->removeStatements([&returned](const Node* statement) {
+    const bool unreachable = returned;
+    returned = returned || statement->type() == NodeType::ReturnStatement;
+    return unreachable;
+  });
+
+  m_report.pureExpressions += scope->removeStatements(
+      [](const Node* statement) { return statement->type() == NodeType::Expression && !hasSideEffects(statement); });
+
+  for (const auto& statement : scope->statements()) {
+    if (auto* conditional = dynamic_cast<Parser::Nodes::Conditional*>(statement.get())) {
+      removeUnreachable(conditional->scope());
+    } else if (auto* loop = dynamic_cast<Parser::Nodes::Loop*>(statement.get())) {
+      removeUnreachable(loop->scope());
+    } else if (auto* switchNode = dynamic_cast<Parser::Nodes::Switch*>(statement.get())) {
+      for (Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        removeUnreachable(switchCase.scope.get());
+      }
+    }
+  }
+}
+
+void DeadCodeElimination::removeDeadStores(Parser::Nodes::Scope* scope) {
+  m_report.deadStores += scope->removeStatements([this](const Node* statement) {
+    return statement->type() == NodeType::Expression && m_deadStores.contains(statement);
+  });
+
+  for (const auto& statement : scope->statements()) {
+    if (auto* variable = dynamic_cast<VariableDeclaration*>(statement.get())) {
+      if (m_deadStores.contains(variable)) {
+        variable->setExpression(nullptr);
+        m_report.deadStores++;
+      }
+    } else if (auto* conditional = dynamic_cast<Parser::Nodes::Conditional*>(statement.get())) {
+      removeDeadStores(conditional->scope());
+    } else if (auto* loop = dynamic_cast<Parser::Nodes::Loop*>(statement.get())) {
+      removeDeadStores(loop->scope());
+    } else if (auto* switchNode = dynamic_cast<Parser::Nodes::Switch*>(statement.get())) {
+      for (Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        removeDeadStores(switchCase.scope.get());
+      }
+    }
+  }
+}
+
+void DeadCodeElimination::removeUnusedVariables(Parser::Nodes::Scope* scope) {
+  m_report.unusedVariables += scope->removeStatements([this](const Node* statement) {
+    const auto* variable = dynamic_cast<const VariableDeclaration*>(statement);
+    if (!variable || variable->expression()) {
+      return false;
+    }
+    return !m_referenced.contains(variable);
+  });
+
+  for (const auto& statement : scope->statements()) {
+    if (auto* conditional = dynamic_cast<Parser::Nodes::Conditional*>(statement.get())) {
+      removeUnusedVariables(conditional->scope());
+    } else if (auto* loop = dynamic_cast<Parser::Nodes::Loop*>(statement.get())) {
+      removeUnusedVariables(loop->scope());
+    } else if (auto* switchNode = dynamic_cast<Parser::Nodes::Switch*>(statement.get())) {
+      for (Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        removeUnusedVariables(switchCase.scope.get());
+      }
+    }
+  }
+}
+
+DeadCodeElimination::LiveSet DeadCodeElimination::liveScope(
+    const Parser::Nodes::Scope* scope, LiveSet live, bool mark) {
+  const auto& statements = scope->statements();
+  for (auto statement = statements.rbegin(); statement != statements.rend(); ++statement) {
+    live = liveStatement(statement->get(), std::move(live), mark);
+  }
+  return live;
+}
+
+DeadCodeElimination::LiveSet DeadCodeElimination::liveStatement(
+    const Parser::Nodes::Node* node, LiveSet live, bool mark) {
+  switch (node->type()) {
+    case NodeType::ReturnStatement: {
+      // Nothing after a return is ever read
+      LiveSet returnLive;
+      addUses(node, returnLive);
+      return returnLive;
+    }
+    case NodeType::Expression: {
+      const Node* expression = node->children().empty() ? nullptr : node->children().front().get();
+      if (const VariableDeclaration* target = storeTarget(expression); target && !live.contains(target)) {
+        if (mark) {
+          m_deadStores.insert(node);
+        }
+        return live;
+      }
+      return liveExpression(expression, std::move(live));
+    }
+    case NodeType::VariableDeclaration: {
+      const auto* variable = dynamic_cast<const VariableDeclaration*>(node);
+      const bool read = live.erase(variable) != 0;
+      if (!read && variable->expression() && !hasSideEffects(variable->expression())) {
+        if (mark) {
+          m_deadStores.insert(node);
+        }
+        return live;
+      }
+      addUses(variable->expression(), live);
+      return live;
+    }
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      // The body may or may not run, so anything live after it stays live
+      live.merge(liveScope(conditional->scope(), live, mark));
+      addUses(conditional->expression(), live);
+      return live;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+
+      // Iterate to a fixed point over the back edge before committing to any removals. A loop's live set only grows
+      // over the analysis of a function, so starting from the last fixed point found for it gives the same answer
+      // without iterating every nested loop from scratch on each pass over the loops around it.
+      LiveSet header = std::move(live);
+      addUses(loop->conditionExpression(), header);
+      LiveSet& previous = m_loopHeaders[loop];
+      header.insert(previous.begin(), previous.end());
+      for (;;) {
+        LiveSet next = liveScope(loop->scope(), liveExpression(loop->updateExpression(), header), false);
+        const size_t before = header.size();
+        header.merge(next);
+        if (header.size() == before) {
+          break;
+        }
+      }
+      previous = header;
+      if (mark) {
+        liveScope(loop->scope(), liveExpression(loop->updateExpression(), header), true);
+      }
+      return liveExpression(loop->initExpression(), std::move(header));
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      // Without a default no case may run, so anything live after it stays live
+      const bool hasDefault = std::ranges::any_of(switchNode->cases(), &Parser::Nodes::SwitchCase::isDefault);
+      LiveSet caseLive = hasDefault ? LiveSet{} : live;
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        caseLive.merge(liveScope(switchCase.scope.get(), live, mark));
+      }
+      addUses(switchNode->expression(), caseLive);
+      return caseLive;
+    }
+    default:
+      return live;
+  }
+}
+
+DeadCodeElimination::LiveSet DeadCodeElimination::liveExpression(const Parser::Nodes::Node* node, LiveSet live) const {
+  if (!node) {
+    return live;
+  }
+  if (node->type() == NodeType::Expression && !node->children().empty()) {
+    return liveExpression(node->children().front().get(), std::move(live));
+  }
+
+  if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node)) {
+    if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign) {
+      // A plain store kills the variable, anything read on the right keeps its own variables alive
+      if (const VariableDeclaration* target = binding(binaryNode->lhs())) {
+        live.erase(target);
+      }
+      addUses(binaryNode->rhs(), live);
+      return live;
+    }
+  }
+
+  addUses(node, live);
+  return live;
+}
+
+void DeadCodeElimination::addUses(const Parser::Nodes::Node* node, LiveSet& live) const {
+  if (!node) {
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier:
+      if (const VariableDeclaration* variable = binding(node)) {
+        live.insert(variable);
+      }
+      break;
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      // The target of an assignment is written, not read
+      if (binaryNode->operation() != Parser::Nodes::BinaryOperationType::Assign ||
+          binaryNode->lhs()->type() != NodeType::Identifier) {
+        addUses(binaryNode->lhs(), live);
+      }
+      addUses(binaryNode->rhs(), live);
+      break;
+    }
+    case NodeType::UnaryOperation:
+      addUses(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand(), live);
+      break;
+    default:
+      for (const auto& child : node->children()) {
+        addUses(child.get(), live);
+      }
+      break;
+  }
+}
+
+const VariableDeclaration* DeadCodeElimination::binding(const Parser::Nodes::Node* identifier) const {
+  if (const auto it = m_bindings.find(identifier); it != m_bindings.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
+const VariableDeclaration* DeadCodeElimination::storeTarget(const Parser::Nodes::Node* expression) const {
+  if (const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(expression)) {
+    if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign && !hasSideEffects(binaryNode->rhs())) {
+      return binding(binaryNode->lhs());
+    }
+  }
+  if (const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(expression)) {
+    if (unaryNode->operation() == Parser::Nodes::UnaryOperationType::Increment ||
+        unaryNode->operation() == Parser::Nodes::UnaryOperationType::Decrement) {
+      return binding(unaryNode->operand());
+    }
+  }
+  return nullptr;
+}
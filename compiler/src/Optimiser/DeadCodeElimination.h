@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+class Function;
+class Scope;
+class VariableDeclaration;
+}  // namespace Cepheid::Parser::Nodes
+
+namespace Cepheid::Opt {
+
+/**
+ * Removes code that can't affect the result of a program:
+ *  - statements following a return in the same scope
+ *  - expression statements without side effects
+ *  - stores to locals that are overwritten or go out of scope before being read
+ *  - locals that are never referenced once the above are gone
+ */
+class DeadCodeElimination {
+ public:
+  struct Report {
+    size_t unreachableStatements = 0;
+    size_t pureExpressions = 0;
+    size_t deadStores = 0;
+    size_t unusedVariables = 0;
+  };
+
+  /// Run over a whole module, rewriting it in place
+  Report run(Parser::Nodes::Node* root);
+
+ private:
+  using LiveSet = std::unordered_set<const Parser::Nodes::VariableDeclaration*>;
+
+  void optimiseFunction(Parser::Nodes::Function* function);
+
+  void resolveScope(const Parser::Nodes::Scope* scope);
+  void resolveStatement(const Parser::Nodes::Node* node);
+  void resolveExpression(const Parser::Nodes::Node* node);
+
+  void removeUnreachable(Parser::Nodes::Scope* scope);
+  void removeDeadStores(Parser::Nodes::Scope* scope);
+  void removeUnusedVariables(Parser::Nodes::Scope* scope);
+
+  LiveSet liveScope(const Parser::Nodes::Scope* scope, LiveSet live, bool mark);
+  LiveSet liveStatement(const Parser::Nodes::Node* node, LiveSet live, bool mark);
+  LiveSet liveExpression(const Parser::Nodes::Node* node, LiveSet live) const;
+  void addUses(const Parser::Nodes::Node* node, LiveSet& live) const;
+
+  [[nodiscard]] const Parser::Nodes::VariableDeclaration* binding(const Parser::Nodes::Node* identifier) const;
+  [[nodiscard]] const Parser::Nodes::VariableDeclaration* storeTarget(const Parser::Nodes::Node* expression) const;
+
+  std::unordered_map<const Parser::Nodes::Node*, const Parser::Nodes::VariableDeclaration*> m_bindings;
+  std::vector<std::map<std::string, const Parser::Nodes::VariableDeclaration*, std::less<>>> m_scopes;
+  std::unordered_set<const Parser::Nodes::Node*> m_deadStores;
+  std::unordered_map<const Parser::Nodes::Node*, LiveSet> m_loopHeaders;
+  LiveSet m_referenced;
+
+  Report m_report;
+};
+
+}  // namespace Cepheid::Opt
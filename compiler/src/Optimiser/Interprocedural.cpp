@@ -0,0 +1,374 @@
+#include "Interprocedural.h"
+
+#include <Optimiser/SideEffects.h>
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/TypeChecker.h>
+
+#include <algorithm>
+#include <charconv>
+#include <ranges>
+
+using namespace Cepheid::Opt;
+
+using Cepheid::Parser::Nodes::Node;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Parser::Nodes::VariableDeclaration;
+
+namespace {
+/// Value of a literal, looking through the expressions wrapping it
+std::optional<int64_t> literalValue(const Node* node) {
+  while (node && node->type() == NodeType::Expression && !node->children().empty()) {
+    node = node->children().front().get();
+  }
+  if (!node || node->type() != NodeType::IntegerLiteral) {
+    return std::nullopt;
+  }
+  const std::string& text = node->token()->value.value();
+  int64_t value = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+/// Whether a literal keeps its value when converted to a type, so can stand in for a variable of that type
+bool fits(int64_t value, Cepheid::Sema::ValueType type) {
+  if (type.size >= sizeof(int64_t)) {
+    return true;
+  }
+  const size_t bits = type.size * 8 - (type.isSigned ? 1 : 0);
+  return value >= 0 && static_cast<uint64_t>(value) < (uint64_t{1} << bits);
+}
+}  // namespace
+
+Interprocedural::Report Interprocedural::run(Parser::Nodes::Node* root, Sema::ExpressionTypes& types) {
+  m_report = {};
+  m_types = &types;
+  m_functions.clear();
+
+  for (const auto& child : root->children()) {
+    if (const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get())) {
+      FunctionInfo& info = m_functions[function->name()];
+      info.function = function;
+      collectScope(function->scope(), info);
+    }
+  }
+  for (FunctionInfo& info : m_functions | std::views::values) {
+    findResult(info);
+  }
+
+  // Anything outside the module can only call in through main or an exported function
+  for (FunctionInfo& info : m_functions | std::views::values) {
+    if (info.function->name() == "main" || info.function->isExported()) {
+      markReachable(info);
+    }
+  }
+  m_report.unreachableFunctions = root->removeChildren([this](const Node* child) {
+    const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child);
+    return function && !m_functions.at(function->name()).reachable;
+  });
+
+  // Functions that were removed keep their entries, as folded calls still need their result
+  for (const FunctionInfo& info : m_functions | std::views::values) {
+    if (!info.reachable) {
+      continue;
+    }
+    propagateParameters(info);
+
+    for (const Node* call : info.calls) {
+      const FunctionInfo* target = callee(call);
+      if (target && target->result) {
+        m_types->setConstant(call, {*target->result, !isFolded(call)});
+        m_report.constantCalls++;
+      }
+    }
+  }
+  return m_report;
+}
+
+void Interprocedural::collectScope(const Parser::Nodes::Scope* scope, FunctionInfo& info) {
+  for (const auto& statement : scope->statements()) {
+    collectStatement(statement.get(), info);
+  }
+}
+
+void Interprocedural::collectStatement(const Parser::Nodes::Node* node, FunctionInfo& info) {
+  switch (node->type()) {
+    case NodeType::VariableDeclaration:
+      collectExpression(dynamic_cast<const VariableDeclaration*>(node)->expression(), info);
+      break;
+    case NodeType::ReturnStatement:
+      info.returns.push_back(node);
+      collectExpression(node, info);
+      break;
+    case NodeType::Expression:
+      collectExpression(node, info);
+      break;
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      collectExpression(conditional->expression(), info);
+      collectScope(conditional->scope(), info);
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      collectExpression(loop->initExpression(), info);
+      collectExpression(loop->conditionExpression(), info);
+      collectScope(loop->scope(), info);
+      collectExpression(loop->updateExpression(), info);
+      break;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      collectExpression(switchNode->expression(), info);
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        collectScope(switchCase.scope.get(), info);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void Interprocedural::collectExpression(const Parser::Nodes::Node* node, FunctionInfo& info) {
+  if (!node) {
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      collectExpression(binaryNode->lhs(), info);
+      collectExpression(binaryNode->rhs(), info);
+      break;
+    }
+    case NodeType::UnaryOperation:
+      collectExpression(dynamic_cast<const Parser::Nodes::UnaryOperation*>(node)->operand(), info);
+      break;
+    case NodeType::Call:
+      info.calls.push_back(node);
+      [[fallthrough]];
+    default:
+      for (const auto& child : node->children()) {
+        collectExpression(child.get(), info);
+      }
+      break;
+  }
+}
+
+void Interprocedural::findResult(FunctionInfo& info) const {
+  // Every path has to end in a return, which it does if the body does, as nothing else can follow a conditional
+  const auto& statements = info.function->scope()->statements();
+  if (info.returns.empty() || statements.empty() || statements.back()->type() != NodeType::ReturnStatement) {
+    return;
+  }
+
+  const Sema::ValueType returnType = m_types->type(info.returns.front());
+  std::optional<int64_t> result;
+  for (const Node* returnNode : info.returns) {
+    const std::optional<int64_t> value =
+        returnNode->children().empty() ? std::nullopt : literalValue(returnNode->children().front().get());
+    if (!value || !fits(*value, returnType) || (result && *result != *value)) {
+      return;
+    }
+    result = value;
+  }
+  info.result = result;
+  info.trivial = statements.size() == 1;
+}
+
+bool Interprocedural::isFolded(const Parser::Nodes::Node* call) const {
+  const auto it = m_functions.find(call->token()->value.value());
+  if (it == m_functions.end() || m_types->call(call).isExternal || !it->second.trivial) {
+    return false;
+  }
+  return std::ranges::none_of(call->children(), [](const auto& argument) { return hasSideEffects(argument.get()); });
+}
+
+void Interprocedural::markReachable(FunctionInfo& info) {
+  if (info.reachable) {
+    return;
+  }
+  info.reachable = true;
+  for (const Node* call : info.calls) {
+    // A folded call is never made, and has no calls in its arguments as they'd be side effects
+    if (FunctionInfo* target = callee(call); target && !isFolded(call)) {
+      markReachable(*target);
+    }
+  }
+}
+
+void Interprocedural::propagateParameters(const FunctionInfo& info) {
+  const auto& parameters = info.function->parameters();
+  if (parameters.empty() || info.function->name() == "main" || info.function->isExported()) {
+    return;
+  }
+
+  // Every call that's made has to agree on the literal
+  std::vector<std::optional<int64_t>> values(parameters.size());
+  bool called = false;
+  for (const FunctionInfo& caller : m_functions | std::views::values) {
+    if (!caller.reachable) {
+      continue;
+    }
+    for (const Node* call : caller.calls) {
+      if (callee(call) != &info || isFolded(call)) {
+        continue;
+      }
+      for (size_t i = 0; i < parameters.size(); i++) {
+        const std::optional<int64_t> value = literalValue(call->children()[i].get());
+        if (!called) {
+          values[i] = value;
+        } else if (values[i] != value) {
+          values[i] = std::nullopt;
+        }
+      }
+      called = true;
+    }
+  }
+  if (!called || std::ranges::none_of(values, [](const auto& value) { return value.has_value(); })) {
+    return;
+  }
+
+  m_scopes.clear();
+  m_reads.clear();
+  m_written.clear();
+  m_scopes.emplace_back();
+  for (const auto& parameter : parameters) {
+    m_scopes.back().insert_or_assign(parameter->name(), parameter.get());
+  }
+  resolveScope(info.function->scope());
+  m_scopes.clear();
+
+  for (size_t i = 0; i < parameters.size(); i++) {
+    const VariableDeclaration* parameter = parameters[i].get();
+    if (!values[i] || !fits(*values[i], m_types->type(parameter)) || m_written.contains(parameter)) {
+      continue;
+    }
+    // The parameter itself is marked too, so it isn't stored on entry
+    m_types->setConstant(parameter, {*values[i]});
+    for (const Node* read : m_reads[parameter]) {
+      m_types->setConstant(read, {*values[i]});
+    }
+    m_report.constantParameters++;
+  }
+}
+
+void Interprocedural::resolveScope(const Parser::Nodes::Scope* scope) {
+  m_scopes.emplace_back();
+  for (const auto& statement : scope->statements()) {
+    resolveStatement(statement.get());
+  }
+  m_scopes.pop_back();
+}
+
+void Interprocedural::resolveStatement(const Parser::Nodes::Node* node) {
+  switch (node->type()) {
+    case NodeType::VariableDeclaration: {
+      const auto* variable = dynamic_cast<const VariableDeclaration*>(node);
+      resolveExpression(variable->expression());
+      // A local hides any parameter of the same name
+      m_scopes.back().insert_or_assign(variable->name(), nullptr);
+      break;
+    }
+    case NodeType::ReturnStatement:
+    case NodeType::Expression:
+      resolveExpression(node);
+      break;
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      resolveExpression(conditional->expression());
+      resolveScope(conditional->scope());
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      resolveExpression(loop->initExpression());
+      resolveExpression(loop->conditionExpression());
+      resolveScope(loop->scope());
+      resolveExpression(loop->updateExpression());
+      break;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      resolveExpression(switchNode->expression());
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        resolveScope(switchCase.scope.get());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void Interprocedural::resolveExpression(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return;
+  }
+
+  switch (node->type()) {
+    case NodeType::Identifier:
+      bind(node, false);
+      break;
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign &&
+          binaryNode->lhs()->type() == NodeType::Identifier) {
+        bind(binaryNode->lhs(), true);
+      } else {
+        resolveExpression(binaryNode->lhs());
+      }
+      resolveExpression(binaryNode->rhs());
+      break;
+    }
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      const bool modifies = unaryNode->operation() == Parser::Nodes::UnaryOperationType::Increment ||
+                            unaryNode->operation() == Parser::Nodes::UnaryOperationType::Decrement;
+      if (modifies && unaryNode->operand()->type() == NodeType::Identifier) {
+        bind(unaryNode->operand(), true);
+      } else {
+        resolveExpression(unaryNode->operand());
+      }
+      break;
+    }
+    default:
+      for (const auto& child : node->children()) {
+        resolveExpression(child.get());
+      }
+      break;
+  }
+}
+
+void Interprocedural::bind(const Parser::Nodes::Node* identifier, bool written) {
+  const std::string& name = identifier->token()->value.value();
+  for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope) {
+    if (const auto it = scope->find(name); it != scope->end()) {
+      if (const VariableDeclaration* parameter = it->second) {
+        m_reads[parameter].push_back(identifier);
+        if (written) {
+          m_written.insert(parameter);
+        }
+      }
+      return;
+    }
+  }
+}
+
+Interprocedural::FunctionInfo* Interprocedural::callee(const Parser::Nodes::Node* call) {
+  if (m_types->call(call).isExternal) {
+    return nullptr;
+  }
+  const auto it = m_functions.find(call->token()->value.value());
+  return it == m_functions.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+class Function;
+class Scope;
+class VariableDeclaration;
+}  // namespace Cepheid::Parser::Nodes
+
+namespace Cepheid::Sema {
+class ExpressionTypes;
+}
+
+namespace Cepheid::Opt {
+
+/**
+ * Optimises a module using what its call graph says about each function:
+ *  - functions that can't be reached from main or an exported function are removed
+ *  - a parameter passed the same literal by every call is replaced by that literal, when the function never assigns it
+ *  - a function whose every return gives the same literal makes its calls that literal, and calls to a function that
+ *    does nothing but return it aren't made at all if their arguments have no side effects
+ *
+ * Runs after type checking, recording what it finds as constants in the expression types for the generator.
+ */
+class Interprocedural {
+ public:
+  struct Report {
+    size_t unreachableFunctions = 0;
+    size_t constantParameters = 0;
+    size_t constantCalls = 0;
+  };
+
+  /// Run over a whole module, removing unreachable functions from it
+  Report run(Parser::Nodes::Node* root, Sema::ExpressionTypes& types);
+
+ private:
+  struct FunctionInfo {
+    const Parser::Nodes::Function* function = nullptr;
+    std::vector<const Parser::Nodes::Node*> calls;
+    std::vector<const Parser::Nodes::Node*> returns;
+    std::optional<int64_t> result;
+    /// The body is only a return of the result
+    bool trivial = false;
+    bool reachable = false;
+  };
+
+  void collectScope(const Parser::Nodes::Scope* scope, FunctionInfo& info);
+  void collectStatement(const Parser::Nodes::Node* node, FunctionInfo& info);
+  void collectExpression(const Parser::Nodes::Node* node, FunctionInfo& info);
+
+  void findResult(FunctionInfo& info) const;
+  [[nodiscard]] bool isFolded(const Parser::Nodes::Node* call) const;
+  void markReachable(FunctionInfo& info);
+  void propagateParameters(const FunctionInfo& info);
+
+  void resolveScope(const Parser::Nodes::Scope* scope);
+  void resolveStatement(const Parser::Nodes::Node* node);
+  void resolveExpression(const Parser::Nodes::Node* node);
+  void bind(const Parser::Nodes::Node* identifier, bool written);
+
+  [[nodiscard]] FunctionInfo* callee(const Parser::Nodes::Node* call);
+
+  Sema::ExpressionTypes* m_types = nullptr;
+  std::map<std::string, FunctionInfo, std::less<>> m_functions;
+
+  // Parameters of the function being resolved, with every identifier reading each of them
+  std::vector<std::map<std::string, const Parser::Nodes::VariableDeclaration*, std::less<>>> m_scopes;
+  std::unordered_map<const Parser::Nodes::VariableDeclaration*, std::vector<const Parser::Nodes::Node*>> m_reads;
+  std::unordered_set<const Parser::Nodes::VariableDeclaration*> m_written;
+
+  Report m_report;
+};
+
+}  // namespace Cepheid::Opt
@@ -0,0 +1,80 @@
+#include "SideEffects.h"
+
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Intrinsic.h>
+#include <Parser/Node/UnaryOperation.h>
+
+using namespace Cepheid::Opt;
+
+using Cepheid::Parser::Nodes::NodeType;
+
+namespace Cepheid::Opt {
+namespace {
+/// Whether a node does anything itself, asking recurse about its operands
+template <typename Recurse>
+bool sideEffects(const Parser::Nodes::Node* node, Recurse&& recurse) {
+  switch (node->type()) {
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      if (binaryNode->operation() == Parser::Nodes::BinaryOperationType::Assign) {
+        return true;
+      }
+      return recurse(binaryNode->lhs()) || recurse(binaryNode->rhs());
+    }
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      if (unaryNode->operation() == Parser::Nodes::UnaryOperationType::Increment ||
+          unaryNode->operation() == Parser::Nodes::UnaryOperationType::Decrement) {
+        return true;
+      }
+      return recurse(unaryNode->operand());
+    }
+    case NodeType::Intrinsic:
+      // Reading the timestamp counter gives a different value each time, and the others are only there for what they do
+      switch (dynamic_cast<const Parser::Nodes::Intrinsic*>(node)->intrinsic()) {
+        case Parser::Nodes::IntrinsicType::ReadTimestamp:
+        case Parser::Nodes::IntrinsicType::PrefetchT0:
+        case Parser::Nodes::IntrinsicType::PrefetchNta:
+        case Parser::Nodes::IntrinsicType::Pause:
+          return true;
+        default:
+          break;
+      }
+      [[fallthrough]];
+    case NodeType::Expression:
+      for (const auto& child : node->children()) {
+        if (recurse(child.get())) {
+          return true;
+        }
+      }
+      return false;
+    case NodeType::Identifier:
+    case NodeType::IntegerLiteral:
+      return false;
+    default:
+      // Anything we don't know about is assumed to do something
+      return true;
+  }
+}
+}  // namespace
+}  // namespace Cepheid::Opt
+
+bool Cepheid::Opt::hasSideEffects(const Parser::Nodes::Node* node) {
+  if (!node) {
+    return false;
+  }
+  return sideEffects(node, [](const Parser::Nodes::Node* operand) { return hasSideEffects(operand); });
+}
+
+bool Cepheid::Opt::hasSideEffects(const Parser::Nodes::Node* node, SideEffectCache& cache) {
+  if (!node) {
+    return false;
+  }
+  if (const auto it = cache.find(node); it != cache.end()) {
+    return it->second;
+  }
+  const bool result =
+      sideEffects(node, [&cache](const Parser::Nodes::Node* operand) { return hasSideEffects(operand, cache); });
+  cache.try_emplace(node, result);
+  return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <unordered_map>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+}
+
+namespace Cepheid::Opt {
+
+/// Whether evaluating an expression can change program state, e.g. by assigning to or incrementing a variable
+[[nodiscard]] bool hasSideEffects(const Parser::Nodes::Node* node);
+
+/// Side effects of the expressions already looked at, by node
+using SideEffectCache = std::unordered_map<const Parser::Nodes::Node*, bool>;
+
+/// As above, remembering the answer for the expression and everything in it so asking about any of them again is free
+[[nodiscard]] bool hasSideEffects(const Parser::Nodes::Node* node, SideEffectCache& cache);
+
+}  // namespace Cepheid::Opt
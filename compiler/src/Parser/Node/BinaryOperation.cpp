@@ -1,11 +1,14 @@
 #include "BinaryOperation.h"
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
 
 using namespace Cepheid::Parser::Nodes;
 
 BinaryOperationType Cepheid::Parser::Nodes::tokenToBinaryOperation(const Cepheid::Tokens::Token& token) {
-  static std::map<std::string_view, BinaryOperationType> tokenToOp = {
+  static constexpr std::array<std::pair<std::string_view, BinaryOperationType>, 13> tokenToOp = {{
       {"+", BinaryOperationType::Add},
       {"-", BinaryOperationType::Subtract},
       {"*", BinaryOperationType::Multiply},
@@ -16,8 +19,14 @@ BinaryOperationType Cepheid::Parser::Nodes::tokenToBinaryOperation(const Cepheid
       {">=", BinaryOperationType::GreaterEqual},
       {"==", BinaryOperationType::Equal},
       {"!=", BinaryOperationType::NotEqual},
-      {"=", BinaryOperationType::Assign}};
-  return tokenToOp.at(*token.value);
+      {"&&", BinaryOperationType::LogicalAnd},
+      {"||", BinaryOperationType::LogicalOr},
+      {"=", BinaryOperationType::Assign}}};
+  const auto it = std::ranges::find(tokenToOp, *token.value, &std::pair<std::string_view, BinaryOperationType>::first);
+  if (it == tokenToOp.end()) {
+    throw std::out_of_range("Unknown binary operator");
+  }
+  return it->second;
 }
 
 BinaryOperation::BinaryOperation(BinaryOperationType operation)
@@ -15,6 +15,8 @@ enum class BinaryOperationType {
   GreaterEqual,
   Equal,
   NotEqual,
+  LogicalAnd,
+  LogicalOr,
   Assign
 };
 
@@ -15,3 +15,7 @@ const Node* Conditional::expression() const {
 const Scope* Conditional::scope() const {
   return m_scope.get();
 }
+
+Scope* Conditional::scope() {
+  return m_scope.get();
+}
@@ -13,6 +13,7 @@ class Conditional : public Node {
   [[nodiscard]] const Node* expression() const;
 
   [[nodiscard]] const Scope* scope() const;
+  [[nodiscard]] Scope* scope();
 
  private:
   NodePtr m_expression;
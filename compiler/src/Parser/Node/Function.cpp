@@ -1,6 +1,7 @@
 #include "Function.h"
 
 #include <Parser/Node/Scope.h>
+#include <Parser/Node/VariableDeclaration.h>
 
 using namespace Cepheid::Parser::Nodes;
 
@@ -11,8 +12,20 @@ const std::string& Function::name() const {
   return m_name;
 }
 
-void Function::addParameter() {
-  // TODO
+void Function::addParameter(std::unique_ptr<VariableDeclaration> parameter) {
+  m_parameters.push_back(std::move(parameter));
+}
+
+const std::vector<std::unique_ptr<VariableDeclaration>>& Function::parameters() const {
+  return m_parameters;
+}
+
+void Function::setExported(bool exported) {
+  m_exported = exported;
+}
+
+bool Function::isExported() const {
+  return m_exported;
 }
 
 void Function::setReturnType(NodePtr returnType) {
@@ -31,10 +44,6 @@ const Scope* Function::scope() const {
   return m_scope.get();
 }
 
-size_t Function::requiredStackSpace() const {
-  // TODO: Add up stack space for parameters
-  if (!m_scope) {
-    return 0;
-  }
-  return m_scope->requiredStackSpace();
+Scope* Function::scope() {
+  return m_scope.get();
 }
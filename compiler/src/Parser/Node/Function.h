@@ -2,8 +2,12 @@
 
 #include <Parser/Node/ParseNode.h>
 
+#include <memory>
+#include <vector>
+
 namespace Cepheid::Parser::Nodes {
 class Scope;
+class VariableDeclaration;
 
 class Function : public Node {
  public:
@@ -12,18 +16,24 @@ class Function : public Node {
 
   [[nodiscard]] const std::string& name() const;
 
-  void addParameter();
+  void addParameter(std::unique_ptr<VariableDeclaration> parameter);
+  [[nodiscard]] const std::vector<std::unique_ptr<VariableDeclaration>>& parameters() const;
+
+  /// Exported functions can be called from other modules
+  void setExported(bool exported);
+  [[nodiscard]] bool isExported() const;
 
   void setReturnType(NodePtr returnType);
   [[nodiscard]] const Node* returnType() const;
 
   void setScope(std::unique_ptr<Scope> scope);
   [[nodiscard]] const Scope* scope() const;
-
-  [[nodiscard]] size_t requiredStackSpace() const;
+  [[nodiscard]] Scope* scope();
 
  private:
   std::string m_name;
+  std::vector<std::unique_ptr<VariableDeclaration>> m_parameters;
+  bool m_exported = false;
   NodePtr m_returnType;
   std::unique_ptr<Scope> m_scope;
 };
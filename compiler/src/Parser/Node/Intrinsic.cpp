@@ -0,0 +1,34 @@
+#include "Intrinsic.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+using namespace Cepheid::Parser::Nodes;
+
+std::optional<IntrinsicType> Cepheid::Parser::Nodes::nameToIntrinsic(std::string_view name) {
+  static constexpr std::array<std::pair<std::string_view, IntrinsicType>, 10> nameToType = {{
+      {"popcnt", IntrinsicType::PopCount},
+      {"lzcnt", IntrinsicType::LeadingZeros},
+      {"tzcnt", IntrinsicType::TrailingZeros},
+      {"bswap", IntrinsicType::ByteSwap},
+      {"rotl", IntrinsicType::RotateLeft},
+      {"rotr", IntrinsicType::RotateRight},
+      {"rdtsc", IntrinsicType::ReadTimestamp},
+      {"prefetcht0", IntrinsicType::PrefetchT0},
+      {"prefetchnta", IntrinsicType::PrefetchNta},
+      {"pause", IntrinsicType::Pause}}};
+  const auto it = std::ranges::find(nameToType, name, &std::pair<std::string_view, IntrinsicType>::first);
+  if (it == nameToType.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+Intrinsic::Intrinsic(IntrinsicType intrinsic, Tokens::Token token)
+    : Node(NodeType::Intrinsic, std::move(token)), m_intrinsic(intrinsic) {
+}
+
+IntrinsicType Intrinsic::intrinsic() const {
+  return m_intrinsic;
+}
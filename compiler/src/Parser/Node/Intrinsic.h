@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Parser/Node/ParseNode.h>
+
+#include <optional>
+#include <string_view>
+
+namespace Cepheid::Parser::Nodes {
+
+enum class IntrinsicType {
+  PopCount,
+  LeadingZeros,
+  TrailingZeros,
+  ByteSwap,
+  RotateLeft,
+  RotateRight,
+  ReadTimestamp,
+  PrefetchT0,
+  PrefetchNta,
+  Pause
+};
+
+/// The intrinsic a call to the name is lowered to, if the name is one of theirs
+[[nodiscard]] std::optional<IntrinsicType> nameToIntrinsic(std::string_view name);
+
+/// A call to a builtin that is generated in place as one instruction, or a short sequence where the target lacks it.
+/// Its arguments are its children, in order, as they are for a call.
+class Intrinsic : public Node {
+ public:
+  Intrinsic(IntrinsicType intrinsic, Tokens::Token token);
+  ~Intrinsic() override = default;
+
+  [[nodiscard]] IntrinsicType intrinsic() const;
+
+ private:
+  IntrinsicType m_intrinsic;
+};
+
+}  // namespace Cepheid::Parser::Nodes
@@ -27,3 +27,7 @@ const Node* Loop::updateExpression() const {
 const Scope* Loop::scope() const {
   return m_scope.get();
 }
+
+Scope* Loop::scope() {
+  return m_scope.get();
+}
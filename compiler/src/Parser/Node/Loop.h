@@ -14,6 +14,7 @@ class Loop : public Node {
   [[nodiscard]] const Node* conditionExpression() const;
   [[nodiscard]] const Node* updateExpression() const;
   [[nodiscard]] const Scope* scope() const;
+  [[nodiscard]] Scope* scope();
 
  private:
   NodePtr m_initExpression;
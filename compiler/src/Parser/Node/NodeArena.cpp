@@ -0,0 +1,48 @@
+#include "NodeArena.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace Cepheid::Parser::Nodes;
+
+namespace {
+thread_local NodeArena* currentArena = nullptr;
+
+// Enough for a few hundred nodes, so small programs fit in the first block
+constexpr size_t blockSize = 64 * 1024;
+
+constexpr size_t alignment = alignof(std::max_align_t);
+}  // namespace
+
+void* NodeArena::allocate(size_t size) {
+  size = (size + alignment - 1) / alignment * alignment;
+  if (m_blocks.empty() || m_used + size > m_blocks.back().size) {
+    const size_t newSize = std::max(blockSize, size);
+    m_blocks.push_back({std::make_unique<std::byte[]>(newSize), newSize});
+    m_used = 0;
+  }
+  void* memory = m_blocks.back().memory.get() + m_used;
+  m_used += size;
+  return memory;
+}
+
+void NodeArena::reset() {
+  if (m_blocks.size() > 1) {
+    auto largest = std::ranges::max_element(m_blocks, {}, &Block::size);
+    Block kept = std::move(*largest);
+    m_blocks.clear();
+    m_blocks.push_back(std::move(kept));
+  }
+  m_used = 0;
+}
+
+NodeArena::Scope::Scope(NodeArena* arena) : m_previous(std::exchange(currentArena, arena)) {
+}
+
+NodeArena::Scope::~Scope() {
+  currentArena = m_previous;
+}
+
+NodeArena* NodeArena::current() {
+  return currentArena;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+/**
+ * Memory for the parse nodes of one compilation, given back all at once rather than node by node.
+ *
+ * Nodes made on a thread while an arena is installed there with a Scope come from the arena, any others from the heap.
+ * Deleting an arena node only runs its destructor, so every tree made in an arena has to be destroyed before the arena
+ * is reset or destroyed. Each thread compiling concurrently needs its own arena.
+ */
+class NodeArena {
+ public:
+  NodeArena() = default;
+  NodeArena(const NodeArena& other) = delete;
+  NodeArena& operator=(const NodeArena& other) = delete;
+  NodeArena(NodeArena&& other) noexcept = default;
+  NodeArena& operator=(NodeArena&& other) noexcept = default;
+  ~NodeArena() = default;
+
+  [[nodiscard]] void* allocate(size_t size);
+
+  /// Free everything allocated so far, keeping the largest block for the next compilation
+  void reset();
+
+  /// Install an arena on the calling thread for the scope's lifetime, nodes come from the heap if it's null
+  class Scope {
+   public:
+    explicit Scope(NodeArena* arena);
+    Scope(const Scope& other) = delete;
+    Scope& operator=(const Scope& other) = delete;
+    ~Scope();
+
+   private:
+    NodeArena* m_previous;
+  };
+
+  /// Arena installed on the calling thread, if there is one
+  [[nodiscard]] static NodeArena* current();
+
+ private:
+  struct Block {
+    std::unique_ptr<std::byte[]> memory;
+    size_t size;
+  };
+
+  std::vector<Block> m_blocks;
+  /// Bytes used of the last block
+  size_t m_used = 0;
+};
+}  // namespace Cepheid::Parser::Nodes
@@ -1,16 +1,45 @@
 #include "ParseNode.h"
 
+#include <Parser/Node/NodeArena.h>
+#include <Trace/Trace.h>
+
+#include <new>
+
 using namespace Cepheid::Parser::Nodes ;
 
 using Cepheid::Tokens::Token;
 
+namespace {
+// Each node is preceded by the arena it came from, as delete isn't told, keeping the node itself aligned
+constexpr size_t headerSize = alignof(std::max_align_t);
+}  // namespace
+
+void* Node::operator new(std::size_t size) {
+  NodeArena* arena = NodeArena::current();
+  auto* memory =
+      static_cast<std::byte*>(arena ? arena->allocate(headerSize + size) : ::operator new(headerSize + size));
+  *reinterpret_cast<NodeArena**>(memory) = arena;
+  return memory + headerSize;
+}
+
+void Node::operator delete(void* node) {
+  std::byte* memory = static_cast<std::byte*>(node) - headerSize;
+  // Arena memory is freed along with the arena
+  if (!*reinterpret_cast<NodeArena**>(memory)) {
+    ::operator delete(memory);
+  }
+}
+
 Node::Node(NodeType type) : m_type(type) {
+  Trace::countNode();
 }
 
-Node::Node(NodeType type, Token token) : m_type(type), m_token(token) {
+Node::Node(NodeType type, Token token) : m_type(type), m_offset(token.offset), m_token(token) {
+  Trace::countNode();
 }
 
 Node::Node(NodeType type, NodePtr child) : m_type(type) {
+  Trace::countNode();
   addChild(std::move(child));
 }
 
@@ -18,6 +47,10 @@ void Node::addChild(NodePtr child) {
   m_children.push_back(std::move(child));
 }
 
+size_t Node::removeChildren(const std::function<bool(const Node*)>& predicate) {
+  return std::erase_if(m_children, [&predicate](const NodePtr& child) { return predicate(child.get()); });
+}
+
 NodeType Node::type() const {
   return m_type;
 }
@@ -26,6 +59,14 @@ const std::optional<Token>& Node::token() const {
   return m_token;
 }
 
+Cepheid::Tokens::SourceOffset Node::offset() const {
+  return m_offset;
+}
+
+void Node::setOffset(Tokens::SourceOffset offset) {
+  m_offset = offset;
+}
+
 const std::vector<NodePtr>& Node::children() const {
   return m_children;
 }
@@ -2,6 +2,8 @@
 
 #include <Tokeniser/Token.h>
 
+#include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <memory>
 #include <string_view>
@@ -24,6 +26,11 @@ enum class NodeType {
   IntegerLiteral,
   Conditional,
   Loop,
+  ModuleDeclaration,
+  Import,
+  Call,
+  Switch,
+  Intrinsic,
 };
 
 class Node;
@@ -34,21 +41,32 @@ class Node {
   template <typename... ArgsT>
   static NodePtr make(ArgsT&&... args);
 
+  /// Nodes of every type come from the thread's NodeArena when one is installed
+  static void* operator new(std::size_t size);
+  static void operator delete(void* node);
+
   explicit Node(NodeType type);
   Node(NodeType type, Tokens::Token token);
   Node(NodeType type, NodePtr child);
   virtual ~Node() = default;
   void addChild(NodePtr child);
+  /// Remove every child matching the predicate, returning how many were removed
+  size_t removeChildren(const std::function<bool(const Node*)>& predicate);
 
   [[nodiscard]] NodeType type() const;
   [[nodiscard]] const std::optional<Tokens::Token>& token() const;
 
+  /// Where the node starts in the source, which the parser records for statements and nodes with a token have anyway
+  [[nodiscard]] Tokens::SourceOffset offset() const;
+  void setOffset(Tokens::SourceOffset offset);
+
   [[nodiscard]] const std::vector<NodePtr>& children() const;
 
   [[nodiscard]] const Node* child(NodeType type) const;
 
  private:
   NodeType m_type;
+  Tokens::SourceOffset m_offset = 0;
   std::optional<Tokens::Token> m_token;
   std::vector<NodePtr> m_children;
 };
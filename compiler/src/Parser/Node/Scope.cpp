@@ -8,9 +8,6 @@ Scope::Scope() : Node(NodeType::Scope) {
 }
 
 void Scope::addStatement(NodePtr statement) {
-  if (const auto* scopeNode = dynamic_cast<const Scope*>(statement.get())) {
-    m_scopes.push_back(scopeNode);
-  }
   if (const auto* variableNode = dynamic_cast<const VariableDeclaration*>(statement.get())) {
     m_locals.push_back(variableNode);
   }
@@ -22,16 +19,22 @@ const std::vector<NodePtr>& Scope::statements() const {
   return m_statements;
 }
 
-size_t Scope::requiredStackSpace() const {
-  size_t localsSize = 0;
-  for (const VariableDeclaration* local : m_locals) {
-    localsSize += 8;  // TODO: Not everything is 8 bytes
+size_t Scope::removeStatements(const std::function<bool(const Node*)>& predicate) {
+  const size_t removed =
+      std::erase_if(m_statements, [&predicate](const NodePtr& statement) { return predicate(statement.get()); });
+
+  if (removed != 0) {
+    m_locals.clear();
+    for (const auto& statement : m_statements) {
+      if (const auto* variableNode = dynamic_cast<const VariableDeclaration*>(statement.get())) {
+        m_locals.push_back(variableNode);
+      }
+    }
   }
 
-  size_t scopesMax = 0;
-  for (const Scope* scope : m_scopes) {
-    scopesMax = std::max(scopesMax, scope->requiredStackSpace());
-  }
+  return removed;
+}
 
-  return localsSize + scopesMax;
+const std::vector<const VariableDeclaration*>& Scope::locals() const {
+  return m_locals;
 }
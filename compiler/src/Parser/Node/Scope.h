@@ -2,6 +2,8 @@
 
 #include <Parser/Node/ParseNode.h>
 
+#include <functional>
+
 namespace Cepheid::Parser::Nodes {
 class VariableDeclaration;
 
@@ -14,14 +16,14 @@ class Scope : public Node {
 
   [[nodiscard]] const std::vector<NodePtr>& statements() const;
 
-  [[nodiscard]] const std::vector<const VariableDeclaration*>& locals() const;
+  /// Remove every statement matching the predicate, returning how many were removed
+  size_t removeStatements(const std::function<bool(const Node*)>& predicate);
 
-  [[nodiscard]] size_t requiredStackSpace() const;
+  [[nodiscard]] const std::vector<const VariableDeclaration*>& locals() const;
 
  private:
   std::vector<NodePtr> m_statements;
   std::vector<const VariableDeclaration*> m_locals;
-  std::vector<const Scope*> m_scopes;
 };
 
 }  // namespace Cepheid::Parser::Nodes
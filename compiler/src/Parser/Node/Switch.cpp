@@ -0,0 +1,24 @@
+#include "Switch.h"
+
+#include <Parser/Node/Scope.h>
+
+using namespace Cepheid::Parser::Nodes;
+
+Switch::Switch(NodePtr expression, std::vector<SwitchCase> cases)
+    : Node(NodeType::Switch), m_expression(std::move(expression)), m_cases(std::move(cases)) {
+}
+
+// Cases own their scopes, which are only complete here
+Switch::~Switch() = default;
+
+const Node* Switch::expression() const {
+  return m_expression.get();
+}
+
+const std::vector<SwitchCase>& Switch::cases() const {
+  return m_cases;
+}
+
+std::vector<SwitchCase>& Switch::cases() {
+  return m_cases;
+}
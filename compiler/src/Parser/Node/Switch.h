@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Parser/Node/ParseNode.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Scope;
+
+/// Body run when the switched on value is any of the case's values, or none of the other cases' for the default
+struct SwitchCase {
+  std::vector<int64_t> values;
+  bool isDefault = false;
+  std::unique_ptr<Scope> scope;
+};
+
+/// Runs the one case matching a value, with no fall through from one case into the next
+class Switch : public Node {
+ public:
+  Switch(NodePtr expression, std::vector<SwitchCase> cases);
+  ~Switch() override;
+
+  [[nodiscard]] const Node* expression() const;
+
+  [[nodiscard]] const std::vector<SwitchCase>& cases() const;
+  [[nodiscard]] std::vector<SwitchCase>& cases();
+
+ private:
+  NodePtr m_expression;
+  std::vector<SwitchCase> m_cases;
+};
+
+}  // namespace Cepheid::Parser::Nodes
@@ -1,16 +1,23 @@
 #include "UnaryOperation.h"
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
 
 using namespace Cepheid::Parser::Nodes;
 
 UnaryOperationType Cepheid::Parser::Nodes::tokenToUnaryOperation(const Cepheid::Tokens::Token& token) {
-  static std::map<std::string_view, UnaryOperationType> tokenToOp = {
+  static constexpr std::array<std::pair<std::string_view, UnaryOperationType>, 4> tokenToOp = {{
       {"-", UnaryOperationType::Negate},
       {"!", UnaryOperationType::Not},
       {"--", UnaryOperationType::Decrement},
-      {"++", UnaryOperationType::Increment}};
-  return tokenToOp.at(*token.value);
+      {"++", UnaryOperationType::Increment}}};
+  const auto it = std::ranges::find(tokenToOp, *token.value, &std::pair<std::string_view, UnaryOperationType>::first);
+  if (it == tokenToOp.end()) {
+    throw std::out_of_range("Unknown unary operator");
+  }
+  return it->second;
 }
 
 UnaryOperation::UnaryOperation(UnaryOperationType operation)
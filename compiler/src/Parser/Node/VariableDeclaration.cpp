@@ -19,3 +19,11 @@ void Cepheid::Parser::Nodes::VariableDeclaration::setExpression(NodePtr expressi
 const Cepheid::Parser::Nodes::Node* Cepheid::Parser::Nodes::VariableDeclaration::expression() const {
   return m_expression.get();
 }
+
+void Cepheid::Parser::Nodes::VariableDeclaration::setConstant(bool constant) {
+  m_constant = constant;
+}
+
+bool Cepheid::Parser::Nodes::VariableDeclaration::isConstant() const {
+  return m_constant;
+}
@@ -14,10 +14,15 @@ class VariableDeclaration : public Node {
   void setExpression(NodePtr expression);
   [[nodiscard]] const Node* expression() const;
 
+  /// Constants are module variables that can't be assigned to, so reading one is its value
+  void setConstant(bool constant);
+  [[nodiscard]] bool isConstant() const;
+
  private:
   NodePtr m_typeName;
   std::string m_name;
   NodePtr m_expression;
+  bool m_constant = false;
 };
 
 }  // namespace Cepheid::Parser::Nodes
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <exception>
+#include <string>
 
 namespace Cepheid::Parser {
 
 class ParseException : public std::exception {
  public:
-  using std::exception::exception;
+  ParseException() = default;
+  explicit ParseException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
 };
 }  // namespace Cepheid::Parser
\ No newline at end of file
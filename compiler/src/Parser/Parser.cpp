@@ -4,27 +4,58 @@
 #include <Parser/Node/BinaryOperation.h>
 #include <Parser/Node/Conditional.h>
 #include <Parser/Node/Function.h>
+#include <Parser/Node/Intrinsic.h>
 #include <Parser/Node/Loop.h>
 #include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
 #include <Parser/Node/UnaryOperation.h>
 #include <Parser/Node/VariableDeclaration.h>
+#include <Tokeniser/LineTable.h>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <string>
 
 using namespace Cepheid::Parser;
 
 using Nodes::NodePtr;
 
+using Cepheid::Tokens::LineTable;
+using Cepheid::Tokens::SourceOffset;
 using Cepheid::Tokens::Token;
 using Cepheid::Tokens::TokenType;
 
-Parser::Parser(const std::vector<Token>& tokens) : m_tokens(tokens) {
+Parser::Parser(const std::vector<Token>& tokens, std::string_view src) : m_tokens(tokens), m_src(src) {
 }
 
 NodePtr Parser::parse() {
-  return parseModule();
+  try {
+    return parseModule();
+  } catch (const ParseException& e) {
+    if (m_src.empty()) {
+      throw;
+    }
+    // The error is at the token the parser had got to, or the end of the source if it ran out
+    const SourceOffset offset =
+        m_cursor < m_tokens.size() ? m_tokens[m_cursor].offset : static_cast<SourceOffset>(m_src.size());
+    const std::string message = std::string(e.what()) + " at " + LineTable(m_src).describe(offset);
+    throw ParseException(message.c_str());
+  }
 }
 
 NodePtr Parser::parseModule() {
   auto rootNode = std::make_unique<Nodes::Node>(Nodes::NodeType::Module);
+  // The head of the file says which module it's in, then what it imports
+  if (NodePtr declaration = parseModuleDeclaration()) {
+    rootNode->addChild(std::move(declaration));
+  }
+  while (NodePtr import = parseImport()) {
+    rootNode->addChild(std::move(import));
+  }
+
   while (peek()) {
     if (auto node = parseStatement()) {
       rootNode->addChild(std::move(node));
@@ -33,6 +64,46 @@ NodePtr Parser::parseModule() {
   return rootNode;
 }
 
+NodePtr Parser::parseModuleDeclaration() {
+  if (!checkNextHasValue(TokenType::Keyword, "module")) {
+    return nullptr;
+  }
+  consume();
+
+  const std::optional<Token> name = checkNextHasValue(TokenType::Identifier);
+  if (!name) {
+    throw ParseException("Expected module name");
+  }
+  consume();
+
+  if (!checkNext(TokenType::Terminator)) {
+    throw ParseException("Expected \";\"");
+  }
+  consume();
+
+  return Nodes::Node::make(Nodes::NodeType::ModuleDeclaration, *name);
+}
+
+NodePtr Parser::parseImport() {
+  if (!checkNextHasValue(TokenType::Keyword, "import")) {
+    return nullptr;
+  }
+  consume();
+
+  const std::optional<Token> name = checkNextHasValue(TokenType::Identifier);
+  if (!name) {
+    throw ParseException("Expected module name to import");
+  }
+  consume();
+
+  if (!checkNext(TokenType::Terminator)) {
+    throw ParseException("Expected \";\"");
+  }
+  consume();
+
+  return Nodes::Node::make(Nodes::NodeType::Import, *name);
+}
+
 NodePtr Parser::parseTypeName() {
   if (const auto name = checkNextHasValue(TokenType::Identifier)) {
     consume();
@@ -44,6 +115,11 @@ NodePtr Parser::parseTypeName() {
 }
 
 NodePtr Parser::parseFunctionDeclaration() {
+  const bool exported =
+      checkNextHasValue(TokenType::Keyword, "export") && checkNextHasValue(TokenType::Keyword, "func", 1);
+  if (exported) {
+    consume();
+  }
   if (!checkNextHasValue(TokenType::Keyword, "func")) {
     return nullptr;
   }
@@ -55,6 +131,7 @@ NodePtr Parser::parseFunctionDeclaration() {
   }
   consume();
   auto funcNode = std::make_unique<Nodes::Function>(name->value.value());
+  funcNode->setExported(exported);
 
   {
     const std::optional<Token> openParen = checkNext(TokenType::OpenParen);
@@ -64,8 +141,14 @@ NodePtr Parser::parseFunctionDeclaration() {
     consume();
 
     // Loop parsing parameters while not close paren
-    while (!checkNext(TokenType::CloseParen)) {
-      // TODO: parseParameterDefinition
+    while (peek() && !checkNext(TokenType::CloseParen)) {
+      if (!funcNode->parameters().empty()) {
+        if (!checkNext(TokenType::Delimiter)) {
+          throw ParseException("Expected \",\" between function parameters");
+        }
+        consume();
+      }
+      funcNode->addParameter(parseParameter());
     }
     if (const auto closeParen = consume(); !closeParen || closeParen->type != TokenType::CloseParen) {
       throw ParseException("Expected \")\" after function parameter list");
@@ -95,6 +178,21 @@ NodePtr Parser::parseFunctionDeclaration() {
   return funcNode;
 }
 
+std::unique_ptr<Nodes::VariableDeclaration> Parser::parseParameter() {
+  NodePtr typeName = parseTypeName();
+  if (!typeName) {
+    throw ParseException("Expected parameter typename");
+  }
+
+  const std::optional<Token> name = checkNextHasValue(TokenType::Identifier);
+  if (!name) {
+    throw ParseException("Expected parameter name");
+  }
+  consume();
+
+  return std::make_unique<Nodes::VariableDeclaration>(std::move(typeName), *name->value);
+}
+
 std::unique_ptr<Nodes::Scope> Parser::parseScope() {
   if (!checkNext(TokenType::OpenBrace)) {
     return nullptr;
@@ -118,18 +216,26 @@ std::unique_ptr<Nodes::Scope> Parser::parseScope() {
 }
 
 NodePtr Parser::parseStatement() {
-  if (NodePtr returnNode = parseReturnStatement()) {
-    return returnNode;
-  } else if (NodePtr functionDeclaration = parseFunctionDeclaration()) {
-    return functionDeclaration;
-  } else if (NodePtr variableDeclaration = parseVariableDeclaration()) {
-    return variableDeclaration;
-  } else if (NodePtr ifStatement = parseIfStatement()) {
-    return ifStatement;
-  } else if (NodePtr loopStatement = parseLoopStatement()) {
-    return loopStatement;
-  } else if (NodePtr expressionStatement = parseExpressionStatement()) {
-    return expressionStatement;
+  using StatementParser = NodePtr (Parser::*)();
+  static constexpr std::array<StatementParser, 7> parsers = {&Parser::parseReturnStatement,
+                                                             &Parser::parseFunctionDeclaration,
+                                                             &Parser::parseVariableDeclaration,
+                                                             &Parser::parseIfStatement,
+                                                             &Parser::parseLoopStatement,
+                                                             &Parser::parseSwitchStatement,
+                                                             &Parser::parseExpressionStatement};
+
+  if (checkNextHasValue(TokenType::Keyword, "module") || checkNextHasValue(TokenType::Keyword, "import")) {
+    throw ParseException("Module declarations and imports must come first in a file");
+  }
+
+  // Statements remember where they start, so the code generated for them can be mapped back to the source
+  const std::optional<Token> first = peek();
+  for (const StatementParser parser : parsers) {
+    if (NodePtr statement = (this->*parser)()) {
+      statement->setOffset(first->offset);
+      return statement;
+    }
   }
   return nullptr;
 }
@@ -155,8 +261,16 @@ NodePtr Parser::parseReturnStatement() {
 }
 
 NodePtr Parser::parseVariableDeclaration() {
+  const bool constant = checkNextHasValue(TokenType::Keyword, "const").has_value();
+  if (constant) {
+    consume();
+  }
+
   // We want at least 2 identifiers, one for the type and one for the variable name
   if (!checkNextHasValue(TokenType::Identifier) || !checkNextHasValue(TokenType::Identifier, std::nullopt, 1)) {
+    if (constant) {
+      throw ParseException("Expected type and name of constant");
+    }
     return nullptr;
   }
 
@@ -164,6 +278,10 @@ NodePtr Parser::parseVariableDeclaration() {
   const Token variableName = *consume();
 
   auto declaration = std::make_unique<Nodes::VariableDeclaration>(std::move(typeName), *variableName.value);
+  declaration->setConstant(constant);
+  if (constant && !checkNextHasValue(TokenType::Operator, "=")) {
+    throw ParseException("Expected value of constant");
+  }
   if (checkNextHasValue(TokenType::Operator, "=")) {
     consume();
     NodePtr expressionNode = parseExpression();
@@ -263,6 +381,99 @@ NodePtr Parser::parseLoopStatement() {
       std::move(initExpression), std::move(conditionExpression), std::move(updateExpression), std::move(scope));
 }
 
+NodePtr Parser::parseSwitchStatement() {
+  if (!checkNextHasValue(TokenType::Keyword, "switch")) {
+    return nullptr;
+  }
+  consume();
+
+  if (!checkNext(TokenType::OpenParen)) {
+    throw ParseException("Expected \"(\" in switch statement");
+  }
+  consume();
+
+  NodePtr expression = parseExpression();
+  if (!expression) {
+    throw ParseException("Expected expression in switch statement");
+  }
+
+  if (!checkNext(TokenType::CloseParen)) {
+    throw ParseException("Expected \")\" in switch statement");
+  }
+  consume();
+
+  if (!checkNext(TokenType::OpenBrace)) {
+    throw ParseException("Expected \"{\" for switch cases");
+  }
+  consume();
+
+  std::vector<Nodes::SwitchCase> cases;
+  std::set<int64_t> values;
+  bool hasDefault = false;
+  while (peek() && !checkNext(TokenType::CloseBrace)) {
+    Nodes::SwitchCase switchCase;
+    if (checkNextHasValue(TokenType::Keyword, "default")) {
+      consume();
+      if (hasDefault) {
+        throw ParseException("Switch has more than one default case");
+      }
+      hasDefault = switchCase.isDefault = true;
+    } else if (checkNextHasValue(TokenType::Keyword, "case")) {
+      consume();
+      // A case can match several values, separated by commas
+      for (;;) {
+        const int64_t value = parseCaseValue();
+        if (!values.insert(value).second) {
+          throw ParseException("Case value repeated in switch");
+        }
+        switchCase.values.push_back(value);
+        if (!checkNext(TokenType::Delimiter)) {
+          break;
+        }
+        consume();
+      }
+    } else {
+      throw ParseException("Expected case or default in switch");
+    }
+
+    switchCase.scope = parseScope();
+    if (!switchCase.scope) {
+      throw ParseException("Expected scope for switch case");
+    }
+    cases.push_back(std::move(switchCase));
+  }
+
+  if (!checkNext(TokenType::CloseBrace)) {
+    throw ParseException("Expected \"}\" after switch cases");
+  }
+  consume();
+
+  return std::make_unique<Nodes::Switch>(std::move(expression), std::move(cases));
+}
+
+int64_t Parser::parseCaseValue() {
+  const bool negative = checkNextHasValue(TokenType::Operator, "-").has_value();
+  if (negative) {
+    consume();
+  }
+
+  const std::optional<Token> literal = checkNextHasValue(TokenType::IntegerLiteral);
+  if (!literal) {
+    throw ParseException("Expected integer literal for case value");
+  }
+  consume();
+
+  // Parsed as its magnitude so the most negative value can be written
+  const std::string& text = literal->value.value();
+  uint64_t magnitude = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), magnitude);
+  const uint64_t limit = negative ? uint64_t{1} << 63 : std::numeric_limits<int64_t>::max();
+  if (error != std::errc{} || end != text.data() + text.size() || magnitude > limit) {
+    throw ParseException("Case value out of range");
+  }
+  return negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+}
+
 NodePtr Parser::parseExpressionStatement() {
   NodePtr expression = parseExpression();
 
@@ -306,11 +517,38 @@ std::optional<Token> Parser::parseOperator(const std::vector<std::string_view>&
 }
 
 NodePtr Parser::parseExpression() {
-  return Nodes::Node::make(Nodes::NodeType::Expression, parseEqualityOperation());
+  // Nothing, rather than an expression without a value, so callers can tell an expression was missing
+  NodePtr value = parseAssignmentOperation();
+  if (!value) {
+    return nullptr;
+  }
+  return Nodes::Node::make(Nodes::NodeType::Expression, std::move(value));
 }
 
-NodePtr Parser::parserAssignmentOperation() {
-  return parseBinaryOperation({"="}, &Parser::parseEqualityOperation);
+NodePtr Parser::parseAssignmentOperation() {
+  NodePtr target = parseLogicalOrOperation();
+  const std::optional<Token> opToken = parseOperator({"="});
+  if (!opToken) {
+    return target;
+  }
+
+  // Right associative, so a = b = c assigns c to b and then the result to a
+  auto assignNode = std::make_unique<Nodes::BinaryOperation>(Nodes::tokenToBinaryOperation(*opToken));
+  assignNode->setLHS(std::move(target));
+  NodePtr value = parseAssignmentOperation();
+  if (!value) {
+    throw ParseException("Expected right hand expression");
+  }
+  assignNode->setRHS(std::move(value));
+  return assignNode;
+}
+
+NodePtr Parser::parseLogicalOrOperation() {
+  return parseBinaryOperation({"||"}, &Parser::parseLogicalAndOperation);
+}
+
+NodePtr Parser::parseLogicalAndOperation() {
+  return parseBinaryOperation({"&&"}, &Parser::parseEqualityOperation);
 }
 
 NodePtr Parser::parseEqualityOperation() {
@@ -349,6 +587,9 @@ NodePtr Parser::parseBaseOperation() {
   if (checkNextHasValue(TokenType::IntegerLiteral)) {
     return Nodes::Node::make(Nodes::NodeType::IntegerLiteral, *consume());
   }
+  if (NodePtr call = parseCall()) {
+    return call;
+  }
   if (checkNextHasValue(TokenType::Identifier)) {
     return Nodes::Node::make(Nodes::NodeType::Identifier, *consume());
   }
@@ -364,6 +605,43 @@ NodePtr Parser::parseBaseOperation() {
   return {};
 }
 
+NodePtr Parser::parseCall() {
+  if (!checkNextHasValue(TokenType::Identifier) || !checkNext(TokenType::OpenParen, 1)) {
+    return nullptr;
+  }
+  // Intrinsics are called like functions, but are generated in place rather than called
+  const Token name = *consume();
+  NodePtr callNode;
+  if (const std::optional<Nodes::IntrinsicType> intrinsic = Nodes::nameToIntrinsic(*name.value)) {
+    callNode = std::make_unique<Nodes::Intrinsic>(*intrinsic, name);
+  } else {
+    callNode = Nodes::Node::make(Nodes::NodeType::Call, name);
+  }
+  consume();
+
+  // Arguments are the call's children, in order
+  while (peek() && !checkNext(TokenType::CloseParen)) {
+    if (!callNode->children().empty()) {
+      if (!checkNext(TokenType::Delimiter)) {
+        throw ParseException("Expected \",\" between call arguments");
+      }
+      consume();
+    }
+    NodePtr argument = parseExpression();
+    if (!argument || argument->children().empty() || !argument->children().front()) {
+      throw ParseException("Expected argument expression");
+    }
+    callNode->addChild(std::move(argument));
+  }
+
+  if (!checkNext(TokenType::CloseParen)) {
+    throw ParseException("Expected \")\" after call arguments");
+  }
+  consume();
+
+  return callNode;
+}
+
 NodePtr Parser::parseBinaryOperation(
     const std::vector<std::string_view>& operators, BinaryOperationParser precedentFunc) {
   NodePtr operationNode = std::invoke(precedentFunc, this);
@@ -3,7 +3,9 @@
 #include <Parser/Node/ParseNode.h>
 #include <Tokeniser/Token.h>
 
+#include <cstdint>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 namespace Cepheid::Parser {
@@ -14,17 +16,24 @@ class VariableDeclaration;
 
 class Parser {
  public:
-  explicit Parser(const std::vector<Tokens::Token>& tokens);
+  /// Errors say where in the source they are, when given the source the tokens came from
+  explicit Parser(const std::vector<Tokens::Token>& tokens, std::string_view src = {});
 
   [[nodiscard]] Nodes::NodePtr parse();
 
  private:
   Nodes::NodePtr parseModule();
 
+  Nodes::NodePtr parseModuleDeclaration();
+
+  Nodes::NodePtr parseImport();
+
   Nodes::NodePtr parseTypeName();
 
   Nodes::NodePtr parseFunctionDeclaration();
 
+  std::unique_ptr<Nodes::VariableDeclaration> parseParameter();
+
   std::unique_ptr<Nodes::Scope> parseScope();
 
   Nodes::NodePtr parseStatement();
@@ -37,13 +46,21 @@ class Parser {
 
   Nodes::NodePtr parseLoopStatement();
 
+  Nodes::NodePtr parseSwitchStatement();
+
+  int64_t parseCaseValue();
+
   Nodes::NodePtr parseExpressionStatement();
 
   std::optional<Tokens::Token> parseOperator(const std::vector<std::string_view>& operators);
 
   Nodes::NodePtr parseExpression();
 
-  Nodes::NodePtr parserAssignmentOperation();
+  Nodes::NodePtr parseAssignmentOperation();
+
+  Nodes::NodePtr parseLogicalOrOperation();
+
+  Nodes::NodePtr parseLogicalAndOperation();
 
   Nodes::NodePtr parseEqualityOperation();
 
@@ -57,6 +74,8 @@ class Parser {
 
   Nodes::NodePtr parseBaseOperation();
 
+  Nodes::NodePtr parseCall();
+
   using BinaryOperationParser = Nodes::NodePtr (Parser::*)();
 
   Nodes::NodePtr parseBinaryOperation(
@@ -72,5 +91,6 @@ class Parser {
 
   size_t m_cursor = 0;
   std::vector<Tokens::Token> m_tokens;
+  std::string_view m_src;
 };
 }  // namespace Cepheid::Parser
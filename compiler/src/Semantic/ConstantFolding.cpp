@@ -0,0 +1,217 @@
+#include "ConstantFolding.h"
+
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Intrinsic.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Semantic/TypeChecker.h>
+#include <Semantic/ValueType.h>
+
+#include <bit>
+#include <charconv>
+#include <limits>
+#include <string>
+
+using namespace Cepheid::Sema;
+
+using Cepheid::Parser::Nodes::BinaryOperationType;
+using Cepheid::Parser::Nodes::IntrinsicType;
+using Cepheid::Parser::Nodes::Node;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Parser::Nodes::UnaryOperationType;
+
+namespace {
+constexpr int64_t smallest = std::numeric_limits<int64_t>::min();
+constexpr int64_t largest = std::numeric_limits<int64_t>::max();
+
+/// Literals are written as their magnitude, which for the most negative value is only a value once negated
+std::optional<uint64_t> literalMagnitude(const Node* node) {
+  const std::string& text = node->token()->value.value();
+  uint64_t magnitude = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), magnitude);
+  if (error != std::errc{} || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return magnitude;
+}
+
+std::optional<int64_t> negate(const Node* operand, const ExpressionTypes& types) {
+  if (operand->type() == NodeType::IntegerLiteral) {
+    const std::optional<uint64_t> magnitude = literalMagnitude(operand);
+    if (!magnitude || *magnitude > uint64_t{1} << 63) {
+      return std::nullopt;
+    }
+    return static_cast<int64_t>(0 - *magnitude);
+  }
+  const std::optional<int64_t> value = types.folded(operand);
+  if (!value || *value == smallest) {
+    return std::nullopt;
+  }
+  return -*value;
+}
+
+/// Exact result of an arithmetic operation, if it fits in 64 bits
+std::optional<int64_t> arithmetic(BinaryOperationType operation, int64_t a, int64_t b) {
+  switch (operation) {
+    case BinaryOperationType::Add:
+      if ((b > 0 && a > largest - b) || (b < 0 && a < smallest - b)) {
+        return std::nullopt;
+      }
+      return a + b;
+    case BinaryOperationType::Subtract:
+      if ((b < 0 && a > largest + b) || (b > 0 && a < smallest + b)) {
+        return std::nullopt;
+      }
+      return a - b;
+    case BinaryOperationType::Multiply: {
+      if (a == 0 || b == 0) {
+        return 0;
+      }
+      // Dividing the most negative value by -1 would itself overflow
+      if (a == -1 || b == -1) {
+        const int64_t other = a == -1 ? b : a;
+        return other == smallest ? std::nullopt : std::optional<int64_t>(-other);
+      }
+      const auto product = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+      return product / b == a ? std::optional<int64_t>(product) : std::nullopt;
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+/// Result of an intrinsic that only computes a value, on the bits of its operand, if it's one of those
+std::optional<uint64_t> intrinsic(IntrinsicType intrinsic, uint64_t bits, uint64_t count, size_t width) {
+  const uint64_t mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+  bits &= mask;
+  count &= width - 1;
+  switch (intrinsic) {
+    case IntrinsicType::PopCount:
+      return std::popcount(bits);
+    case IntrinsicType::LeadingZeros:
+      return std::countl_zero(bits) - (64 - width);
+    case IntrinsicType::TrailingZeros:
+      return bits == 0 ? width : std::countr_zero(bits);
+    case IntrinsicType::ByteSwap: {
+      uint64_t swapped = 0;
+      for (size_t byte = 0; byte < width / 8; byte++) {
+        swapped = (swapped << 8) | ((bits >> (byte * 8)) & 0xff);
+      }
+      return swapped;
+    }
+    case IntrinsicType::RotateLeft:
+      return count == 0 ? bits : ((bits << count) | (bits >> (width - count))) & mask;
+    case IntrinsicType::RotateRight:
+      return count == 0 ? bits : ((bits >> count) | (bits << (width - count))) & mask;
+    default:
+      return std::nullopt;
+  }
+}
+}  // namespace
+
+std::optional<int64_t> Cepheid::Sema::constantValue(const Node* node, const ExpressionTypes& types) {
+  switch (node->type()) {
+    case NodeType::Expression:
+      return node->children().empty() ? std::nullopt : types.folded(node->children().front().get());
+    case NodeType::IntegerLiteral: {
+      const std::optional<uint64_t> magnitude = literalMagnitude(node);
+      if (!magnitude || *magnitude > static_cast<uint64_t>(largest)) {
+        return std::nullopt;
+      }
+      return static_cast<int64_t>(*magnitude);
+    }
+    case NodeType::Identifier:
+    case NodeType::Call: {
+      const std::optional<ExpressionTypes::Constant> constant = types.constant(node);
+      if (!constant || constant->evaluate) {
+        return std::nullopt;
+      }
+      return constant->value;
+    }
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      if (unaryNode->operation() == UnaryOperationType::Not) {
+        const std::optional<int64_t> operand = types.folded(unaryNode->operand());
+        return operand ? std::optional<int64_t>(*operand == 0 ? 1 : 0) : std::nullopt;
+      }
+      if (unaryNode->operation() != UnaryOperationType::Negate) {
+        return std::nullopt;
+      }
+      const std::optional<int64_t> value = negate(unaryNode->operand(), types);
+      return value && inRange(*value, types.type(node)) ? value : std::nullopt;
+    }
+    case NodeType::Intrinsic: {
+      const auto& arguments = node->children();
+      if (arguments.empty()) {
+        return std::nullopt;
+      }
+      const std::optional<int64_t> value = types.folded(arguments[0].get());
+      const std::optional<int64_t> count = arguments.size() > 1 ? types.folded(arguments[1].get()) : 0;
+      if (!value || !count) {
+        return std::nullopt;
+      }
+      const ValueType type = types.type(node);
+      const std::optional<uint64_t> bits = intrinsic(dynamic_cast<const Parser::Nodes::Intrinsic*>(node)->intrinsic(),
+                                                     static_cast<uint64_t>(*value),
+                                                     static_cast<uint64_t>(*count),
+                                                     type.size * 8);
+      if (!bits) {
+        return std::nullopt;
+      }
+      // Back to a value of the type, sign extending its top bit if it has one
+      const size_t unused = 64 - type.size * 8;
+      return type.isSigned ? static_cast<int64_t>(*bits << unused) >> unused : static_cast<int64_t>(*bits);
+    }
+    case NodeType::BinaryOperation:
+      break;
+    default:
+      return std::nullopt;
+  }
+
+  const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+  const BinaryOperationType operation = binaryNode->operation();
+  if (operation == BinaryOperationType::LogicalAnd || operation == BinaryOperationType::LogicalOr) {
+    // A left side that decides the result means the right is never evaluated, whatever it does
+    const bool isAnd = operation == BinaryOperationType::LogicalAnd;
+    const std::optional<int64_t> lhs = types.folded(binaryNode->lhs());
+    if (!lhs) {
+      return std::nullopt;
+    }
+    if ((*lhs != 0) != isAnd) {
+      return isAnd ? 0 : 1;
+    }
+    const std::optional<int64_t> rhs = types.folded(binaryNode->rhs());
+    return rhs ? std::optional<int64_t>(*rhs != 0 ? 1 : 0) : std::nullopt;
+  }
+
+  // Both sides are values of the type the operation is done at, so compare the same signed or not
+  const ValueType operandType = types.operandType(node);
+  const auto operand = [&types, operandType](const Node* operandNode) -> std::optional<int64_t> {
+    const std::optional<int64_t> value = types.folded(operandNode);
+    return value && inRange(*value, operandType) ? value : std::nullopt;
+  };
+  const std::optional<int64_t> lhs = operand(binaryNode->lhs());
+  const std::optional<int64_t> rhs = operand(binaryNode->rhs());
+  if (!lhs || !rhs) {
+    return std::nullopt;
+  }
+
+  switch (operation) {
+    case BinaryOperationType::LessThan:
+      return *lhs < *rhs ? 1 : 0;
+    case BinaryOperationType::LessEqual:
+      return *lhs <= *rhs ? 1 : 0;
+    case BinaryOperationType::GreaterThan:
+      return *lhs > *rhs ? 1 : 0;
+    case BinaryOperationType::GreaterEqual:
+      return *lhs >= *rhs ? 1 : 0;
+    case BinaryOperationType::Equal:
+      return *lhs == *rhs ? 1 : 0;
+    case BinaryOperationType::NotEqual:
+      return *lhs != *rhs ? 1 : 0;
+    default:
+      break;
+  }
+
+  const std::optional<int64_t> result = arithmetic(operation, *lhs, *rhs);
+  return result && inRange(*result, operandType) ? result : std::nullopt;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+}
+
+namespace Cepheid::Sema {
+class ExpressionTypes;
+
+/**
+ * Value of a type checked expression known without running it, made of literals, constants, intrinsics and calls known
+ * to return a value.
+ *
+ * Nothing if any part of it isn't known, or if any step's result doesn't fit the type it's worked out at, where the
+ * generated code would wrap or leave bits above a narrow type. The values of its operands come from
+ * ExpressionTypes::folded, which keeps each one, so folding every node of an expression only works each out once. The
+ * code generator folds expressions through that, and the type checker works out module variables' initial values.
+ */
+[[nodiscard]] std::optional<int64_t> constantValue(const Parser::Nodes::Node* node, const ExpressionTypes& types);
+
+}  // namespace Cepheid::Sema
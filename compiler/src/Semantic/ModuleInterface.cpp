@@ -0,0 +1,53 @@
+#include "ModuleInterface.h"
+
+#include <Parser/Node/Function.h>
+#include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/SemanticException.h>
+
+#include <algorithm>
+
+using namespace Cepheid::Sema;
+
+const FunctionSignature* ModuleInterface::function(std::string_view functionName) const {
+  const auto it = std::ranges::find(functions, functionName, &FunctionSignature::name);
+  return it == functions.end() ? nullptr : &*it;
+}
+
+ValueType Cepheid::Sema::declaredType(const Parser::Nodes::Node* typeName) {
+  const Parser::Nodes::Node* typeIdent = typeName ? typeName->child(Parser::Nodes::NodeType::Identifier) : nullptr;
+  if (!typeIdent || !typeIdent->token() || !typeIdent->token()->value) {
+    throw SemanticException("Invalid typename");
+  }
+
+  const std::optional<ValueType> type = primitiveType(*typeIdent->token()->value);
+  if (!type) {
+    throw SemanticException("Invalid type specified");
+  }
+  return *type;
+}
+
+FunctionSignature Cepheid::Sema::signature(const Parser::Nodes::Function* function) {
+  const Parser::Nodes::Node* returnType = function->returnType();
+  if (!returnType || returnType->children().empty()) {
+    throw SemanticException("Function has no return type");
+  }
+
+  FunctionSignature signature{function->name(), {}, declaredType(returnType->children().front().get())};
+  for (const auto& parameter : function->parameters()) {
+    signature.parameters.push_back(declaredType(parameter->typeName()));
+  }
+  return signature;
+}
+
+void Cepheid::Sema::addExports(const Parser::Nodes::Node* root, ModuleInterface& interface) {
+  for (const auto& child : root->children()) {
+    const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get());
+    if (!function || !function->isExported()) {
+      continue;
+    }
+    if (interface.function(function->name())) {
+      throw SemanticException("Function exported more than once");
+    }
+    interface.functions.push_back(signature(function));
+  }
+}
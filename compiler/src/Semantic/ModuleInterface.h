@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Semantic/ValueType.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Function;
+class Node;
+}  // namespace Cepheid::Parser::Nodes
+
+namespace Cepheid::Sema {
+
+struct FunctionSignature {
+  std::string name;
+  std::vector<ValueType> parameters;
+  ValueType returnType;
+
+  bool operator==(const FunctionSignature&) const = default;
+};
+
+/// Everything a module makes visible to the modules that import it
+struct ModuleInterface {
+  std::string name;
+  std::vector<FunctionSignature> functions;
+
+  [[nodiscard]] const FunctionSignature* function(std::string_view functionName) const;
+};
+
+/// Type named by a TypeName node, throwing a SemanticException if there's no such type
+[[nodiscard]] ValueType declaredType(const Parser::Nodes::Node* typeName);
+
+/// Signature of a function, throwing a SemanticException if any of its types are unknown
+[[nodiscard]] FunctionSignature signature(const Parser::Nodes::Function* function);
+
+/// Add every exported function in a parsed source to an interface
+void addExports(const Parser::Nodes::Node* root, ModuleInterface& interface);
+
+}  // namespace Cepheid::Sema
@@ -0,0 +1 @@
+#include "SemanticException.h"
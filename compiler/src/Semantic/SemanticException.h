@@ -0,0 +1,16 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+namespace Cepheid::Sema {
+
+class SemanticException : public std::exception {
+ public:
+  SemanticException() = default;
+  explicit SemanticException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
+};
+
+}  // namespace Cepheid::Sema
@@ -0,0 +1,486 @@
+#include "TypeChecker.h"
+
+#include <Parser/Node/BinaryOperation.h>
+#include <Parser/Node/Conditional.h>
+#include <Parser/Node/Function.h>
+#include <Parser/Node/Intrinsic.h>
+#include <Parser/Node/Loop.h>
+#include <Parser/Node/Scope.h>
+#include <Parser/Node/Switch.h>
+#include <Parser/Node/UnaryOperation.h>
+#include <Parser/Node/VariableDeclaration.h>
+#include <Semantic/ConstantFolding.h>
+#include <Semantic/SemanticException.h>
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+using namespace Cepheid::Sema;
+
+using Cepheid::Parser::Nodes::BinaryOperationType;
+using Cepheid::Parser::Nodes::IntrinsicType;
+using Cepheid::Parser::Nodes::Node;
+using Cepheid::Parser::Nodes::NodeType;
+using Cepheid::Parser::Nodes::UnaryOperationType;
+
+namespace {
+constexpr ValueType defaultLiteralType{8, true};
+constexpr ValueType comparisonType{4, true};
+/// Addresses and the timestamp counter are both unsigned 64 bit
+constexpr ValueType wordType{8, false};
+
+bool isLiteral(const Node* node) {
+  while (node && node->type() == NodeType::Expression && !node->children().empty()) {
+    node = node->children().front().get();
+  }
+  return node && node->type() == NodeType::IntegerLiteral;
+}
+
+/// Whether a literal, which is written as its magnitude, can be held by the type it takes
+bool literalInRange(const Node* literal, ValueType type, bool negated) {
+  const std::string& text = literal->token()->value.value();
+  uint64_t magnitude = 0;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), magnitude);
+  if (error != std::errc{} || end != text.data() + text.size()) {
+    return false;
+  }
+
+  // Literals are read as signed 64 bit values, whatever their type
+  const size_t bits = type.size * 8;
+  const uint64_t largest = type.isSigned || bits == 64 ? (uint64_t{1} << (bits - 1)) - 1 : (uint64_t{1} << bits) - 1;
+  if (negated) {
+    return type.isSigned ? magnitude <= largest + 1 : magnitude == 0;
+  }
+  return magnitude <= largest;
+}
+
+bool isComparison(BinaryOperationType operation) {
+  switch (operation) {
+    case BinaryOperationType::LessThan:
+    case BinaryOperationType::LessEqual:
+    case BinaryOperationType::GreaterThan:
+    case BinaryOperationType::GreaterEqual:
+    case BinaryOperationType::Equal:
+    case BinaryOperationType::NotEqual:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isLogical(BinaryOperationType operation) {
+  return operation == BinaryOperationType::LogicalAnd || operation == BinaryOperationType::LogicalOr;
+}
+}  // namespace
+
+void ExpressionTypes::set(const Parser::Nodes::Node* node, ValueType type, ValueType operandType) {
+  m_entries.insert_or_assign(node, Entry{type, operandType});
+}
+
+ValueType ExpressionTypes::type(const Parser::Nodes::Node* node) const {
+  const auto it = m_entries.find(node);
+  if (it == m_entries.end()) {
+    throw SemanticException("Expression has no type");
+  }
+  return it->second.type;
+}
+
+ValueType ExpressionTypes::operandType(const Parser::Nodes::Node* node) const {
+  const auto it = m_entries.find(node);
+  if (it == m_entries.end()) {
+    throw SemanticException("Expression has no type");
+  }
+  return it->second.operandType;
+}
+
+void ExpressionTypes::setCall(const Parser::Nodes::Node* node, CallTarget target) {
+  if (target.isExternal) {
+    m_externalFunctions.insert(target.signature.name);
+  }
+  m_calls.insert_or_assign(node, std::move(target));
+}
+
+const ExpressionTypes::CallTarget& ExpressionTypes::call(const Parser::Nodes::Node* node) const {
+  const auto it = m_calls.find(node);
+  if (it == m_calls.end()) {
+    throw SemanticException("Call has no target");
+  }
+  return it->second;
+}
+
+void ExpressionTypes::setConstant(const Parser::Nodes::Node* node, Constant constant) {
+  m_constants.insert_or_assign(node, constant);
+  // Anything folded so far may have used the old value
+  m_folded.clear();
+}
+
+std::optional<ExpressionTypes::Constant> ExpressionTypes::constant(const Parser::Nodes::Node* node) const {
+  if (const auto it = m_constants.find(node); it != m_constants.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> ExpressionTypes::folded(const Parser::Nodes::Node* node) const {
+  if (const auto it = m_folded.find(node); it != m_folded.end()) {
+    return it->second;
+  }
+  const std::optional<int64_t> value = constantValue(node, *this);
+  m_folded.insert_or_assign(node, value);
+  return value;
+}
+
+const std::set<std::string>& ExpressionTypes::externalFunctions() const {
+  return m_externalFunctions;
+}
+
+ExpressionTypes TypeChecker::run(const Parser::Nodes::Node* root, std::span<const ModuleInterface* const> imports) {
+  m_types = {};
+  m_functions.clear();
+
+  // Every function is declared up front, so calls can be made to functions defined further down
+  for (const auto& child : root->children()) {
+    if (const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get())) {
+      // A call to it would be parsed as the intrinsic
+      if (Parser::Nodes::nameToIntrinsic(function->name())) {
+        throw SemanticException("Function name is reserved for an intrinsic");
+      }
+      if (!m_functions.try_emplace(function->name(), ExpressionTypes::CallTarget{signature(function), false}).second) {
+        throw SemanticException("Function defined more than once");
+      }
+    }
+  }
+  // Functions defined here hide anything imported with the same name
+  for (const ModuleInterface* interface : imports) {
+    for (const FunctionSignature& function : interface->functions) {
+      const auto [it, inserted] = m_functions.try_emplace(function.name, ExpressionTypes::CallTarget{function, true});
+      if (!inserted && it->second.isExternal) {
+        throw SemanticException("Function imported from more than one module");
+      }
+    }
+  }
+
+  // Module variables are visible to every function, wherever they're declared
+  m_moduleVariables.clear();
+  m_scopes.clear();
+  for (const auto& child : root->children()) {
+    if (const auto* variable = dynamic_cast<const Parser::Nodes::VariableDeclaration*>(child.get())) {
+      checkModuleVariable(variable);
+    }
+  }
+
+  for (const auto& child : root->children()) {
+    if (const auto* function = dynamic_cast<const Parser::Nodes::Function*>(child.get())) {
+      checkFunction(function);
+    }
+  }
+  return std::move(m_types);
+}
+
+void TypeChecker::checkModuleVariable(const Parser::Nodes::VariableDeclaration* variable) {
+  if (m_moduleVariables.contains(variable->name())) {
+    throw SemanticException("Module variable defined more than once");
+  }
+
+  // The initialiser is evaluated before the variable is declared, so can't refer to it
+  const ValueType type = declaredType(variable->typeName());
+  int64_t value = 0;
+  if (const Node* expression = variable->expression()) {
+    checkExpression(expression, type);
+    // The same folding the code generator does, so it has to be exact at every step
+    const std::optional<int64_t> result = constantValue(expression, m_types);
+    if (!result) {
+      throw SemanticException("Module variable must be initialised with a constant that doesn't overflow");
+    }
+    if (!inRange(*result, type)) {
+      throw SemanticException("Module variable's initial value out of range of its type");
+    }
+    value = *result;
+  }
+
+  m_types.set(variable, type, type);
+  m_types.setConstant(variable, {value});
+  m_moduleVariables.emplace(variable->name(), variable);
+}
+
+void TypeChecker::checkFunction(const Parser::Nodes::Function* function) {
+  m_returnType = m_functions.at(function->name()).signature.returnType;
+
+  // Parameters live in a scope of their own around the body
+  m_scopes.clear();
+  m_scopes.emplace_back();
+  for (const auto& parameter : function->parameters()) {
+    const ValueType type = declaredType(parameter->typeName());
+    m_types.set(parameter.get(), type, type);
+    if (!m_scopes.back().try_emplace(parameter->name(), type).second) {
+      throw SemanticException("Parameter declared more than once");
+    }
+  }
+  checkScope(function->scope());
+  m_scopes.pop_back();
+}
+
+void TypeChecker::checkScope(const Parser::Nodes::Scope* scope) {
+  m_scopes.emplace_back();
+  for (const auto& statement : scope->statements()) {
+    checkStatement(statement.get());
+  }
+  m_scopes.pop_back();
+}
+
+void TypeChecker::checkStatement(const Parser::Nodes::Node* node) {
+  switch (node->type()) {
+    case NodeType::VariableDeclaration: {
+      const auto* variable = dynamic_cast<const Parser::Nodes::VariableDeclaration*>(node);
+      if (variable->isConstant()) {
+        throw SemanticException("Only module variables can be constant");
+      }
+      const ValueType type = declaredType(variable->typeName());
+      // The initialiser can't see the variable it initialises
+      if (variable->expression()) {
+        checkExpression(variable->expression(), type);
+      }
+      m_types.set(node, type, type);
+      m_scopes.back().insert_or_assign(variable->name(), type);
+      break;
+    }
+    case NodeType::ReturnStatement:
+      if (!node->children().empty()) {
+        checkExpression(node->children().front().get(), m_returnType);
+      }
+      m_types.set(node, m_returnType, m_returnType);
+      break;
+    case NodeType::Expression: {
+      const Node* expression = node->children().empty() ? nullptr : node->children().front().get();
+      if (const auto* intrinsic = dynamic_cast<const Parser::Nodes::Intrinsic*>(expression)) {
+        const ValueType type = checkIntrinsic(intrinsic, std::nullopt, true);
+        m_types.set(intrinsic, type, type);
+        m_types.set(node, type, type);
+        break;
+      }
+      checkExpression(node, std::nullopt);
+      break;
+    }
+    case NodeType::Conditional: {
+      const auto* conditional = dynamic_cast<const Parser::Nodes::Conditional*>(node);
+      checkExpression(conditional->expression(), std::nullopt);
+      checkScope(conditional->scope());
+      break;
+    }
+    case NodeType::Loop: {
+      const auto* loop = dynamic_cast<const Parser::Nodes::Loop*>(node);
+      if (loop->initExpression()) {
+        checkExpression(loop->initExpression(), std::nullopt);
+      }
+      checkExpression(loop->conditionExpression(), std::nullopt);
+      checkScope(loop->scope());
+      if (loop->updateExpression()) {
+        checkExpression(loop->updateExpression(), std::nullopt);
+      }
+      break;
+    }
+    case NodeType::Switch: {
+      const auto* switchNode = dynamic_cast<const Parser::Nodes::Switch*>(node);
+      const ValueType type = checkExpression(switchNode->expression(), std::nullopt);
+      for (const Parser::Nodes::SwitchCase& switchCase : switchNode->cases()) {
+        // A value the switched on type can't hold could never match
+        if (!std::ranges::all_of(switchCase.values, [type](int64_t value) { return inRange(value, type); })) {
+          throw SemanticException("Case value out of range of the switched on type");
+        }
+        checkScope(switchCase.scope.get());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+ValueType TypeChecker::checkExpression(const Parser::Nodes::Node* node, std::optional<ValueType> expected) {
+  ValueType type = expected.value_or(defaultLiteralType);
+  ValueType operandType = type;
+
+  switch (node->type()) {
+    case NodeType::Expression:
+      if (node->children().empty()) {
+        throw SemanticException("Empty expression");
+      }
+      type = operandType = checkExpression(node->children().front().get(), expected);
+      break;
+    case NodeType::IntegerLiteral:
+      // Otherwise it would be silently truncated to its type
+      if (!literalInRange(node, type, node == m_negatedLiteral)) {
+        throw SemanticException("Integer literal out of range of its type");
+      }
+      break;
+    case NodeType::Identifier: {
+      const std::string& name = node->token()->value.value();
+      const auto scope = std::find_if(
+          m_scopes.rbegin(), m_scopes.rend(), [&name](const auto& variables) { return variables.contains(name); });
+      if (scope != m_scopes.rend()) {
+        type = operandType = scope->find(name)->second;
+        break;
+      }
+
+      const auto variable = m_moduleVariables.find(name);
+      if (variable == m_moduleVariables.end()) {
+        throw SemanticException("Unknown identifier");
+      }
+      type = operandType = m_types.type(variable->second);
+      // Reading a constant is reading its value
+      if (variable->second->isConstant()) {
+        m_types.setConstant(node, *m_types.constant(variable->second));
+      }
+      break;
+    }
+    case NodeType::BinaryOperation: {
+      const auto* binaryNode = dynamic_cast<const Parser::Nodes::BinaryOperation*>(node);
+      if (binaryNode->operation() == BinaryOperationType::Assign) {
+        if (binaryNode->lhs()->type() != NodeType::Identifier) {
+          throw SemanticException("Left hand side of assignment must be a variable");
+        }
+        if (const auto* variable = moduleVariable(binaryNode->lhs()->token()->value.value());
+            variable && variable->isConstant()) {
+          throw SemanticException("Constants can't be assigned to");
+        }
+        type = operandType = checkExpression(binaryNode->lhs(), std::nullopt);
+        checkExpression(binaryNode->rhs(), type);
+        break;
+      }
+
+      // Each side is only tested against zero, so they needn't share a type
+      if (isLogical(binaryNode->operation())) {
+        checkExpression(binaryNode->lhs(), std::nullopt);
+        checkExpression(binaryNode->rhs(), std::nullopt);
+        type = operandType = comparisonType;
+        break;
+      }
+
+      // Parsed, but nothing is generated for it yet
+      if (binaryNode->operation() == BinaryOperationType::Divide) {
+        throw SemanticException("Division isn't supported");
+      }
+
+      // A literal takes the type of whatever it's combined with
+      ValueType lhsType;
+      ValueType rhsType;
+      if (isLiteral(binaryNode->lhs()) && !isLiteral(binaryNode->rhs())) {
+        rhsType = checkExpression(binaryNode->rhs(), expected);
+        lhsType = checkExpression(binaryNode->lhs(), rhsType);
+      } else {
+        lhsType = checkExpression(binaryNode->lhs(), expected);
+        rhsType = checkExpression(binaryNode->rhs(), isLiteral(binaryNode->rhs()) ? lhsType : expected);
+      }
+
+      operandType = commonType(lhsType, rhsType);
+      type = isComparison(binaryNode->operation()) ? comparisonType : operandType;
+      break;
+    }
+    case NodeType::Call:
+      type = operandType = checkCall(node);
+      break;
+    case NodeType::Intrinsic:
+      type = operandType = checkIntrinsic(dynamic_cast<const Parser::Nodes::Intrinsic*>(node), expected, false);
+      break;
+    case NodeType::UnaryOperation: {
+      const auto* unaryNode = dynamic_cast<const Parser::Nodes::UnaryOperation*>(node);
+      if (unaryNode->operation() == UnaryOperationType::Increment ||
+          unaryNode->operation() == UnaryOperationType::Decrement) {
+        if (unaryNode->operand()->type() != NodeType::Identifier) {
+          throw SemanticException("Only a variable can be incremented or decremented");
+        }
+        if (const auto* variable = moduleVariable(unaryNode->operand()->token()->value.value());
+            variable && variable->isConstant()) {
+          throw SemanticException("Constants can't be assigned to");
+        }
+      }
+      if (unaryNode->operation() == UnaryOperationType::Not) {
+        operandType = checkExpression(unaryNode->operand(), std::nullopt);
+        type = comparisonType;
+        break;
+      }
+      if (unaryNode->operation() == UnaryOperationType::Negate &&
+          unaryNode->operand()->type() == NodeType::IntegerLiteral) {
+        m_negatedLiteral = unaryNode->operand();
+      }
+      type = operandType = checkExpression(unaryNode->operand(), expected);
+      break;
+    }
+    default:
+      throw SemanticException("Unhandled expression");
+  }
+
+  m_types.set(node, type, operandType);
+  return type;
+}
+
+const Cepheid::Parser::Nodes::VariableDeclaration* TypeChecker::moduleVariable(std::string_view name) const {
+  if (std::ranges::any_of(m_scopes, [name](const auto& variables) { return variables.contains(name); })) {
+    return nullptr;
+  }
+  const auto variable = m_moduleVariables.find(name);
+  return variable != m_moduleVariables.end() ? variable->second : nullptr;
+}
+
+ValueType TypeChecker::checkCall(const Parser::Nodes::Node* node) {
+  const auto function = m_functions.find(node->token()->value.value());
+  if (function == m_functions.end()) {
+    throw SemanticException("Call to unknown function");
+  }
+
+  const FunctionSignature& signature = function->second.signature;
+  if (node->children().size() != signature.parameters.size()) {
+    throw SemanticException("Wrong number of arguments in call");
+  }
+  // Arguments are converted to their parameter's type, like an assignment
+  for (size_t i = 0; i < signature.parameters.size(); i++) {
+    checkExpression(node->children()[i].get(), signature.parameters[i]);
+  }
+
+  m_types.setCall(node, function->second);
+  return signature.returnType;
+}
+
+ValueType TypeChecker::checkIntrinsic(
+    const Parser::Nodes::Intrinsic* intrinsic, std::optional<ValueType> expected, bool isStatement) {
+  const auto& arguments = intrinsic->children();
+  const auto checkArguments = [&arguments](size_t count) {
+    if (arguments.size() != count) {
+      throw SemanticException("Wrong number of arguments to intrinsic");
+    }
+  };
+
+  switch (intrinsic->intrinsic()) {
+    case IntrinsicType::PopCount:
+    case IntrinsicType::LeadingZeros:
+    case IntrinsicType::TrailingZeros:
+    case IntrinsicType::ByteSwap:
+      checkArguments(1);
+      return checkExpression(arguments[0].get(), expected);
+    case IntrinsicType::RotateLeft:
+    case IntrinsicType::RotateRight: {
+      // Only the count's low bits are used, so it can be any type
+      checkArguments(2);
+      const ValueType type = checkExpression(arguments[0].get(), expected);
+      checkExpression(arguments[1].get(), std::nullopt);
+      return type;
+    }
+    case IntrinsicType::ReadTimestamp:
+      checkArguments(0);
+      return wordType;
+    case IntrinsicType::PrefetchT0:
+    case IntrinsicType::PrefetchNta:
+      checkArguments(1);
+      checkExpression(arguments[0].get(), wordType);
+      break;
+    case IntrinsicType::Pause:
+      checkArguments(0);
+      break;
+  }
+
+  if (!isStatement) {
+    throw SemanticException("Intrinsic has no value");
+  }
+  return wordType;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Semantic/ModuleInterface.h>
+#include <Semantic/ValueType.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Cepheid::Parser::Nodes {
+class Node;
+class Function;
+class Intrinsic;
+class Scope;
+class VariableDeclaration;
+}  // namespace Cepheid::Parser::Nodes
+
+namespace Cepheid::Sema {
+
+/// Type of every expression in a module, filled in by the type checker
+class ExpressionTypes {
+ public:
+  struct CallTarget {
+    FunctionSignature signature;
+    /// Defined in another module, so needs declaring to the assembler
+    bool isExternal = false;
+  };
+
+  /// Value an expression or parameter always has, found by looking at the whole program, or the value a module
+  /// variable starts with
+  struct Constant {
+    int64_t value = 0;
+    /// A call has to be made anyway when the callee does more than return the value
+    bool evaluate = false;
+  };
+
+  void set(const Parser::Nodes::Node* node, ValueType type, ValueType operandType);
+
+  /// Type of the value an expression produces
+  [[nodiscard]] ValueType type(const Parser::Nodes::Node* node) const;
+
+  /// Type the operands of an operation are converted to before it's done, e.g. the type a comparison compares at
+  [[nodiscard]] ValueType operandType(const Parser::Nodes::Node* node) const;
+
+  void setCall(const Parser::Nodes::Node* node, CallTarget target);
+  [[nodiscard]] const CallTarget& call(const Parser::Nodes::Node* node) const;
+
+  void setConstant(const Parser::Nodes::Node* node, Constant constant);
+  [[nodiscard]] std::optional<Constant> constant(const Parser::Nodes::Node* node) const;
+
+  /// Value the expression is known to have, worked out once for each node and kept until a constant changes
+  [[nodiscard]] std::optional<int64_t> folded(const Parser::Nodes::Node* node) const;
+
+  /// Names of the functions in other modules that are called
+  [[nodiscard]] const std::set<std::string>& externalFunctions() const;
+
+ private:
+  struct Entry {
+    ValueType type;
+    ValueType operandType;
+  };
+
+  std::unordered_map<const Parser::Nodes::Node*, Entry> m_entries;
+  std::unordered_map<const Parser::Nodes::Node*, CallTarget> m_calls;
+  std::unordered_map<const Parser::Nodes::Node*, Constant> m_constants;
+  mutable std::unordered_map<const Parser::Nodes::Node*, std::optional<int64_t>> m_folded;
+  std::set<std::string> m_externalFunctions;
+};
+
+/**
+ * Resolves the type of every expression.
+ *
+ * Operands of a binary operation are converted to the wider of their types, unsigned if they differ only in signedness.
+ * Integer literals take the type their context expects: the other operand, the variable being assigned or the
+ * function's return type, and have to fit in it. Comparisons produce an i32. Division is parsed but rejected, as no
+ * code is generated for it yet. Calls can be made to any function in the module, or any function exported by an
+ * imported module. Intrinsics take the type of the value they work on, apart from rdtsc's u64.
+ *
+ * Module variables can be used by every function in the module. Their initialisers are evaluated here, as their values
+ * are written into the program, so can only use literals and the constants declared before them.
+ */
+class TypeChecker {
+ public:
+  /// Check every function in a module, throwing a SemanticException on the first error. Runs before any optimisation,
+  /// so code that's later removed is still checked, and the optimisers and generator share the types it returns.
+  ExpressionTypes run(const Parser::Nodes::Node* root, std::span<const ModuleInterface* const> imports = {});
+
+ private:
+  void checkModuleVariable(const Parser::Nodes::VariableDeclaration* variable);
+  void checkFunction(const Parser::Nodes::Function* function);
+  void checkScope(const Parser::Nodes::Scope* scope);
+  void checkStatement(const Parser::Nodes::Node* node);
+  ValueType checkExpression(const Parser::Nodes::Node* node, std::optional<ValueType> expected);
+  ValueType checkCall(const Parser::Nodes::Node* node);
+  /// Intrinsics that only do something, like pause, have no value so can only be a whole statement
+  ValueType checkIntrinsic(
+      const Parser::Nodes::Intrinsic* intrinsic, std::optional<ValueType> expected, bool isStatement);
+  /// The module variable a name refers to, unless a local or parameter hides it
+  [[nodiscard]] const Parser::Nodes::VariableDeclaration* moduleVariable(std::string_view name) const;
+
+  std::map<std::string, ExpressionTypes::CallTarget, std::less<>> m_functions;
+  std::vector<std::map<std::string, ValueType, std::less<>>> m_scopes;
+  std::map<std::string, const Parser::Nodes::VariableDeclaration*, std::less<>> m_moduleVariables;
+  ValueType m_returnType;
+  /// Literal being checked as the operand of a minus sign, which can be one past the largest positive value
+  const Parser::Nodes::Node* m_negatedLiteral = nullptr;
+  ExpressionTypes m_types;
+};
+
+}  // namespace Cepheid::Sema
@@ -0,0 +1,54 @@
+#include "ValueType.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace Cepheid::Sema;
+
+namespace {
+constexpr std::array primitives{
+    PrimitiveType{"i8", {1, true}},
+    PrimitiveType{"i16", {2, true}},
+    PrimitiveType{"i32", {4, true}},
+    PrimitiveType{"i64", {8, true}},
+    PrimitiveType{"u8", {1, false}},
+    PrimitiveType{"u16", {2, false}},
+    PrimitiveType{"u32", {4, false}},
+    PrimitiveType{"u64", {8, false}},
+};
+}  // namespace
+
+std::span<const PrimitiveType> Cepheid::Sema::primitiveTypes() {
+  return primitives;
+}
+
+std::optional<ValueType> Cepheid::Sema::primitiveType(std::string_view name) {
+  const auto it = std::ranges::find(primitives, name, &PrimitiveType::name);
+  if (it == primitives.end()) {
+    return std::nullopt;
+  }
+  return it->type;
+}
+
+size_t Cepheid::Sema::operationSize(ValueType type) {
+  return std::max<size_t>(type.size, 4);
+}
+
+bool Cepheid::Sema::inRange(int64_t value, ValueType type) {
+  if (type.size >= sizeof(int64_t)) {
+    return type.isSigned || value >= 0;
+  }
+  const size_t bits = type.size * 8;
+  if (type.isSigned) {
+    return value >= -(int64_t{1} << (bits - 1)) && value < (int64_t{1} << (bits - 1));
+  }
+  return value >= 0 && value < (int64_t{1} << bits);
+}
+
+ValueType Cepheid::Sema::commonType(ValueType lhs, ValueType rhs) {
+  if (lhs.size != rhs.size) {
+    return lhs.size > rhs.size ? lhs : rhs;
+  }
+  // Mixing signedness at the same width works unsigned, as in C
+  return {lhs.size, lhs.isSigned && rhs.isSigned};
+}
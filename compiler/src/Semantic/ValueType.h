@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace Cepheid::Sema {
+
+/// Width and signedness of an integer value
+struct ValueType {
+  size_t size = 8;
+  bool isSigned = true;
+
+  auto operator<=>(const ValueType&) const = default;
+};
+
+struct PrimitiveType {
+  std::string_view name;
+  ValueType type;
+};
+
+[[nodiscard]] std::span<const PrimitiveType> primitiveTypes();
+[[nodiscard]] std::optional<ValueType> primitiveType(std::string_view name);
+
+/// Width an operation on a value of this type is done at, narrower values are worked on as 32 bits
+[[nodiscard]] size_t operationSize(ValueType type);
+
+/// Whether a value is exactly representable in a type
+[[nodiscard]] bool inRange(int64_t value, ValueType type);
+
+/// Type both operands of a binary operation are converted to before it's done
+[[nodiscard]] ValueType commonType(ValueType lhs, ValueType rhs);
+
+}  // namespace Cepheid::Sema
@@ -0,0 +1,68 @@
+#include "Server.h"
+
+#include <Build/ThreadPool.h>
+
+#include <memory>
+#include <sstream>
+
+using namespace Cepheid::Server;
+
+namespace {
+// A client sends its request as soon as it connects, so one that hasn't by then isn't going to
+constexpr std::chrono::seconds requestTimeout{30};
+}  // namespace
+
+Server::Server(std::filesystem::path socketPath, std::string compilerIdentity)
+    : m_socketPath(std::move(socketPath)),
+      m_listener(Socket::listen(m_socketPath)),
+      m_driver(std::move(compilerIdentity), &m_moduleCache) {
+}
+
+void Server::run() {
+  {
+    Build::ThreadPool pool;
+    while (!m_stopping) {
+      std::optional<Socket> connection = m_listener.accept();
+      if (!connection || m_stopping) {
+        continue;
+      }
+      // Otherwise a client that never sends would hold a worker forever
+      connection->setReceiveTimeout(requestTimeout);
+      pool.submit([this, connection = std::make_shared<Socket>(std::move(*connection))] { handle(*connection); });
+    }
+    pool.wait();
+  }
+
+  std::error_code error;
+  std::filesystem::remove(m_socketPath, error);
+}
+
+void Server::handle(const Socket& connection) {
+  const std::optional<Socket::Message> request = connection.receive();
+  if (!request || request->empty()) {
+    return;
+  }
+
+  if ((*request)[0] == "shutdown") {
+    m_stopping = true;
+    connection.send({std::to_string(EXIT_SUCCESS), "", ""});
+    // Wakes the accept loop so it sees the server is stopping
+    static_cast<void>(Socket::connect(m_socketPath));
+    return;
+  }
+  if ((*request)[0] != "compile" || request->size() < 2) {
+    connection.send({std::to_string(EXIT_FAILURE), "", "Unrecognised request\n"});
+    return;
+  }
+
+  std::stringstream out;
+  std::stringstream err;
+  int ret;
+  try {
+    ret = m_driver.run(std::span(*request).subspan(2), (*request)[1], out, err);
+  } catch (const std::exception& e) {
+    err << e.what() << std::endl;
+    ret = EXIT_FAILURE;
+  }
+  connection.send({std::to_string(ret), out.str(), err.str()});
+}
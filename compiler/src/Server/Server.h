@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Build/ModuleCache.h>
+#include <Driver.h>
+#include <Server/Socket.h>
+
+#include <atomic>
+#include <filesystem>
+
+namespace Cepheid::Server {
+/**
+ * Compile server, running command lines sent by clients over a Unix domain socket.
+ *
+ * Keeps a single process resident so a build issuing many small compiles doesn't pay for process startup on each one,
+ * and keeps the interfaces of the modules it has compiled in memory between requests. Requests are run concurrently.
+ *
+ * A request is a message of "compile", the client's working directory and the command line without the executable
+ * name. The reply is the exit code followed by everything the command printed to stdout and stderr. A request of just
+ * "shutdown" stops the server once the requests it's running have finished. A connection that sends nothing for 30
+ * seconds is closed.
+ */
+class Server {
+ public:
+  /// Start listening on socketPath, throwing a ServerException if that isn't possible
+  Server(std::filesystem::path socketPath, std::string compilerIdentity);
+
+  /// Serve requests until told to shut down
+  void run();
+
+ private:
+  void handle(const Socket& connection);
+
+  std::filesystem::path m_socketPath;
+  Socket m_listener;
+  Build::ModuleCache m_moduleCache;
+  Driver m_driver;
+  std::atomic<bool> m_stopping = false;
+};
+
+}  // namespace Cepheid::Server
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+namespace Cepheid::Server {
+
+class ServerException : public std::exception {
+ public:
+  ServerException() = default;
+  explicit ServerException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
+};
+
+}  // namespace Cepheid::Server
@@ -0,0 +1,240 @@
+#include "Socket.h"
+
+#include <Server/ServerException.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace Cepheid::Server;
+
+namespace {
+#ifdef MSG_NOSIGNAL
+// A client that goes away mid reply mustn't take the server down with a SIGPIPE
+constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sendFlags = 0;
+#endif
+
+// Larger fields are taken as a corrupt message rather than allocated
+constexpr uint32_t maxFieldSize = 1u << 30;
+
+#ifdef _WIN32
+using NativeHandle = SOCKET;
+
+bool startSockets() {
+  static const bool started = [] {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }();
+  return started;
+}
+
+void closeHandle(NativeHandle handle) {
+  closesocket(handle);
+}
+#else
+using NativeHandle = int;
+constexpr NativeHandle INVALID_SOCKET = -1;
+
+bool startSockets() {
+  return true;
+}
+
+void closeHandle(NativeHandle handle) {
+  ::close(handle);
+}
+#endif
+
+std::optional<sockaddr_un> address(const std::filesystem::path& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const std::string name = path.string();
+  if (name.size() >= sizeof(address.sun_path)) {
+    return std::nullopt;
+  }
+  std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+  return address;
+}
+
+void appendU32(std::string& bytes, size_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    bytes.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+uint32_t readU32(const char* bytes) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+  }
+  return value;
+}
+}  // namespace
+
+Socket::Socket(Handle handle) : m_handle(handle) {
+}
+
+Socket::Socket(Socket&& other) noexcept : m_handle(std::exchange(other.m_handle, std::nullopt)) {
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+  if (this != &other) {
+    close();
+    m_handle = std::exchange(other.m_handle, std::nullopt);
+  }
+  return *this;
+}
+
+Socket::~Socket() {
+  close();
+}
+
+void Socket::close() {
+  if (m_handle) {
+    closeHandle(static_cast<NativeHandle>(*m_handle));
+    m_handle.reset();
+  }
+}
+
+Socket Socket::listen(const std::filesystem::path& path) {
+  const std::optional<sockaddr_un> socketAddress = address(path);
+  if (!startSockets() || !socketAddress) {
+    throw ServerException(("Unable to listen on " + path.string()).c_str());
+  }
+  if (connect(path)) {
+    throw ServerException(("A server is already listening on " + path.string()).c_str());
+  }
+  // Left behind by a server that didn't shut down cleanly
+  std::error_code error;
+  std::filesystem::remove(path, error);
+
+  const NativeHandle handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (handle == INVALID_SOCKET) {
+    throw ServerException(("Unable to listen on " + path.string()).c_str());
+  }
+  Socket socket(handle);
+  if (::bind(handle, reinterpret_cast<const sockaddr*>(&*socketAddress), sizeof(sockaddr_un)) != 0 ||
+      ::listen(handle, SOMAXCONN) != 0) {
+    throw ServerException(("Unable to listen on " + path.string()).c_str());
+  }
+  return socket;
+}
+
+std::optional<Socket> Socket::connect(const std::filesystem::path& path) {
+  const std::optional<sockaddr_un> socketAddress = address(path);
+  if (!startSockets() || !socketAddress) {
+    return std::nullopt;
+  }
+  const NativeHandle handle = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (handle == INVALID_SOCKET) {
+    return std::nullopt;
+  }
+  Socket socket(handle);
+  if (::connect(handle, reinterpret_cast<const sockaddr*>(&*socketAddress), sizeof(sockaddr_un)) != 0) {
+    return std::nullopt;
+  }
+  return socket;
+}
+
+std::optional<Socket> Socket::accept() const {
+  const NativeHandle handle = ::accept(static_cast<NativeHandle>(*m_handle), nullptr, nullptr);
+  if (handle == INVALID_SOCKET) {
+    return std::nullopt;
+  }
+  return Socket(handle);
+}
+
+bool Socket::setReceiveTimeout(std::chrono::milliseconds timeout) const {
+#ifdef _WIN32
+  const DWORD value = static_cast<DWORD>(timeout.count());
+#else
+  timeval value{};
+  value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  value.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+#endif
+  return ::setsockopt(static_cast<NativeHandle>(*m_handle),
+                      SOL_SOCKET,
+                      SO_RCVTIMEO,
+                      reinterpret_cast<const char*>(&value),
+                      sizeof(value)) == 0;
+}
+
+bool Socket::send(const Message& message) const {
+  std::string bytes;
+  appendU32(bytes, message.size());
+  for (const std::string& field : message) {
+    appendU32(bytes, field.size());
+    bytes += field;
+  }
+  return write(bytes.data(), bytes.size());
+}
+
+std::optional<Socket::Message> Socket::receive() const {
+  char header[4];
+  if (!read(header, sizeof(header))) {
+    return std::nullopt;
+  }
+  const uint32_t count = readU32(header);
+
+  Message message;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!read(header, sizeof(header))) {
+      return std::nullopt;
+    }
+    const uint32_t size = readU32(header);
+    if (size > maxFieldSize) {
+      return std::nullopt;
+    }
+    std::string& field = message.emplace_back(size, '\0');
+    if (!read(field.data(), size)) {
+      return std::nullopt;
+    }
+  }
+  return message;
+}
+
+bool Socket::write(const char* bytes, size_t size) const {
+  while (size > 0) {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const auto sent = ::send(static_cast<NativeHandle>(*m_handle), bytes, chunk, sendFlags);
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+bool Socket::read(char* bytes, size_t size) const {
+  while (size > 0) {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const auto received = ::recv(static_cast<NativeHandle>(*m_handle), bytes, chunk, 0);
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= received;
+  }
+  return true;
+}
+
+std::filesystem::path Cepheid::Server::defaultSocketPath() {
+  std::error_code error;
+  const std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+  return (error ? std::filesystem::path() : directory) / "cepheid.sock";
+}
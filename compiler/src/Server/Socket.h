@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Cepheid::Server {
+/**
+ * Connected or listening Unix domain stream socket, carrying messages made of a list of strings.
+ *
+ * A message is a little endian u32 count of its fields followed by each field as a u32 length and its bytes.
+ */
+class Socket {
+ public:
+  using Message = std::vector<std::string>;
+
+  /// Listen on a new socket at path, throwing a ServerException if that isn't possible
+  [[nodiscard]] static Socket listen(const std::filesystem::path& path);
+
+  /// Nothing if nothing is listening at path
+  [[nodiscard]] static std::optional<Socket> connect(const std::filesystem::path& path);
+
+  Socket(const Socket& other) = delete;
+  Socket(Socket&& other) noexcept;
+  Socket& operator=(const Socket& other) = delete;
+  Socket& operator=(Socket&& other) noexcept;
+  ~Socket();
+
+  /// Wait for a client to connect to a listening socket
+  [[nodiscard]] std::optional<Socket> accept() const;
+
+  /// Make receive give up when nothing arrives for this long, rather than waiting forever
+  bool setReceiveTimeout(std::chrono::milliseconds timeout) const;
+
+  bool send(const Message& message) const;
+  /// Nothing if the other end closed the connection or sent something that isn't a message
+  [[nodiscard]] std::optional<Message> receive() const;
+
+ private:
+#ifdef _WIN32
+  using Handle = uintptr_t;
+#else
+  using Handle = int;
+#endif
+
+  explicit Socket(Handle handle);
+  void close();
+
+  bool write(const char* bytes, size_t size) const;
+  bool read(char* bytes, size_t size) const;
+
+  std::optional<Handle> m_handle;
+};
+
+/// Where the server listens and the client connects when they aren't given a socket
+[[nodiscard]] std::filesystem::path defaultSocketPath();
+
+}  // namespace Cepheid::Server
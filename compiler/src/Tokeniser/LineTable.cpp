@@ -0,0 +1,45 @@
+#include "LineTable.h"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace Cepheid::Tokens;
+
+LineTable::LineTable(std::string_view src) {
+  m_lineStarts.push_back(0);
+  size_t i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+  // Compare 16 bytes at a time, then walk the bits of the mask for any newlines among them
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= src.size(); i += 16) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src.data() + i));
+    for (auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline))); mask != 0;
+         mask &= mask - 1) {
+      m_lineStarts.push_back(static_cast<SourceOffset>(i + std::countr_zero(mask) + 1));
+    }
+  }
+#endif
+
+  for (; i < src.size(); i++) {
+    if (src[i] == '\n') {
+      m_lineStarts.push_back(static_cast<SourceOffset>(i + 1));
+    }
+  }
+}
+
+SourceLocation LineTable::locate(SourceOffset offset) const {
+  // The last line starting at or before the offset
+  const auto next = std::ranges::upper_bound(m_lineStarts, offset);
+  const auto line = static_cast<size_t>(next - m_lineStarts.begin()) - 1;
+  return {line, offset - m_lineStarts[line]};
+}
+
+std::string LineTable::describe(SourceOffset offset) const {
+  const SourceLocation location = locate(offset);
+  return "line " + std::to_string(location.line + 1) + ", column " + std::to_string(location.character + 1);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Tokeniser/Token.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Cepheid::Tokens {
+/// Line and column of a source offset, both counted from zero
+struct SourceLocation {
+  size_t line = 0;
+  size_t character = 0;
+};
+
+/**
+ * Offsets of the start of every line of a source, for turning token offsets into lines and columns.
+ *
+ * Tokens only carry their offset, so nothing keeps track of lines while tokenising. A table is built with one pass over
+ * the source, so only make one once a diagnostic or line mapping needs it.
+ */
+class LineTable {
+ public:
+  explicit LineTable(std::string_view src);
+
+  [[nodiscard]] SourceLocation locate(SourceOffset offset) const;
+
+  /// "line L, column C", counted from one
+  [[nodiscard]] std::string describe(SourceOffset offset) const;
+
+ private:
+  std::vector<SourceOffset> m_lineStarts;
+};
+}  // namespace Cepheid::Tokens
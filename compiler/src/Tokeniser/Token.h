@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string>
 
@@ -19,14 +20,12 @@ enum class TokenType {
   IntegerLiteral
 };
 
-struct SourceLocation {
-  size_t line = 0;
-  size_t character = 0;
-};
+/// Byte offset into a source, turned into a line and column by a LineTable only when one is needed
+using SourceOffset = uint32_t;
 
 struct Token {
   TokenType type;
   std::optional<std::string> value;
-  SourceLocation location;
+  SourceOffset offset = 0;
 };
 }  // namespace Cepheid::Tokens
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <exception>
+#include <string>
 
 namespace Cepheid::Tokens {
 class TokenisationException : public std::exception {
-  using std::exception::exception;
+ public:
+  TokenisationException() = default;
+  explicit TokenisationException(const char* m) : msg(m) {}
+  const char* what() const noexcept override { return msg.c_str(); }
+  std::string msg;
 };
 }  // namespace Cepheid::Token
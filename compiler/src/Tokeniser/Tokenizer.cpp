@@ -1,14 +1,19 @@
 #include "Tokenizer.h"
 
+#include <Tokeniser/LineTable.h>
 #include <Tokeniser/TokenisationException.h>
 
+#include <algorithm>
 #include <array>
-#include <format>
-#include <map>
+#include <limits>
+#include <utility>
 
 using namespace Cepheid::Tokens;
 
 Tokeniser::Tokeniser(std::string_view src) : m_src(src) {
+  if (src.size() > std::numeric_limits<SourceOffset>::max()) {
+    throw TokenisationException("Source file is too large");
+  }
 }
 
 std::vector<Token> Tokeniser::tokenise() {
@@ -29,7 +34,9 @@ std::vector<Token> Tokeniser::tokenise() {
     } else if (std::optional<Token> token = readIntegerLiteral()) {
       tokens.push_back(*token);
     } else {
-      throw TokenisationException("Unexpected token.");
+      // Only worth finding the line once there's an error to report
+      const std::string message = "Unexpected token at " + LineTable(m_src).describe(offset()) + ".";
+      throw TokenisationException(message.c_str());
     }
   }
   return tokens;
@@ -44,7 +51,8 @@ static bool isIdentChar(char character) {
 }
 
 static bool isKeyword(std::string_view identifier) {
-  static std::array<std::string_view, 8> keywords{"func", "return", "import", "export", "module", "if", "while", "for"};
+  static constexpr std::array<std::string_view, 12> keywords{
+      "func", "return", "import", "export", "module", "if", "while", "for", "switch", "case", "default", "const"};
 
   return std::ranges::find(keywords, identifier) != keywords.end();
 }
@@ -54,7 +62,7 @@ std::optional<Token> Tokeniser::readTokenOrKeyword() {
     return std::nullopt;
   }
 
-  SourceLocation startLocation = m_currentLocation;
+  const SourceOffset start = offset();
 
   std::string val(1, *consume());
 
@@ -64,51 +72,51 @@ std::optional<Token> Tokeniser::readTokenOrKeyword() {
 
   bool keyword = isKeyword(val);
 
-  return std::optional<Token>(std::in_place, keyword ? TokenType::Keyword : TokenType::Identifier, val, startLocation);
+  return std::optional<Token>(std::in_place, keyword ? TokenType::Keyword : TokenType::Identifier, val, start);
 }
 
 std::optional<Token> Tokeniser::readTerminator() {
   if (*peek() != ';') {
     return std::nullopt;
   }
-  SourceLocation startLocation = m_currentLocation;
+  const SourceOffset start = offset();
   consume();
-  return std::optional<Token>(std::in_place, TokenType::Terminator, std::nullopt, startLocation);
+  return std::optional<Token>(std::in_place, TokenType::Terminator, std::nullopt, start);
 }
 
 std::optional<Token> Tokeniser::readOperator() {
-  static const std::array operators{'+', '-', '/', '*', '.', '<', '>', '=', '!', '%'};
+  static constexpr std::array operators{'+', '-', '/', '*', '.', '<', '>', '=', '!', '%', '&', '|'};
 
   if (std::ranges::find(operators, *peek()) == operators.end()) {
     return std::nullopt;
   }
-  SourceLocation startLocation = m_currentLocation;
+  const SourceOffset start = offset();
 
-  return std::optional<Token>(std::in_place, TokenType::Operator, std::string(1, *consume()), startLocation);
+  return std::optional<Token>(std::in_place, TokenType::Operator, std::string(1, *consume()), start);
 }
 
 std::optional<Token> Tokeniser::readDelimiter() {
   if (*peek() != ',') {
     return std::nullopt;
   }
-  SourceLocation startLocation = m_currentLocation;
+  const SourceOffset start = offset();
   consume();
-  return std::optional<Token>(std::in_place, TokenType::Delimiter, std::nullopt, startLocation);
+  return std::optional<Token>(std::in_place, TokenType::Delimiter, std::nullopt, start);
 }
 
 std::optional<Token> Tokeniser::readBracket() {
-  static const std::map<char, TokenType> brackets{
+  static constexpr std::array<std::pair<char, TokenType>, 6> brackets{{
       {'(', TokenType::OpenParen},
       {')', TokenType::CloseParen},
       {'{', TokenType::OpenBrace},
       {'}', TokenType::CloseBrace},
       {'[', TokenType::OpenBracket},
-      {']', TokenType::CloseBracket}};
+      {']', TokenType::CloseBracket}}};
 
-  if (auto it = brackets.find(*peek()); it != brackets.end()) {
-    SourceLocation startLocation = m_currentLocation;
+  if (auto it = std::ranges::find(brackets, *peek(), &std::pair<char, TokenType>::first); it != brackets.end()) {
+    const SourceOffset start = offset();
     consume();
-    return std::optional<Token>(std::in_place, it->second, std::nullopt, startLocation);
+    return std::optional<Token>(std::in_place, it->second, std::nullopt, start);
   }
 
   return std::nullopt;
@@ -118,14 +126,14 @@ std::optional<Token> Tokeniser::readIntegerLiteral() {
   if (!std::isdigit(*peek())) {
     return std::nullopt;
   }
-  SourceLocation startLocation = m_currentLocation;
+  const SourceOffset start = offset();
 
   std::string literal;
   while (std::isdigit(*peek())) {
     literal += *consume();
   }
 
-  return std::optional<Token>(std::in_place, TokenType::IntegerLiteral, literal, startLocation);
+  return std::optional<Token>(std::in_place, TokenType::IntegerLiteral, literal, start);
 }
 
 std::optional<char> Tokeniser::peek() const {
@@ -141,11 +149,9 @@ std::optional<char> Tokeniser::consume() {
     return std::nullopt;
   }
 
-  m_currentLocation.character++;
-  if (m_src.at(m_cursor) == '\n') {
-    m_currentLocation.character = 0;
-    m_currentLocation.line++;
-  }
-
   return m_src.at(m_cursor++);
 }
+
+SourceOffset Tokeniser::offset() const {
+  return static_cast<SourceOffset>(m_cursor);
+}
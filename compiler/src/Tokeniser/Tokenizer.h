@@ -8,6 +8,7 @@
 namespace Cepheid::Tokens {
 class Tokeniser {
  public:
+  /// Sources are limited to 4 GiB, so offsets into them fit in 32 bits
   explicit Tokeniser(std::string_view src);
   std::vector<Token> tokenise();
 
@@ -21,9 +22,9 @@ class Tokeniser {
 
   std::optional<char> peek() const;
   std::optional<char> consume();
+  [[nodiscard]] SourceOffset offset() const;
 
   size_t m_cursor = 0;
-  SourceLocation m_currentLocation;
   std::string_view m_src;
 };
 }  // namespace Cepheid::Tokens
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <Trace/Trace.h>
+
+#include <cstdlib>
+#include <new>
+
+// Global allocation functions replaced to count allocations per thread for the time report. Counting is a thread local
+// increment, cheap enough to leave on whether or not anything is being traced.
+
+namespace {
+thread_local size_t allocations = 0;
+
+void* allocate(std::size_t size) {
+  allocations++;
+  while (true) {
+    if (void* memory = std::malloc(size ? size : 1)) {
+      return memory;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+}  // namespace
+
+size_t Cepheid::Trace::allocationCount() {
+  return allocations;
+}
+
+void* operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+  std::free(memory);
+}
@@ -0,0 +1,185 @@
+#include "Trace.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+using namespace Cepheid::Trace;
+
+namespace {
+thread_local Recorder* currentRecorder = nullptr;
+thread_local size_t nodes = 0;
+
+constexpr std::array<std::string_view, static_cast<size_t>(Recorder::Counter::Count)> counterNames = {
+    "tokens", "nodes", "instructions"};
+
+std::string_view categoryName(Recorder::Category category) {
+  switch (category) {
+    case Recorder::Category::Phase:
+      return "phase";
+    case Recorder::Category::File:
+      return "file";
+    case Recorder::Category::Function:
+      return "function";
+  }
+  return {};
+}
+
+double microseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+}  // namespace
+
+Recorder::Recorder(AllocationCounter allocationCounter)
+    : m_start(std::chrono::steady_clock::now()), m_allocationCounter(allocationCounter) {
+}
+
+size_t Recorder::allocations() const {
+  return m_allocationCounter ? m_allocationCounter() : 0;
+}
+
+void Recorder::record(Event event) {
+  std::lock_guard lock(m_mutex);
+  m_events.push_back(std::move(event));
+}
+
+size_t Recorder::threadIndex() {
+  const std::thread::id id = std::this_thread::get_id();
+  std::lock_guard lock(m_mutex);
+  const auto it = std::ranges::find(m_threads, id);
+  if (it != m_threads.end()) {
+    return it - m_threads.begin();
+  }
+  m_threads.push_back(id);
+  return m_threads.size() - 1;
+}
+
+void Recorder::writeTimeReport(std::ostream& out) const {
+  struct Phase {
+    std::string_view name;
+    std::chrono::steady_clock::time_point firstStart;
+    std::chrono::steady_clock::duration duration{};
+    size_t allocations = 0;
+    std::array<size_t, static_cast<size_t>(Counter::Count)> counts{};
+    std::array<bool, static_cast<size_t>(Counter::Count)> hasCount{};
+  };
+
+  // Held throughout, as the phases refer to the events' names
+  std::lock_guard lock(m_mutex);
+  std::vector<Phase> phases;
+  for (const Event& event : m_events) {
+    if (event.category != Category::Phase) {
+      continue;
+    }
+    auto phase = std::ranges::find(phases, event.name, &Phase::name);
+    if (phase == phases.end()) {
+      phase = phases.insert(phases.end(), Phase{event.name, event.start});
+    }
+    phase->firstStart = std::min(phase->firstStart, event.start);
+    phase->duration += event.duration;
+    phase->allocations += event.allocations;
+    for (size_t i = 0; i < counterNames.size(); i++) {
+      phase->counts[i] += event.hasCount[i] ? event.counts[i] : 0;
+      phase->hasCount[i] = phase->hasCount[i] || event.hasCount[i];
+    }
+  }
+  // Phases are listed in the order they first ran
+  std::ranges::sort(phases, {}, &Phase::firstStart);
+
+  out << "Time report:\n"
+      << "  " << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "wall ms";
+  for (const std::string_view counter : counterNames) {
+    out << std::setw(14) << counter;
+  }
+  if (m_allocationCounter) {
+    out << std::setw(14) << "allocations";
+  }
+  out << "\n";
+
+  const auto printCount = [&out](bool hasCount, size_t count) {
+    if (hasCount) {
+      out << std::setw(14) << count;
+    } else {
+      out << std::setw(14) << "-";
+    }
+  };
+  for (const Phase& phase : phases) {
+    out << "  " << std::left << std::setw(12) << phase.name << std::right << std::setw(12) << std::fixed
+        << std::setprecision(3) << std::chrono::duration<double, std::milli>(phase.duration).count();
+    for (size_t i = 0; i < counterNames.size(); i++) {
+      printCount(phase.hasCount[i], phase.counts[i]);
+    }
+    if (m_allocationCounter) {
+      printCount(true, phase.allocations);
+    }
+    out << "\n";
+  }
+  out << std::flush;
+}
+
+void Recorder::writeChromeTrace(std::ostream& out) const {
+  nlohmann::json events = nlohmann::json::array();
+  std::lock_guard lock(m_mutex);
+  for (const Event& event : m_events) {
+    nlohmann::json args = nlohmann::json::object();
+    if (m_allocationCounter) {
+      args["allocations"] = event.allocations;
+    }
+    for (size_t i = 0; i < counterNames.size(); i++) {
+      if (event.hasCount[i]) {
+        args[std::string(counterNames[i])] = event.counts[i];
+      }
+    }
+    events.push_back({{"name", event.name},
+                      {"cat", categoryName(event.category)},
+                      {"ph", "X"},
+                      {"ts", microseconds(event.start - m_start)},
+                      {"dur", microseconds(event.duration)},
+                      {"pid", 1},
+                      {"tid", event.thread},
+                      {"args", std::move(args)}});
+  }
+  out << nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}.dump() << std::endl;
+}
+
+Recorder* Cepheid::Trace::current() {
+  return currentRecorder;
+}
+
+Scope::Scope(Recorder* recorder) : m_previous(std::exchange(currentRecorder, recorder)) {
+}
+
+Scope::~Scope() {
+  currentRecorder = m_previous;
+}
+
+void Span::begin(Recorder* recorder, std::string_view name, Recorder::Category category) {
+  m_recorder = recorder;
+  m_event.name = name;
+  m_event.category = category;
+  m_event.thread = recorder->threadIndex();
+  m_event.counts = {};
+  m_event.hasCount = {};
+  m_nodesAtStart = nodes;
+  m_event.allocations = recorder->allocations();
+  m_event.start = std::chrono::steady_clock::now();
+}
+
+void Span::end() {
+  m_event.duration = std::chrono::steady_clock::now() - m_event.start;
+  m_event.allocations = m_recorder->allocations() - m_event.allocations;
+  if (nodes != m_nodesAtStart) {
+    count(Recorder::Counter::Nodes, nodes - m_nodesAtStart);
+  }
+  m_recorder->record(std::move(m_event));
+}
+
+size_t Cepheid::Trace::nodeCount() {
+  return nodes;
+}
+
+void Cepheid::Trace::countNode() {
+  nodes++;
+}
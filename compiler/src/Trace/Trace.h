@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Cepheid::Trace {
+/**
+ * Collects timed spans from one compiler invocation, for a time report or a Chrome trace.
+ *
+ * Spans are only recorded on threads where a recorder has been installed with a Scope, so tracing costs a thread local
+ * load and a branch per span when it's turned off. Tasks submitted to a ThreadPool run with the recorder of the thread
+ * that submitted them. Recording is thread safe.
+ */
+class Recorder {
+ public:
+  enum class Counter { Tokens, Nodes, Instructions, Count };
+
+  enum class Category {
+    /// Stages of the compiler, which make up the time report
+    Phase,
+    /// Work on one source file of a project
+    File,
+    /// Generating one function
+    Function,
+  };
+
+  struct Event {
+    std::string name;
+    Category category;
+    size_t thread;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration duration;
+    size_t allocations;
+    /// Only the counters set on the span are meaningful
+    std::array<size_t, static_cast<size_t>(Counter::Count)> counts;
+    std::array<bool, static_cast<size_t>(Counter::Count)> hasCount;
+  };
+
+  /// Allocations made so far on the calling thread
+  using AllocationCounter = size_t (*)();
+
+  /// Without an allocation counter no allocations are reported
+  explicit Recorder(AllocationCounter allocationCounter = nullptr);
+
+  void record(Event event);
+
+  /// Assign the calling thread a small id for its events
+  [[nodiscard]] size_t threadIndex();
+
+  /// Allocations made so far on the calling thread, or 0 if they aren't counted
+  [[nodiscard]] size_t allocations() const;
+
+  /// Wall time, counters and allocations of each phase, summed over every thread that ran it
+  void writeTimeReport(std::ostream& out) const;
+
+  /// Every event in the Chrome trace event format, for chrome://tracing or Perfetto
+  void writeChromeTrace(std::ostream& out) const;
+
+ private:
+  std::chrono::steady_clock::time_point m_start;
+  AllocationCounter m_allocationCounter;
+  mutable std::mutex m_mutex;
+  std::vector<Event> m_events;
+  std::vector<std::thread::id> m_threads;
+};
+
+/// Recorder installed on the calling thread, if there is one
+[[nodiscard]] Recorder* current();
+
+/// Install a recorder on the calling thread for the scope's lifetime, nothing is recorded if it's null
+class Scope {
+ public:
+  explicit Scope(Recorder* recorder);
+  Scope(const Scope& other) = delete;
+  Scope& operator=(const Scope& other) = delete;
+  ~Scope();
+
+ private:
+  Recorder* m_previous;
+};
+
+/**
+ * Times everything until it's destroyed, along with the allocations and parse nodes made on this thread meanwhile.
+ * Does nothing if the thread has no recorder.
+ */
+class Span {
+ public:
+  explicit Span(std::string_view name, Recorder::Category category = Recorder::Category::Phase) {
+    if (Recorder* recorder = current()) {
+      begin(recorder, name, category);
+    }
+  }
+  Span(const Span& other) = delete;
+  Span& operator=(const Span& other) = delete;
+  ~Span() {
+    if (m_recorder) {
+      end();
+    }
+  }
+
+  /// Whether the span is being recorded, so counts that take work to find can be skipped when it isn't
+  [[nodiscard]] bool isRecording() const {
+    return m_recorder;
+  }
+
+  void count(Recorder::Counter counter, size_t value) {
+    if (m_recorder) {
+      m_event.counts[static_cast<size_t>(counter)] = value;
+      m_event.hasCount[static_cast<size_t>(counter)] = true;
+    }
+  }
+
+ private:
+  void begin(Recorder* recorder, std::string_view name, Recorder::Category category);
+  void end();
+
+  Recorder* m_recorder = nullptr;
+  Recorder::Event m_event;
+  size_t m_nodesAtStart = 0;
+};
+
+/**
+ * Allocations made so far on the calling thread, counted by replacing the global allocation functions.
+ *
+ * Defined in Allocations.cpp, which only the executable links, so embedding the compiler leaves allocation alone.
+ */
+[[nodiscard]] size_t allocationCount();
+
+/// Parse nodes made so far on the calling thread
+[[nodiscard]] size_t nodeCount();
+void countNode();
+
+}  // namespace Cepheid::Trace
@@ -1,58 +1,33 @@
+#include <Driver.h>
+#include <Server/Server.h>
 
-#include <Compiler.h>
-
+#include <filesystem>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 
-static std::string_view usage() {
-  return "Usage: cepheid <input.cep> <output>";
-}
-
 int main(int argc, char* argv[]) {
-  if (argc < 2) {
-    std::cout << usage() << std::endl;
+  const std::vector<std::string> args{argv + 1, argv + argc};
+  std::string identity = Cepheid::Driver::compilerIdentity(argv[0]);
+
+  if (!args.empty() && args[0] == "--server") {
+    if (args.size() > 2) {
+      std::cerr << "Invalid number of arguments.\n" << Cepheid::Driver::usage() << std::endl;
+      return EXIT_FAILURE;
+    }
+    const std::filesystem::path socketPath =
+        args.size() == 2 ? std::filesystem::path(args[1]) : Cepheid::Server::defaultSocketPath();
+    try {
+      Cepheid::Server::Server server(socketPath, std::move(identity));
+      std::cout << "Listening on " << socketPath.string() << std::endl;
+      server.run();
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
     return EXIT_SUCCESS;
   }
 
-  std::vector<std::string> args{argv + 1, argv + argc};
-
-  if (args.size() != 2) {
-    std::cerr << "Invalid number of arguments.\n" << usage() << std::endl;
-    return EXIT_FAILURE;
-  }
-
-  std::string src;
-  {
-    std::ifstream infile(args[0]);
-    std::stringstream ss;
-    ss << infile.rdbuf();
-    src = ss.str();
-  }
-
-  Cepheid::Compiler cep;
-
-  std::string prog = cep.compile(src);
-
-  {
-    std::ofstream asmOut("out.asm");
-    asmOut << prog;
-  }
-
-  if (int ret = system("nasm -f win64 -o example.obj out.asm 2>&1"); ret != 0) {
-    std::cout << "Assemble failed with code:" << ret << std::endl;
-    return ret;
-  }
-
-  std::stringstream link;
-  link << "\"C:\\Program Files\\Microsoft Visual "
-          "Studio\\2022\\Community\\VC\\Auxiliary\\Build\\vcvarsall.bat\" amd64 10.0.22000.0 && ";
-  link << "link.exe .\\example.obj /subsystem:console /entry:_entry /out:" << args[1] << " kernel32.lib msvcrt.lib";
-
-  if (int ret = system(link.str().c_str()); ret != 0) {
-    std::cout << "Link failed with code:" << ret << std::endl;
-    return ret;
-  }
-}
\ No newline at end of file
+  const Cepheid::Driver driver(std::move(identity));
+  return driver.run(args, std::filesystem::current_path(), std::cout, std::cerr);
+}
@@ -0,0 +1,103 @@
+#include <Build/BuildCache.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace Cepheid;
+using Build::BuildCache;
+
+namespace {
+// Each entry is an assembly and an object of this size
+constexpr uintmax_t fileSize = 100;
+constexpr uintmax_t entrySize = 2 * fileSize;
+
+int failures = 0;
+
+void check(bool condition, std::string_view what) {
+  if (!condition) {
+    std::cout << "FAILED: " << what << "\n";
+    failures++;
+  }
+}
+
+/// Whether an entry is in the cache, without looking it up and so refreshing it
+bool isCached(const std::filesystem::path& directory, const std::string& key) {
+  return std::filesystem::exists(directory / (key + ".asm")) && std::filesystem::exists(directory / (key + ".obj"));
+}
+
+/// Store an entry last used the given time ago, which is when its object was last written
+void store(BuildCache& cache,
+           const std::filesystem::path& directory,
+           const std::filesystem::path& sources,
+           const std::string& key,
+           std::chrono::minutes age) {
+  cache.store(key, sources / "out.asm", sources / "out.obj");
+  std::filesystem::last_write_time(directory / (key + ".obj"), std::filesystem::file_time_type::clock::now() - age);
+}
+}  // namespace
+
+/**
+ * Fills a cache with room for three entries and trims it, checking the least recently used entries are the ones
+ * evicted, that a hit makes an entry the most recently used, and that temporary files left by stores are cleaned up.
+ */
+int main() {
+  const std::filesystem::path root = std::filesystem::temp_directory_path() / "cepheid_build_cache_test";
+  std::filesystem::remove_all(root);
+  const std::filesystem::path sources = root / "sources";
+  const std::filesystem::path directory = root / "cache";
+  std::filesystem::create_directories(sources);
+  for (const std::string_view name : {"out.asm", "out.obj"}) {
+    std::ofstream(sources / name, std::ios::binary) << std::string(fileSize, 'x');
+  }
+
+  BuildCache cache(directory, 3 * entrySize, "test");
+  store(cache, directory, sources, "a", std::chrono::minutes(40));
+  store(cache, directory, sources, "b", std::chrono::minutes(30));
+  store(cache, directory, sources, "c", std::chrono::minutes(20));
+  cache.trim();
+  check(isCached(directory, "a") && isCached(directory, "b") && isCached(directory, "c"), "a full cache is kept");
+
+  store(cache, directory, sources, "d", std::chrono::minutes(10));
+  cache.trim();
+  check(!isCached(directory, "a"), "the oldest entry is evicted");
+  check(isCached(directory, "b") && isCached(directory, "c") && isCached(directory, "d"), "newer entries are kept");
+
+  // A hit makes b the most recently used, so c is now the oldest
+  check(cache.lookup("b").has_value(), "a stored entry is a hit");
+  check(!cache.lookup("a").has_value(), "an evicted entry is a miss");
+  store(cache, directory, sources, "e", std::chrono::minutes(5));
+  cache.trim();
+  check(!isCached(directory, "c"), "the least recently used entry is evicted after a hit");
+  check(isCached(directory, "b"), "a hit entry is kept");
+  check(isCached(directory, "d") && isCached(directory, "e"), "entries newer than the evicted one are kept");
+
+  const BuildCache::Stats stats = cache.stats();
+  check(stats.hits == 1 && stats.misses == 1, "lookups are counted");
+  check(stats.stores == 5 && stats.evictions == 2, "stores and evictions are counted");
+
+  // A build that stopped part way through a store leaves its temporary file behind, while a running one is still
+  // writing its own
+  const std::filesystem::path stale = directory / "f.1.0.tmp";
+  const std::filesystem::path writing = directory / "g.2.0.tmp";
+  for (const std::filesystem::path& path : {stale, writing}) {
+    std::ofstream(path, std::ios::binary) << std::string(fileSize, 'x');
+  }
+  std::filesystem::last_write_time(stale, std::filesystem::file_time_type::clock::now() - std::chrono::minutes(20));
+  cache.trim();
+  check(!std::filesystem::exists(stale), "a stale temporary file is removed");
+  check(std::filesystem::exists(writing), "a recent temporary file is kept");
+  check(!isCached(directory, "d"), "a recent temporary file counts towards the size");
+  check(isCached(directory, "b") && isCached(directory, "e"), "only the oldest entry makes room for it");
+
+  std::filesystem::remove_all(root);
+  if (failures > 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << "The build cache evicts its least recently used entries" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <Build/ContentHash.h>
+#include <Build/InterfaceFile.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace Cepheid;
+using Build::InterfaceFile;
+
+namespace {
+// Offsets into a file with the layout InterfaceFile describes
+constexpr size_t versionOffset = 4;
+constexpr size_t typeCountOffset = 44;
+constexpr size_t stringCountOffset = 64;
+constexpr size_t headerSize = 68;
+constexpr size_t typeSize = 20;
+
+int failures = 0;
+
+void check(bool condition, std::string_view what) {
+  if (!condition) {
+    std::cout << "FAILED: " << what << "\n";
+    failures++;
+  }
+}
+
+std::string readFile(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << bytes;
+}
+
+uint32_t readU32(const std::string& bytes, size_t offset) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; i++) {
+    value |= uint32_t{static_cast<unsigned char>(bytes[offset + i])} << (8 * i);
+  }
+  return value;
+}
+
+void writeU32(std::string& bytes, size_t offset, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) {
+    bytes[offset + i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+void roundTrip(const std::filesystem::path& path,
+               const Sema::ModuleInterface& interface,
+               const InterfaceFile::Record& record) {
+  const std::optional<InterfaceFile> file = InterfaceFile::open(path);
+  check(file.has_value(), "a written file opens");
+  if (!file) {
+    return;
+  }
+
+  const std::optional<Sema::ModuleInterface> read = file->interface(interface.name);
+  check(read && read->name == interface.name && read->functions == interface.functions, "signatures round trip");
+  check(file->interfaceHash() == InterfaceFile::interfaceHash(interface), "the interface hash round trips");
+  check(file->sourceHash() == record.sourceHash, "the source hash round trips");
+
+  const InterfaceFile::Record readRecord = file->record();
+  check(readRecord.sourceHash == record.sourceHash, "the record's source hash round trips");
+  check(readRecord.definesMain == record.definesMain, "whether the module defines main round trips");
+  check(readRecord.fileImports == record.fileImports, "each file's imports round trip");
+}
+
+/// Every corruption of a valid file has to be caught when it's opened, before any of it is read
+void rejectsCorruption(const std::filesystem::path& directory, const std::string& valid) {
+  const std::filesystem::path path = directory / "corrupted.cepi";
+  const auto rejects = [&path, &valid](std::string_view what, const std::function<void(std::string&)>& corrupt) {
+    std::string bytes = valid;
+    corrupt(bytes);
+    writeFile(path, bytes);
+    check(!InterfaceFile::open(path), what);
+  };
+
+  rejects("an empty file is rejected", [](std::string& bytes) { bytes.clear(); });
+  rejects("a file cut off in its header is rejected", [](std::string& bytes) { bytes.resize(headerSize / 2); });
+  rejects("a file missing its last byte is rejected", [](std::string& bytes) { bytes.pop_back(); });
+  rejects("a file with bytes after its tables is rejected", [](std::string& bytes) { bytes.push_back('\0'); });
+  rejects("a file without the magic is rejected", [](std::string& bytes) { bytes[0] = 'X'; });
+  rejects("another format version is rejected", [](std::string& bytes) {
+    writeU32(bytes, versionOffset, readU32(bytes, versionOffset) + 1);
+  });
+  rejects("a table count past the end of the file is rejected", [](std::string& bytes) {
+    writeU32(bytes, stringCountOffset, readU32(bytes, stringCountOffset) + 1);
+  });
+  rejects("a name outside the string table is rejected", [](std::string& bytes) {
+    writeU32(bytes, headerSize, readU32(bytes, stringCountOffset));
+  });
+  rejects("a return type outside the type table is rejected", [](std::string& bytes) {
+    const uint32_t types = readU32(bytes, typeCountOffset);
+    writeU32(bytes, headerSize + types * typeSize + 8, types);
+  });
+}
+}  // namespace
+
+/**
+ * Writes a module's interface file and reads it back, then checks that truncated and corrupted copies of it are
+ * rejected when opened rather than read out of bounds.
+ */
+int main() {
+  const std::filesystem::path directory = std::filesystem::temp_directory_path() / "cepheid_interface_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  const std::filesystem::path path = directory / "math.cepi";
+
+  const Sema::ModuleInterface interface{
+      "math",
+      {{"add", {{8, true}, {8, true}}, {8, true}}, {"widen", {{1, false}}, {8, false}}, {"zero", {}, {4, true}}}};
+  const InterfaceFile::Record record{
+      Build::ContentHash().add("source").digest(), true, {{"geo"}, {}, {"geo", "io"}}};
+
+  InterfaceFile::write(path, interface, record);
+  roundTrip(path, interface, record);
+  check(!InterfaceFile::open(directory / "missing.cepi"), "a missing file doesn't open");
+  rejectsCorruption(directory, readFile(path));
+
+  std::filesystem::remove_all(directory);
+  if (failures > 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Interface files round trip and corrupted ones are rejected" << std::endl;
+  return EXIT_SUCCESS;
+}
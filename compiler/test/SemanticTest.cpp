@@ -0,0 +1,53 @@
+#include <Compiler.h>
+#include <Semantic/SemanticException.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+using namespace Cepheid;
+
+namespace {
+int failures = 0;
+
+void check(bool condition, std::string_view what) {
+  if (!condition) {
+    std::cout << "FAILED: " << what << "\n";
+    failures++;
+  }
+}
+
+bool rejects(std::string_view src) {
+  try {
+    static_cast<void>(Compiler().compile(src));
+  } catch (const Sema::SemanticException&) {
+    return true;
+  }
+  return false;
+}
+}  // namespace
+
+/**
+ * Checks that code the optimiser removes is still checked, so removing it doesn't change which programs compile.
+ */
+int main() {
+  check(!rejects("func main() -> i32 { i64 x = 1; return 0; }"), "a program with only removed code compiles");
+  check(rejects("func main() -> i32 { nothere + 1; return 0; }"),
+        "an undeclared name in a pure expression is reported");
+  check(rejects("func main() -> i32 { i64 x = undefinedthing; return 0; }"),
+        "an undeclared name in an unused variable is reported");
+  check(rejects("func main() -> i32 { return 0; y = 3; }"), "an undeclared name after a return is reported");
+  check(rejects("func main() -> i32 { i8 x = 300; return 0; }"),
+        "an out of range literal in an unused variable is reported");
+  check(rejects("func main() -> i32 { return 0; nowhere(); }"),
+        "a call to an unknown function after a return is reported");
+  check(rejects("const i64 limit = 1; func main() -> i32 { limit = 2; return 0; }"),
+        "a dead store to a constant is reported");
+  check(rejects("func main() -> i32 { return 100 / 7; }"), "division is reported rather than generating nothing");
+
+  if (failures > 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << "Code removed by the optimiser is still checked" << std::endl;
+  return EXIT_SUCCESS;
+}